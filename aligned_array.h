@@ -0,0 +1,78 @@
+#ifndef ALIGNED_ARRAY_H
+#define ALIGNED_ARRAY_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+
+constexpr size_t CACHE_LINE_SIZE = 64;
+
+/**
+ * Fixed-size array whose first element starts a cache line
+ * For structure-of-arrays storage: one field per array, so a loop over
+ * one field reads nothing else, and lines never straddle two arrays.
+ * Elements are value-initialised; only trivially destructible types, as
+ * nothing is destroyed element by element.
+ */
+template <typename T>
+class CacheLineArray {
+    static_assert(std::is_trivially_destructible<T>::value, "CacheLineArray holds trivially destructible types");
+
+private:
+    T* items;
+    size_t count;
+
+    void release() {
+        if (items) {
+            ::operator delete(items, std::align_val_t(CACHE_LINE_SIZE));
+            items = nullptr;
+        }
+        count = 0;
+    }
+
+public:
+    CacheLineArray() : items(nullptr), count(0) {}
+    explicit CacheLineArray(size_t n) : items(nullptr), count(0) { reset(n); }
+    ~CacheLineArray() { release(); }
+
+    // Delete copy constructor and assignment operator
+    CacheLineArray(const CacheLineArray&) = delete;
+    CacheLineArray& operator=(const CacheLineArray&) = delete;
+
+    // Replace the contents with n value-initialised elements
+    void reset(size_t n) {
+        release();
+        if (n == 0) {
+            return;
+        }
+        items = static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(CACHE_LINE_SIZE)));
+        for (size_t i = 0; i < n; ++i) {
+            new (items + i) T();
+        }
+        count = n;
+    }
+
+    void fill(const T& value) {
+        for (size_t i = 0; i < count; ++i) {
+            items[i] = value;
+        }
+    }
+
+    void swap(CacheLineArray& other) noexcept {
+        T* other_items = other.items;
+        size_t other_count = other.count;
+        other.items = items;
+        other.count = count;
+        items = other_items;
+        count = other_count;
+    }
+
+    T& operator[](size_t i) { return items[i]; }
+    const T& operator[](size_t i) const { return items[i]; }
+    T* data() { return items; }
+    const T* data() const { return items; }
+    size_t size() const { return count; }
+    size_t get_bytes() const { return count * sizeof(T); }
+};
+
+#endif
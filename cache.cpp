@@ -1,149 +1,714 @@
 #include "cache.h"
 #include <algorithm>
-#include <sstream>
+#include <charconv>
 #include <iomanip>
 #include <iostream>
 
-MessageCache::MessageCache(int cap) 
-    : capacity(cap), head(0), tail(0), size(0), hits(0), misses(0) {
+MessageCache::MessageCache(int cap, CacheAdmission policy, size_t budget, time_t ttl_seconds) 
+    : capacity(cap), admission(policy), window_capacity(cap), protected_capacity(0), byte_budget(budget),
+      ttl(ttl_seconds), size(0), stored_bytes(0), sweep_cursor(0), key_index(cap > 0 ? static_cast<size_t>(cap) : 1),
+      hits(0), misses(0), rejections(0), expirations(0), access_clock(0) {
     if (capacity <= 0) {
         throw std::invalid_argument("Cache capacity must be positive");
     }
-    cache.resize(capacity);
+    if (ttl < 0) {
+        throw std::invalid_argument("Cache TTL must not be negative");
+    }
+    size_t slots = static_cast<size_t>(capacity);
+    keys.reset(slots);
+    last_access.reset(slots);
+    timestamps.reset(slots);
+    prev.reset(slots);
+    next.reset(slots);
+    access_counts.reset(slots);
+    valid.reset(slots);
+    segments.reset(slots);
+    payload_refs.reset(slots);
+    sender_ids.reset(slots);
+    reset_slots();
+    
+    if (admission == CacheAdmission::TINY_LFU) {
+        // The window keeps at least one slot, the main segment too when it can
+        window_capacity = std::max(1, capacity * CACHE_WINDOW_PERCENT / 100);
+        if (capacity > 1) {
+            window_capacity = std::min(window_capacity, capacity - 1);
+        }
+        protected_capacity = (capacity - window_capacity) * CACHE_PROTECTED_PERCENT / 100;
+        sketch = std::make_unique<FrequencySketch>(static_cast<size_t>(capacity));
+    }
 }
 
 MessageCache::~MessageCache() {
-    // Cleanup handled by vector destructor
+    // Slab chunks free themselves; oversize payloads are owned per entry
+    for (int i = 0; i < capacity; ++i) {
+        if (valid[i]) {
+            payloads.release(payload_refs[i]);
+        }
+    }
 }
 
-std::string MessageCache::generate_message_id(const std::string& sender, time_t timestamp) const {
-    std::stringstream ss;
-    ss << sender << "_" << timestamp;
-    return ss.str();
+std::string MessageCache::generate_message_id(const std::string& sender, time_t timestamp) {
+    return sender + "_" + std::to_string(timestamp);
+}
+
+bool MessageCache::parse_message_id(std::string_view message_id, MessageKey& key) {
+    size_t separator = message_id.rfind('_');
+    if (separator == std::string_view::npos || separator == 0) {
+        return false;
+    }
+    
+    long long timestamp = 0;
+    const char* first = message_id.data() + separator + 1;
+    const char* last = message_id.data() + message_id.size();
+    auto result = std::from_chars(first, last, timestamp);
+    if (result.ec != std::errc() || result.ptr != last) {
+        return false;
+    }
+    
+    uint32_t sender_id;
+    if (!SenderTable::instance().find(message_id.substr(0, separator), sender_id)) {
+        return false;
+    }
+    
+    key = make_message_key(sender_id, static_cast<time_t>(timestamp));
+    return true;
 }
 
 int MessageCache::find_lru_index() const {
-    if (size == 0) {
-        return 0;
+    // The tail of the recency list is always the least recently used entry
+    int tail = lists[WINDOW].tail;
+    return tail >= 0 ? tail : 0;
+}
+
+void MessageCache::unlink_entry(int index) {
+    RecencyList& list = lists[segments[index]];
+    
+    if (prev[index] >= 0) {
+        next[prev[index]] = next[index];
+    } else {
+        list.head = next[index];
     }
     
-    int lru_index = 0;
-    time_t oldest_access = cache[0].last_access;
+    if (next[index] >= 0) {
+        prev[next[index]] = prev[index];
+    } else {
+        list.tail = prev[index];
+    }
     
-    for (int i = 1; i < size; ++i) {
-        if (cache[i].valid && cache[i].last_access < oldest_access) {
-            oldest_access = cache[i].last_access;
-            lru_index = i;
+    prev[index] = -1;
+    next[index] = -1;
+    list.count--;
+}
+
+void MessageCache::link_front(int index, Segment segment) {
+    RecencyList& list = lists[segment];
+    segments[index] = segment;
+    prev[index] = -1;
+    next[index] = list.head;
+    
+    if (list.head >= 0) {
+        prev[list.head] = index;
+    }
+    list.head = index;
+    
+    if (list.tail < 0) {
+        list.tail = index;
+    }
+    list.count++;
+}
+
+void MessageCache::touch(int index) {
+    last_access[index] = ++access_clock;
+    Segment segment = static_cast<Segment>(segments[index]);
+    
+    // A second hit on probation earns a protected slot; the protected
+    // segment's least recent entry goes back on probation to make room
+    if (segment == PROBATION && protected_capacity > 0) {
+        unlink_entry(index);
+        link_front(index, PROTECTED);
+        if (lists[PROTECTED].count > protected_capacity) {
+            int demoted = lists[PROTECTED].tail;
+            unlink_entry(demoted);
+            link_front(demoted, PROBATION);
         }
+        return;
+    }
+    
+    if (lists[segment].head != index) {
+        unlink_entry(index);
+        link_front(index, segment);
+    }
+}
+
+int MessageCache::evict(int index) {
+    unlink_entry(index);
+    if (valid[index]) {
+        key_index.erase(keys[index]);
+    }
+    stored_bytes -= payload_refs[index].length;
+    payloads.release(payload_refs[index]);
+    payload_refs[index] = PayloadRef();
+    valid[index] = 0;
+    return index;
+}
+
+void MessageCache::release_slot(int index) {
+    free_slots.push_back(index);
+    size--;
+}
+
+void MessageCache::reset_slots() {
+    // Field by field: each fill streams through one array
+    keys.fill(0);
+    last_access.fill(0);
+    timestamps.fill(0);
+    prev.fill(-1);
+    next.fill(-1);
+    access_counts.fill(0);
+    valid.fill(0);
+    segments.fill(WINDOW);
+    payload_refs.fill(PayloadRef());
+    sender_ids.fill(0);
+    
+    // Popped from the back, so slots fill in order
+    free_slots.clear();
+    free_slots.reserve(capacity);
+    for (int i = capacity - 1; i >= 0; --i) {
+        free_slots.push_back(i);
+    }
+}
+
+bool MessageCache::is_expired(int index, time_t now) const {
+    return ttl > 0 && timestamps[index] <= now - ttl;
+}
+
+int MessageCache::make_room() {
+    // Full cache, TinyLFU: the window's oldest entry is the candidate for
+    // the main segment, whose victim is the least recent probation entry
+    const RecencyList& window = lists[WINDOW];
+    int victim = lists[PROBATION].tail >= 0 ? lists[PROBATION].tail : lists[PROTECTED].tail;
+    if (victim < 0) {
+        return evict(window.tail);  // no main segment at capacity 1
+    }
+    if (window.count < window_capacity || window.tail < 0) {
+        return evict(victim);  // the window still has room for the newcomer
     }
     
-    return lru_index;
+    int candidate = window.tail;
+    if (sketch->frequency(keys[candidate]) > sketch->frequency(keys[victim])) {
+        unlink_entry(candidate);
+        link_front(candidate, PROBATION);
+        return evict(victim);
+    }
+    rejections.fetch_add(1, std::memory_order_relaxed);
+    return evict(candidate);
+}
+
+int MessageCache::evict_one() {
+    if (admission == CacheAdmission::TINY_LFU) {
+        return make_room();
+    }
+    return evict(find_lru_index());
 }
 
 bool MessageCache::insert(const std::string& sender, const std::string& content, time_t timestamp) {
+    return insert(SenderTable::instance().intern(sender), content, timestamp);
+}
+
+bool MessageCache::insert(uint32_t sender_id, std::string_view content, time_t timestamp) {
+    std::unique_lock<std::shared_mutex> lock(cache_mutex);
+    return insert_locked(sender_id, content, timestamp);
+}
+
+size_t MessageCache::insert_many(const CacheInsert* entries, size_t count) {
     std::unique_lock<std::shared_mutex> lock(cache_mutex);
     
-    std::string msg_id = generate_message_id(sender, timestamp);
+    size_t inserted = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (insert_locked(entries[i].sender_id, entries[i].content, entries[i].timestamp)) {
+            inserted++;
+        }
+    }
+    return inserted;
+}
+
+bool MessageCache::insert_locked(uint32_t sender_id, std::string_view content, time_t timestamp) {
+    MessageKey key = make_message_key(sender_id, timestamp);
     
     // Check if already exists
-    if (index_map.find(msg_id) != index_map.end()) {
+    if (key_index.find(key) >= 0) {
+        return false;
+    }
+    if (byte_budget > 0 && content.size() > byte_budget) {
+        rejections.fetch_add(1, std::memory_order_relaxed);
         return false;
     }
+    if (sketch) {
+        sketch->increment(key);
+    }
+    
+    // Byte budget: evict by the usual policy until the newcomer fits
+    while (byte_budget > 0 && size > 0 && stored_bytes + content.size() > byte_budget) {
+        release_slot(evict_one());
+    }
     
     int insert_index;
     
     if (size < capacity) {
-        // Cache not full, use next available slot
-        insert_index = size;
+        // Cache not full, use a free slot
+        insert_index = free_slots.back();
+        free_slots.pop_back();
         size++;
     } else {
-        // Cache full, evict LRU entry
-        insert_index = find_lru_index();
-        
-        // Remove old entry from index map
-        if (cache[insert_index].valid) {
-            index_map.erase(cache[insert_index].message_id);
-        }
+        // Cache full, evict by the admission policy
+        insert_index = evict_one();
     }
     
     // Insert new entry
-    cache[insert_index].message_id = msg_id;
-    cache[insert_index].content = content;
-    cache[insert_index].sender = sender;
-    cache[insert_index].timestamp = timestamp;
-    cache[insert_index].last_access = time(nullptr);
-    cache[insert_index].access_count = 1;
-    cache[insert_index].valid = true;
+    keys[insert_index] = key;
+    payload_refs[insert_index] = payloads.store(content.data(), content.size());
+    stored_bytes += content.size();
+    sender_ids[insert_index] = sender_id;
+    timestamps[insert_index] = timestamp;
+    last_access[insert_index] = ++access_clock;
+    access_counts[insert_index] = 1;
+    valid[insert_index] = 1;
+    link_front(insert_index, WINDOW);
     
-    index_map[msg_id] = insert_index;
+    // Still filling up: the main segment has room for the window's overflow
+    if (admission == CacheAdmission::TINY_LFU && lists[WINDOW].count > window_capacity) {
+        int overflow = lists[WINDOW].tail;
+        unlink_entry(overflow);
+        link_front(overflow, PROBATION);
+    }
+    
+    key_index.insert(key, insert_index);
     
     return true;
 }
 
-bool MessageCache::lookup(const std::string& message_id, std::string& content) const {
-    std::shared_lock<std::shared_mutex> lock(cache_mutex);
+int MessageCache::find_live(MessageKey key, time_t now) {
+    // Misses count too: a message asked for again may deserve a slot
+    if (sketch) {
+        sketch->increment(key);
+    }
+    
+    int index = key_index.find(key);
+    if (index < 0) {
+        return -1;
+    }
+    if (is_expired(index, now)) {
+        // Lazy expiry: the slot is reclaimed by whoever finds it stale
+        release_slot(evict(index));
+        expirations.fetch_add(1, std::memory_order_relaxed);
+        return -1;
+    }
+    return index;
+}
+
+bool MessageCache::lookup(MessageKey key, std::string& content) {
+    // Exclusive: a hit relinks the entry at the front of the recency list
+    std::unique_lock<std::shared_mutex> lock(cache_mutex);
+    
+    int index = find_live(key, time(nullptr));
+    if (index < 0) {
+        misses.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    
+    content.assign(payload_refs[index].data, payload_refs[index].length);
+    touch(index);
+    hits.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void MessageCache::update_access(MessageKey key) {
+    std::unique_lock<std::shared_mutex> lock(cache_mutex);
+    
+    int index = find_live(key, time(nullptr));
+    if (index >= 0) {
+        touch(index);
+        access_counts[index]++;
+    }
+}
+
+bool MessageCache::lookup_and_touch(MessageKey key, std::string& content) {
+    return lookup_many(&key, 1, &content, nullptr) == 1;
+}
+
+size_t MessageCache::lookup_many(const MessageKey* keys, size_t count, std::string* contents, bool* found) {
+    std::unique_lock<std::shared_mutex> lock(cache_mutex);
     
-    auto it = index_map.find(message_id);
-    if (it != index_map.end()) {
-        int index = it->second;
-        if (index >= 0 && index < size && cache[index].valid) {
-            content = cache[index].content;
-            const_cast<MessageCache*>(this)->hits++;
-            return true;
+    time_t now = time(nullptr);
+    size_t hit_count = 0;
+    for (size_t i = 0; i < count; ++i) {
+        int index = find_live(keys[i], now);
+        if (found) {
+            found[i] = index >= 0;
+        }
+        if (index < 0) {
+            continue;
         }
+        if (contents) {
+            contents[i].assign(payload_refs[index].data, payload_refs[index].length);
+        }
+        touch(index);
+        access_counts[index]++;
+        hit_count++;
     }
     
-    const_cast<MessageCache*>(this)->misses++;
-    return false;
+    hits.fetch_add(hit_count, std::memory_order_relaxed);
+    misses.fetch_add(count - hit_count, std::memory_order_relaxed);
+    return hit_count;
 }
 
-void MessageCache::update_access(const std::string& message_id) {
+bool MessageCache::lookup(std::string_view message_id, std::string& content) {
+    MessageKey key;
+    if (!parse_message_id(message_id, key)) {
+        // Unknown sender: count the miss like any other absent ID
+        misses.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return lookup(key, content);
+}
+
+void MessageCache::update_access(std::string_view message_id) {
+    MessageKey key;
+    if (parse_message_id(message_id, key)) {
+        update_access(key);
+    }
+}
+
+size_t MessageCache::sweep_expired(size_t max_slots) {
+    // Nothing can expire, or nothing to expire: skip the lock
+    if (ttl == 0 || size.load(std::memory_order_relaxed) == 0) {
+        return 0;
+    }
+    
     std::unique_lock<std::shared_mutex> lock(cache_mutex);
+    time_t cutoff = time(nullptr) - ttl;
+    size_t dropped = 0;
     
-    auto it = index_map.find(message_id);
-    if (it != index_map.end()) {
-        int index = it->second;
-        if (index >= 0 && index < size && cache[index].valid) {
-            cache[index].last_access = time(nullptr);
-            cache[index].access_count++;
+    size_t visits = std::min(max_slots, static_cast<size_t>(capacity));
+    for (size_t i = 0; i < visits && size > 0; ++i) {
+        int index = sweep_cursor;
+        if (++sweep_cursor == capacity) {
+            sweep_cursor = 0;
+        }
+        // Reads only the flag and timestamp arrays until something expired
+        if (valid[index] && timestamps[index] <= cutoff) {
+            release_slot(evict(index));
+            dropped++;
         }
     }
+    
+    expirations.fetch_add(dropped, std::memory_order_relaxed);
+    return dropped;
 }
 
 uint64_t MessageCache::get_hits() const {
-    std::shared_lock<std::shared_mutex> lock(cache_mutex);
-    return hits;
+    return hits.load(std::memory_order_relaxed);
 }
 
 uint64_t MessageCache::get_misses() const {
-    std::shared_lock<std::shared_mutex> lock(cache_mutex);
-    return misses;
+    return misses.load(std::memory_order_relaxed);
 }
 
 double MessageCache::get_hit_rate() const {
-    std::shared_lock<std::shared_mutex> lock(cache_mutex);
-    uint64_t total = hits + misses;
+    uint64_t hit_count = get_hits();
+    uint64_t total = hit_count + get_misses();
     if (total == 0) return 0.0;
-    return (static_cast<double>(hits) / total) * 100.0;
+    return (static_cast<double>(hit_count) / total) * 100.0;
 }
 
 int MessageCache::get_size() const {
+    return size.load(std::memory_order_relaxed);
+}
+
+uint64_t MessageCache::get_rejections() const {
+    return rejections.load(std::memory_order_relaxed);
+}
+
+int MessageCache::get_segment_size(Segment segment) const {
     std::shared_lock<std::shared_mutex> lock(cache_mutex);
-    return size;
+    return lists[segment].count;
+}
+
+size_t MessageCache::get_stored_bytes() const {
+    return stored_bytes.load(std::memory_order_relaxed);
+}
+
+uint64_t MessageCache::get_expirations() const {
+    return expirations.load(std::memory_order_relaxed);
+}
+
+uint64_t MessageCache::get_index_rehashes() const {
+    std::shared_lock<std::shared_mutex> lock(cache_mutex);
+    return key_index.get_rehashes();
+}
+
+size_t MessageCache::get_payload_bytes() const {
+    std::shared_lock<std::shared_mutex> lock(cache_mutex);
+    return payloads.get_reserved_bytes();
 }
 
 void MessageCache::clear() {
     std::unique_lock<std::shared_mutex> lock(cache_mutex);
     
-    for (int i = 0; i < size; ++i) {
-        cache[i].valid = false;
-        cache[i].message_id.clear();
-        cache[i].content.clear();
-        cache[i].sender.clear();
+    // One pass over the valid flags; only live slots have a payload to free
+    for (int i = 0; i < capacity; ++i) {
+        if (valid[i]) {
+            payloads.release(payload_refs[i]);
+        }
     }
+    reset_slots();
     
-    index_map.clear();
+    key_index.clear();
+    for (RecencyList& list : lists) {
+        list = RecencyList();
+    }
+    if (sketch) {
+        sketch->clear();
+    }
     size = 0;
+    stored_bytes = 0;
+    sweep_cursor = 0;
+    access_clock = 0;
     hits = 0;
     misses = 0;
-}
\ No newline at end of file
+    rejections = 0;
+    expirations = 0;
+}
+
+ShardedMessageCache::ShardedMessageCache(int cap, int shard_count, CacheAdmission admission, size_t byte_budget,
+                                         time_t ttl_seconds)
+    : capacity(cap) {
+    if (cap <= 0) {
+        throw std::invalid_argument("Cache capacity must be positive");
+    }
+    if (shard_count <= 0) {
+        throw std::invalid_argument("Shard count must be positive");
+    }
+    
+    // Never create empty shards; spread the remainder over the first ones
+    int count = std::min(shard_count, cap);
+    shards.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        int shard_capacity = cap / count + (i < cap % count ? 1 : 0);
+        // An unbounded budget stays unbounded; never hand a shard a budget of 0
+        size_t shard_budget = byte_budget == 0 ? 0 : std::max<size_t>(1, byte_budget / count);
+        shards.push_back(std::make_unique<Shard>(shard_capacity, admission, shard_budget, ttl_seconds));
+    }
+}
+
+size_t ShardedMessageCache::shard_index(MessageKey key) const {
+    return MessageKeyHash{}(key) % shards.size();
+}
+
+MessageCache& ShardedMessageCache::shard_for(MessageKey key) const {
+    return shards[shard_index(key)]->cache;
+}
+
+bool ShardedMessageCache::insert(uint32_t sender_id, std::string_view content, time_t timestamp) {
+    return shard_for(make_message_key(sender_id, timestamp)).insert(sender_id, content, timestamp);
+}
+
+bool ShardedMessageCache::insert(const std::string& sender, const std::string& content, time_t timestamp) {
+    return insert(SenderTable::instance().intern(sender), content, timestamp);
+}
+
+bool ShardedMessageCache::lookup(MessageKey key, std::string& content) {
+    return shard_for(key).lookup(key, content);
+}
+
+void ShardedMessageCache::update_access(MessageKey key) {
+    shard_for(key).update_access(key);
+}
+
+bool ShardedMessageCache::lookup_and_touch(MessageKey key, std::string& content) {
+    return shard_for(key).lookup_and_touch(key, content);
+}
+
+namespace {
+// Scratch array for one batch: on the stack up to CACHE_BATCH_STACK_SIZE
+// items, on the heap only beyond that
+template <typename T>
+class BatchBuffer {
+private:
+    T local[CACHE_BATCH_STACK_SIZE];
+    std::unique_ptr<T[]> heap;
+    T* items;
+
+public:
+    explicit BatchBuffer(size_t count) : items(local) {
+        if (count > CACHE_BATCH_STACK_SIZE) {
+            heap.reset(new T[count]);
+            items = heap.get();
+        }
+    }
+    
+    BatchBuffer(const BatchBuffer&) = delete;
+    BatchBuffer& operator=(const BatchBuffer&) = delete;
+    
+    T& operator[](size_t i) { return items[i]; }
+    T* data() { return items; }
+};
+
+// Shard in the high half, position in the low half, so sorting groups a
+// batch by shard and keeps each shard's entries in batch order
+uint64_t shard_order(size_t shard, size_t position) {
+    return (static_cast<uint64_t>(shard) << 32) | static_cast<uint32_t>(position);
+}
+
+size_t order_shard(uint64_t order) {
+    return static_cast<size_t>(order >> 32);
+}
+
+size_t order_position(uint64_t order) {
+    return static_cast<size_t>(order & 0xFFFFFFFFu);
+}
+}
+
+size_t ShardedMessageCache::lookup_many(const MessageKey* keys, size_t count, std::string* contents,
+                                        bool* found) {
+    // Sort positions by shard, then hand each shard its run of keys in one call
+    BatchBuffer<uint64_t> order(count);
+    for (size_t i = 0; i < count; ++i) {
+        order[i] = shard_order(shard_index(keys[i]), i);
+    }
+    std::sort(order.data(), order.data() + count);
+    
+    size_t hit_count = 0;
+    BatchBuffer<MessageKey> shard_keys(count);
+    BatchBuffer<std::string> shard_contents(contents ? count : 0);
+    BatchBuffer<bool> shard_found(count);
+    for (size_t begin = 0; begin < count;) {
+        size_t s = order_shard(order[begin]);
+        size_t run = 0;
+        while (begin + run < count && order_shard(order[begin + run]) == s) {
+            shard_keys[run] = keys[order_position(order[begin + run])];
+            run++;
+        }
+        hit_count += shards[s]->cache.lookup_many(shard_keys.data(), run,
+                                                  contents ? shard_contents.data() : nullptr, shard_found.data());
+        for (size_t j = 0; j < run; ++j) {
+            size_t position = order_position(order[begin + j]);
+            if (found) {
+                found[position] = shard_found[j];
+            }
+            if (contents && shard_found[j]) {
+                contents[position] = std::move(shard_contents[j]);
+            }
+        }
+        begin += run;
+    }
+    return hit_count;
+}
+
+size_t ShardedMessageCache::insert_many(const CacheInsert* entries, size_t count) {
+    BatchBuffer<uint64_t> order(count);
+    for (size_t i = 0; i < count; ++i) {
+        order[i] = shard_order(shard_index(make_message_key(entries[i].sender_id, entries[i].timestamp)), i);
+    }
+    std::sort(order.data(), order.data() + count);
+    
+    size_t inserted = 0;
+    BatchBuffer<CacheInsert> batch(count);
+    for (size_t begin = 0; begin < count;) {
+        size_t s = order_shard(order[begin]);
+        size_t run = 0;
+        while (begin + run < count && order_shard(order[begin + run]) == s) {
+            batch[run] = entries[order_position(order[begin + run])];
+            run++;
+        }
+        inserted += shards[s]->cache.insert_many(batch.data(), run);
+        begin += run;
+    }
+    return inserted;
+}
+
+bool ShardedMessageCache::lookup(std::string_view message_id, std::string& content) {
+    MessageKey key;
+    if (!MessageCache::parse_message_id(message_id, key)) {
+        // Charge the miss to a fixed shard so the totals stay accurate
+        return shards[0]->cache.lookup(message_id, content);
+    }
+    return lookup(key, content);
+}
+
+void ShardedMessageCache::update_access(std::string_view message_id) {
+    MessageKey key;
+    if (MessageCache::parse_message_id(message_id, key)) {
+        update_access(key);
+    }
+}
+
+size_t ShardedMessageCache::sweep_expired(size_t max_slots_per_shard) {
+    // One shard at a time, so at most one lock is held
+    size_t dropped = 0;
+    for (auto& shard : shards) {
+        dropped += shard->cache.sweep_expired(max_slots_per_shard);
+    }
+    return dropped;
+}
+
+uint64_t ShardedMessageCache::get_hits() const {
+    uint64_t total = 0;
+    for (const auto& shard : shards) {
+        total += shard->cache.get_hits();
+    }
+    return total;
+}
+
+uint64_t ShardedMessageCache::get_misses() const {
+    uint64_t total = 0;
+    for (const auto& shard : shards) {
+        total += shard->cache.get_misses();
+    }
+    return total;
+}
+
+double ShardedMessageCache::get_hit_rate() const {
+    uint64_t hit_count = get_hits();
+    uint64_t total = hit_count + get_misses();
+    if (total == 0) return 0.0;
+    return (static_cast<double>(hit_count) / total) * 100.0;
+}
+
+uint64_t ShardedMessageCache::get_rejections() const {
+    uint64_t total = 0;
+    for (const auto& shard : shards) {
+        total += shard->cache.get_rejections();
+    }
+    return total;
+}
+
+size_t ShardedMessageCache::get_stored_bytes() const {
+    size_t total = 0;
+    for (const auto& shard : shards) {
+        total += shard->cache.get_stored_bytes();
+    }
+    return total;
+}
+
+uint64_t ShardedMessageCache::get_expirations() const {
+    uint64_t total = 0;
+    for (const auto& shard : shards) {
+        total += shard->cache.get_expirations();
+    }
+    return total;
+}
+
+int ShardedMessageCache::get_size() const {
+    int total = 0;
+    for (const auto& shard : shards) {
+        total += shard->cache.get_size();
+    }
+    return total;
+}
+
+void ShardedMessageCache::clear() {
+    for (auto& shard : shards) {
+        shard->cache.clear();
+    }
+}
@@ -1,44 +1,151 @@
 #ifndef CACHE_H
 #define CACHE_H
 #include "common.h"
+#include "sender_table.h"
+#include "payload_slab.h"
+#include "frequency_sketch.h"
+#include "key_index.h"
+#include "aligned_array.h"
 #include <vector>
 #include <mutex>
 #include <shared_mutex>
-#include <unordered_map>
 #include <string>
+#include <string_view>
+#include <atomic>
+#include <memory>
 
+// One message for insert_many(); content is copied into the cache
+struct CacheInsert {
+    uint32_t sender_id;
+    std::string_view content;
+    time_t timestamp;
+};
+
+/**
+ * Fixed-capacity message cache
+ * With LRU admission every entry sits on one recency list and a full cache
+ * evicts its tail. With TINY_LFU admission (W-TinyLFU, Einziger et al.) new
+ * entries land in a small window LRU; the window's least recent entry then
+ * competes with the main segment's victim, and only replaces it if the
+ * frequency sketch says it is used more often. The main segment is itself
+ * split into probation and protected LRUs, so an entry has to be hit again
+ * after admission to become hard to evict. A burst of one-off messages
+ * thus churns the window instead of flushing the re-read ones.
+ * A byte budget additionally bounds the payload bytes held, evicting by the
+ * same policy until a newcomer fits. With a TTL, entries whose timestamp is
+ * older than ttl seconds are dropped lazily when looked up, and sweep_expired()
+ * reclaims the rest a bounded number of slots at a time.
+ *
+ * Storage is a structure of arrays, each starting on a cache line: hot
+ * per-slot metadata (keys, recency stamps, list links, flags) is kept apart
+ * from the cold payload handles, so walking the lists, sweeping for expiry
+ * or clearing reads only the fields it uses. Keys are found through a
+ * KeyIndex, which probes 16 hash tags per step.
+ */
 class MessageCache {
+public:
+    // Recency lists; LRU admission keeps everything on WINDOW
+    enum Segment : uint8_t { WINDOW, PROBATION, PROTECTED, SEGMENT_COUNT };
+
 private:
-    std::vector<CacheEntry> cache;
+    struct RecencyList {
+        int head;  // most recently used slot, -1 when empty
+        int tail;  // least recently used slot
+        int count;
+        RecencyList() : head(-1), tail(-1), count(0) {}
+    };
+    
+    // Hot metadata, indexed by slot
+    CacheLineArray<MessageKey> keys;
+    CacheLineArray<uint64_t> last_access;  // value of the monotonic access counter
+    CacheLineArray<time_t> timestamps;
+    CacheLineArray<int32_t> prev;  // recency list links (slot indices, -1 for none)
+    CacheLineArray<int32_t> next;
+    CacheLineArray<int32_t> access_counts;
+    CacheLineArray<uint8_t> valid;
+    CacheLineArray<uint8_t> segments;  // recency list the slot is on
+    
+    // Cold: touched on a hit, an insert or when the slot is freed
+    CacheLineArray<PayloadRef> payload_refs;  // the bytes live in payloads
+    CacheLineArray<uint32_t> sender_ids;  // index into the SenderTable
+    
     int capacity;
-    int head;
-    int tail;  // Not currently used but kept for future circular buffer implementation
-    int size;
-    std::unordered_map<std::string, int> index_map; 
+    RecencyList lists[SEGMENT_COUNT];
+    CacheAdmission admission;
+    int window_capacity;     // TinyLFU segment limits
+    int protected_capacity;
+    std::unique_ptr<FrequencySketch> sketch;  // TinyLFU only
+    size_t byte_budget;  // 0: bounded by entry count only
+    time_t ttl;          // seconds, 0: entries never expire
+    std::atomic<int> size;  // written under cache_mutex, read lock-free by get_size()
+    std::atomic<size_t> stored_bytes;  // sum of entry content lengths
+    std::vector<int> free_slots;  // slots not holding an entry
+    int sweep_cursor;  // next slot sweep_expired() looks at
+    KeyIndex key_index;  // key -> slot
+    PayloadSlab payloads;  // entry contents; guarded by cache_mutex like the rest
     mutable std::shared_mutex cache_mutex;
     
-    uint64_t hits;
-    uint64_t misses;
+    // Atomic so statistics can be read without taking cache_mutex
+    std::atomic<uint64_t> hits;
+    std::atomic<uint64_t> misses;
+    std::atomic<uint64_t> rejections;  // newcomers the admission filter turned away
+    std::atomic<uint64_t> expirations;  // entries dropped for outliving the TTL
+    uint64_t access_clock;  // bumped on every touch, never ties
     
     // Private helper methods
     int find_lru_index() const;
-    std::string generate_message_id(const std::string& sender, time_t timestamp) const;
+    void unlink_entry(int index);
+    void link_front(int index, Segment segment);
+    void touch(int index);
+    int evict(int index);
+    int make_room();
+    int evict_one();
+    void release_slot(int index);
+    bool is_expired(int index, time_t now) const;
+    void reset_slots();
+    int find_live(MessageKey key, time_t now);
+    bool insert_locked(uint32_t sender_id, std::string_view content, time_t timestamp);
 
 public:
-    explicit MessageCache(int capacity = CACHE_SIZE);
+    // Textual message IDs have the form "<sender>_<timestamp>"
+    static std::string generate_message_id(const std::string& sender, time_t timestamp);
+    
+    // Convert a textual ID to its key; false if the sender was never seen
+    static bool parse_message_id(std::string_view message_id, MessageKey& key);
+    
+    explicit MessageCache(int capacity = CACHE_SIZE, CacheAdmission admission = CacheAdmission::LRU,
+                          size_t byte_budget = 0, time_t ttl_seconds = 0);
     ~MessageCache();
     
-    // Delete copy constructor and assignment operator
+    // Delete copy and move operations (the mutex and counters are not movable)
     MessageCache(const MessageCache&) = delete;
     MessageCache& operator=(const MessageCache&) = delete;
     
-    // Allow move operations
-    MessageCache(MessageCache&&) noexcept = default;
-    MessageCache& operator=(MessageCache&&) noexcept = default;
-    
+    // Hot path: sender already interned, no allocation besides the payload.
+    // False for a duplicate, or content larger than the whole byte budget
+    bool insert(uint32_t sender_id, std::string_view content, time_t timestamp);
     bool insert(const std::string& sender, const std::string& content, time_t timestamp);
-    bool lookup(const std::string& message_id, std::string& content) const;
-    void update_access(const std::string& message_id);
+    
+    // A hit marks the entry as most recently used; an expired entry is a miss
+    bool lookup(MessageKey key, std::string& content);
+    void update_access(MessageKey key);
+    
+    // lookup() and update_access() under a single lock acquisition
+    bool lookup_and_touch(MessageKey key, std::string& content);
+    
+    // Batches under one lock. lookup_many() behaves like lookup_and_touch()
+    // per key and returns the hits; contents and found may each be null.
+    // insert_many() returns how many entries went in
+    size_t lookup_many(const MessageKey* keys, size_t count, std::string* contents, bool* found);
+    size_t insert_many(const CacheInsert* entries, size_t count);
+    
+    // Compatibility overloads for textual IDs
+    bool lookup(std::string_view message_id, std::string& content);
+    void update_access(std::string_view message_id);
+    
+    // Drop expired entries among the next max_slots slots, wrapping around;
+    // returns how many went. Holds the lock for at most max_slots checks
+    size_t sweep_expired(size_t max_slots = CACHE_SWEEP_BATCH);
     
     // Const getters
     uint64_t get_hits() const;
@@ -46,9 +153,76 @@ public:
     double get_hit_rate() const;
     int get_size() const;
     int get_capacity() const { return capacity; }
+    size_t get_payload_bytes() const;  // slab memory reserved for contents
+    CacheAdmission get_admission() const { return admission; }
+    uint64_t get_rejections() const;
+    int get_segment_size(Segment segment) const;
+    size_t get_byte_budget() const { return byte_budget; }
+    time_t get_ttl() const { return ttl; }
+    size_t get_stored_bytes() const;  // content bytes, what the budget counts
+    uint64_t get_expirations() const;
+    uint64_t get_index_rehashes() const;  // tombstone sweeps of the key index
     
     // Clear cache
     void clear();
 };
 
+/**
+ * Lock-striped message cache for multi-core use
+ * Message IDs are hashed onto independent MessageCache shards, each with its
+ * own lock, LRU list and hit/miss counters. Eviction is LRU within a shard,
+ * and a byte budget is split evenly between the shards.
+ */
+class ShardedMessageCache {
+private:
+    // Padded so neighbouring shards never share a cache line
+    struct alignas(64) Shard {
+        MessageCache cache;
+        Shard(int cap, CacheAdmission admission, size_t byte_budget, time_t ttl)
+            : cache(cap, admission, byte_budget, ttl) {}
+    };
+    
+    std::vector<std::unique_ptr<Shard>> shards;
+    int capacity;
+    
+    size_t shard_index(MessageKey key) const;
+    MessageCache& shard_for(MessageKey key) const;
+
+public:
+    explicit ShardedMessageCache(int capacity = CACHE_SIZE, int shard_count = CACHE_SHARD_COUNT,
+                                 CacheAdmission admission = CacheAdmission::LRU, size_t byte_budget = 0,
+                                 time_t ttl_seconds = 0);
+    
+    // Delete copy constructor and assignment operator
+    ShardedMessageCache(const ShardedMessageCache&) = delete;
+    ShardedMessageCache& operator=(const ShardedMessageCache&) = delete;
+    
+    bool insert(uint32_t sender_id, std::string_view content, time_t timestamp);
+    bool insert(const std::string& sender, const std::string& content, time_t timestamp);
+    bool lookup(MessageKey key, std::string& content);
+    void update_access(MessageKey key);
+    bool lookup_and_touch(MessageKey key, std::string& content);
+    
+    // Keys are grouped by shard, so each shard's lock is taken once per batch
+    size_t lookup_many(const MessageKey* keys, size_t count, std::string* contents, bool* found);
+    size_t insert_many(const CacheInsert* entries, size_t count);
+    bool lookup(std::string_view message_id, std::string& content);
+    void update_access(std::string_view message_id);
+    size_t sweep_expired(size_t max_slots_per_shard = CACHE_SWEEP_BATCH);
+    
+    // Const getters (summed over all shards)
+    uint64_t get_hits() const;
+    uint64_t get_misses() const;
+    double get_hit_rate() const;
+    int get_size() const;
+    int get_capacity() const { return capacity; }
+    int get_shard_count() const { return static_cast<int>(shards.size()); }
+    uint64_t get_rejections() const;
+    size_t get_stored_bytes() const;
+    uint64_t get_expirations() const;
+    
+    // Clear every shard
+    void clear();
+};
+
 #endif
\ No newline at end of file
@@ -0,0 +1,310 @@
+#include "cache.h"
+#include "key_index.h"
+#include "payload_slab.h"
+#include "common.h"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <unordered_map>
+#include <shared_mutex>
+#include <chrono>
+#include <cstdlib>
+
+// Microbenchmarks: MessageCache's structure-of-arrays layout and SIMD key
+// index against the array-of-structs + std::unordered_map layout it replaces.
+// Usage: cache_bench [entries]
+
+namespace {
+constexpr uint32_t SENDERS = 1000;
+
+void print_separator() {
+    std::cout << std::string(70, '=') << std::endl;
+}
+
+void print_header(const std::string& name) {
+    print_separator();
+    std::cout << "BENCH: " << name << std::endl;
+    print_separator();
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void print_pair(const std::string& label, size_t ops, double legacy, double current) {
+    std::cout << "   " << std::left << std::setw(26) << label << std::right << std::fixed << std::setprecision(1)
+              << std::setw(9) << (legacy * 1e9 / ops) << " ns" << std::setw(11) << (current * 1e9 / ops)
+              << " ns" << std::setw(9) << std::setprecision(2) << (legacy / current) << "x" << std::endl;
+}
+
+void print_columns(const char* left, const char* right) {
+    std::cout << "   " << std::left << std::setw(26) << "per operation" << std::right << std::setw(12) << left
+              << std::setw(14) << right << std::setw(10) << "speedup" << std::endl;
+}
+
+// Distinct keys spread over SENDERS senders, like a busy server's traffic
+MessageKey key_for(size_t i, time_t base) {
+    return make_message_key(static_cast<uint32_t>(i % SENDERS), base + static_cast<time_t>(i / SENDERS));
+}
+
+// A fixed pseudo-random visiting order, the same for every contender
+std::vector<size_t> shuffled(size_t count) {
+    std::vector<size_t> order(count);
+    for (size_t i = 0; i < count; ++i) {
+        order[i] = i;
+    }
+    uint64_t state = 0x9e3779b97f4a7c15ULL;
+    for (size_t i = count - 1; i > 0; --i) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        std::swap(order[i], order[state % (i + 1)]);
+    }
+    return order;
+}
+
+// MessageCache before the split: one struct per slot, keys in a node-based
+// map, a single LRU list; kept here only as the baseline
+class LegacyCache {
+private:
+    struct Entry {
+        uint64_t key;
+        PayloadRef content;
+        uint32_t sender_id;
+        time_t timestamp;
+        uint64_t last_access;
+        int access_count;
+        bool valid;
+        uint8_t segment;
+        int prev;
+        int next;
+
+        Entry() : key(0), sender_id(0), timestamp(0), last_access(0), access_count(0), valid(false),
+                  segment(0), prev(-1), next(-1) {}
+    };
+
+    std::vector<Entry> cache;
+    int capacity;
+    int head;
+    int tail;
+    int size;
+    std::unordered_map<MessageKey, int, MessageKeyHash> index_map;
+    PayloadSlab payloads;
+    std::shared_mutex cache_mutex;
+    uint64_t access_clock;
+
+    void unlink(int index) {
+        Entry& entry = cache[index];
+        if (entry.prev >= 0) cache[entry.prev].next = entry.next; else head = entry.next;
+        if (entry.next >= 0) cache[entry.next].prev = entry.prev; else tail = entry.prev;
+        entry.prev = -1;
+        entry.next = -1;
+    }
+
+    void link_front(int index) {
+        Entry& entry = cache[index];
+        entry.prev = -1;
+        entry.next = head;
+        if (head >= 0) cache[head].prev = index;
+        head = index;
+        if (tail < 0) tail = index;
+    }
+
+public:
+    explicit LegacyCache(int cap) : capacity(cap), head(-1), tail(-1), size(0), access_clock(0) {
+        cache.resize(capacity);
+        index_map.reserve(capacity);
+    }
+
+    ~LegacyCache() {
+        for (Entry& entry : cache) {
+            if (entry.valid) payloads.release(entry.content);
+        }
+    }
+
+    bool insert(uint32_t sender_id, std::string_view content, time_t timestamp) {
+        std::unique_lock<std::shared_mutex> lock(cache_mutex);
+        MessageKey key = make_message_key(sender_id, timestamp);
+        if (index_map.find(key) != index_map.end()) {
+            return false;
+        }
+        int index;
+        if (size < capacity) {
+            index = size++;
+        } else {
+            index = tail;
+            unlink(index);
+            index_map.erase(cache[index].key);
+            payloads.release(cache[index].content);
+        }
+        Entry& entry = cache[index];
+        entry.key = key;
+        entry.content = payloads.store(content.data(), content.size());
+        entry.sender_id = sender_id;
+        entry.timestamp = timestamp;
+        entry.last_access = ++access_clock;
+        entry.access_count = 1;
+        entry.valid = true;
+        link_front(index);
+        index_map[key] = index;
+        return true;
+    }
+
+    bool lookup(MessageKey key, std::string& content) {
+        std::unique_lock<std::shared_mutex> lock(cache_mutex);
+        auto it = index_map.find(key);
+        if (it == index_map.end()) {
+            return false;
+        }
+        Entry& entry = cache[it->second];
+        content.assign(entry.content.data, entry.content.length);
+        entry.last_access = ++access_clock;
+        if (head != it->second) {
+            unlink(it->second);
+            link_front(it->second);
+        }
+        return true;
+    }
+
+    // What an expiry sweep over every slot reads
+    size_t count_expired(time_t cutoff) {
+        std::unique_lock<std::shared_mutex> lock(cache_mutex);
+        size_t expired = 0;
+        for (const Entry& entry : cache) {
+            expired += entry.valid && entry.timestamp <= cutoff;
+        }
+        return expired;
+    }
+
+    void clear() {
+        std::unique_lock<std::shared_mutex> lock(cache_mutex);
+        for (int i = 0; i < size; ++i) {
+            cache[i].valid = false;
+            cache[i].key = 0;
+            payloads.release(cache[i].content);
+            cache[i].sender_id = 0;
+            cache[i].prev = -1;
+            cache[i].next = -1;
+        }
+        index_map.clear();
+        head = tail = -1;
+        size = 0;
+    }
+};
+
+void bench_index(size_t entries) {
+    print_header("Key index, " + std::to_string(entries) + " keys (" + KeyIndex::probe_kind() + " probing)");
+    time_t base = 1000000;
+    std::vector<size_t> order = shuffled(entries);
+
+    std::unordered_map<MessageKey, int, MessageKeyHash> map;
+    map.reserve(entries);
+    KeyIndex index(entries);
+    print_columns("unordered_map", "KeyIndex");
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < entries; ++i) map.emplace(key_for(i, base), static_cast<int>(i));
+    double map_time = seconds_since(start);
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < entries; ++i) index.insert(key_for(i, base), static_cast<int>(i));
+    print_pair("insert", entries, map_time, seconds_since(start));
+
+    long map_sum = 0;
+    long index_sum = 0;
+    start = std::chrono::steady_clock::now();
+    for (size_t i : order) map_sum += map.find(key_for(i, base))->second;
+    map_time = seconds_since(start);
+    start = std::chrono::steady_clock::now();
+    for (size_t i : order) index_sum += index.find(key_for(i, base));
+    print_pair("find (hit)", entries, map_time, seconds_since(start));
+
+    size_t map_misses = 0;
+    size_t index_misses = 0;
+    start = std::chrono::steady_clock::now();
+    for (size_t i : order) map_misses += map.find(key_for(i + entries, base)) == map.end();
+    map_time = seconds_since(start);
+    start = std::chrono::steady_clock::now();
+    for (size_t i : order) index_misses += index.find(key_for(i + entries, base)) < 0;
+    print_pair("find (miss)", entries, map_time, seconds_since(start));
+
+    std::cout << "   Memory: unordered_map ~" << (map.bucket_count() * sizeof(void*) +
+                                                  map.size() * (sizeof(void*) * 2 + sizeof(MessageKey) + sizeof(int))) / 1024
+              << " KB, KeyIndex " << index.get_bytes() / 1024 << " KB"
+              << (map_sum == index_sum && map_misses == index_misses ? "" : "   ✗ results differ") << std::endl;
+}
+
+void bench_cache(size_t entries) {
+    print_header("MessageCache, " + std::to_string(entries) + " entries (LRU, 32-byte payloads)");
+    int capacity = static_cast<int>(entries);
+    time_t base = time(nullptr);
+    std::string payload(32, 'p');
+    std::string content;
+    std::vector<size_t> order = shuffled(entries);
+
+    LegacyCache legacy(capacity);
+    MessageCache current(capacity, CacheAdmission::LRU, 0, 24 * 3600);  // a TTL nothing reaches
+    print_columns("AoS + map", "SoA + index");
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < entries; ++i) legacy.insert(i % SENDERS, payload, base + i / SENDERS);
+    double legacy_time = seconds_since(start);
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < entries; ++i) current.insert(i % SENDERS, payload, base + i / SENDERS);
+    print_pair("fill", entries, legacy_time, seconds_since(start));
+
+    size_t legacy_hits = 0;
+    size_t current_hits = 0;
+    start = std::chrono::steady_clock::now();
+    for (size_t i : order) legacy_hits += legacy.lookup(key_for(i, base), content);
+    legacy_time = seconds_since(start);
+    start = std::chrono::steady_clock::now();
+    for (size_t i : order) current_hits += current.lookup(key_for(i, base), content);
+    print_pair("lookup (hit)", entries, legacy_time, seconds_since(start));
+
+    start = std::chrono::steady_clock::now();
+    for (size_t i : order) legacy_hits += legacy.lookup(key_for(i + entries, base), content);
+    legacy_time = seconds_since(start);
+    start = std::chrono::steady_clock::now();
+    for (size_t i : order) current_hits += current.lookup(key_for(i + entries, base), content);
+    print_pair("lookup (miss)", entries, legacy_time, seconds_since(start));
+
+    // Every insert evicts the least recently used entry
+    start = std::chrono::steady_clock::now();
+    for (size_t i = entries; i < 2 * entries; ++i) legacy.insert(i % SENDERS, payload, base + i / SENDERS);
+    legacy_time = seconds_since(start);
+    start = std::chrono::steady_clock::now();
+    for (size_t i = entries; i < 2 * entries; ++i) current.insert(i % SENDERS, payload, base + i / SENDERS);
+    print_pair("insert with eviction", entries, legacy_time, seconds_since(start));
+
+    // Full metadata scans: an expiry check over every slot, then clear()
+    start = std::chrono::steady_clock::now();
+    size_t legacy_expired = legacy.count_expired(base - 24 * 3600);
+    legacy_time = seconds_since(start);
+    start = std::chrono::steady_clock::now();
+    size_t current_expired = current.sweep_expired(entries);
+    print_pair("expiry scan (per slot)", entries, legacy_time, seconds_since(start));
+
+    start = std::chrono::steady_clock::now();
+    legacy.clear();
+    legacy_time = seconds_since(start);
+    start = std::chrono::steady_clock::now();
+    current.clear();
+    print_pair("clear (per slot)", entries, legacy_time, seconds_since(start));
+
+    bool ok = legacy_hits == current_hits && legacy_expired == current_expired && current.get_size() == 0;
+    std::cout << (ok ? "" : "   ✗ results differ\n");
+}
+}
+
+int main(int argc, char* argv[]) {
+    size_t entries = argc > 1 ? static_cast<size_t>(std::strtoull(argv[1], nullptr, 10)) : 1000000;
+    if (entries == 0 || entries > (1u << 30)) {
+        std::cerr << "Usage: " << argv[0] << " [entries]" << std::endl;
+        return 1;
+    }
+
+    bench_index(entries);
+    std::cout << "\n\n";
+    bench_cache(entries);
+    return 0;
+}
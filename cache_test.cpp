@@ -1,11 +1,46 @@
 #include "cache.h"
+#include "history_store.h"
+#include "protocol.h"
 #include "common.h"
 #include <iostream>
 #include <iomanip>
+#include <algorithm>
 #include <vector>
+#include <unordered_map>
 #include <thread>
 #include <chrono>
 #include <atomic>
+#include <cstdlib>
+#include <new>
+
+// Counts heap allocations so key-based lookups can be checked for zero
+static std::atomic<uint64_t> allocation_count(0);
+
+void* operator new(size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    void* ptr = std::malloc(size ? size : 1);
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+// GCC flags free() on memory from operator new once these are inlined into
+// library code, not knowing the operator new above is a malloc()
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
 
 void print_separator() {
     std::cout << std::string(70, '=') << std::endl;
@@ -17,7 +52,8 @@ void print_test_header(const std::string& test_name) {
     print_separator();
 }
 
-void print_cache_stats(const MessageCache& cache) {
+template <typename Cache>
+void print_cache_stats(const Cache& cache) {
     std::cout << "\n[Cache Statistics]" << std::endl;
     std::cout << "  Size: " << cache.get_size() << "/" << cache.get_capacity() << std::endl;
     std::cout << "  Hits: " << cache.get_hits() << std::endl;
@@ -92,6 +128,65 @@ void test_lru_eviction() {
     print_cache_stats(cache);
 }
 
+void test_lru_ordering() {
+    print_test_header("LRU Ordering Within One Second");
+    
+    MessageCache cache(3);
+    std::string content;
+    time_t now = time(nullptr);
+    
+    std::cout << "\n1. Inserting A, B, C in the same second..." << std::endl;
+    cache.insert("A", "first", now);
+    cache.insert("B", "second", now);
+    cache.insert("C", "third", now);
+    
+    std::cout << "\n2. Reading A so B becomes least recently used..." << std::endl;
+    cache.lookup("A_" + std::to_string(now), content);
+    
+    std::cout << "\n3. Inserting D (should evict B)..." << std::endl;
+    cache.insert("D", "fourth", now);
+    
+    bool found_a = cache.lookup("A_" + std::to_string(now), content);
+    bool found_b = cache.lookup("B_" + std::to_string(now), content);
+    std::cout << "   Lookup A (should still exist): " << (found_a ? "✓ FOUND" : "✗ NOT FOUND (ERROR)") << std::endl;
+    std::cout << "   Lookup B (should be evicted): " << (found_b ? "✗ FOUND (ERROR)" : "✓ NOT FOUND") << std::endl;
+    
+    std::cout << "\n4. Inserting E (should evict C, then D stays)..." << std::endl;
+    cache.insert("E", "fifth", now);
+    bool found_c = cache.lookup("C_" + std::to_string(now), content);
+    bool found_d = cache.lookup("D_" + std::to_string(now), content);
+    std::cout << "   Lookup C (should be evicted): " << (found_c ? "✗ FOUND (ERROR)" : "✓ NOT FOUND") << std::endl;
+    std::cout << "   Lookup D (should still exist): " << (found_d ? "✓ FOUND" : "✗ NOT FOUND (ERROR)") << std::endl;
+    
+    print_cache_stats(cache);
+}
+
+void test_large_capacity() {
+    print_test_header("Large Capacity Eviction (100k entries)");
+    
+    const int capacity = 100000;
+    MessageCache cache(capacity);
+    time_t base_time = time(nullptr);
+    
+    std::cout << "\n1. Inserting " << capacity * 2 << " messages (every second one evicts)..." << std::endl;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < capacity * 2; i++) {
+        cache.insert("User" + std::to_string(i % 100), "History message", base_time + i);
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    std::cout << "   Elapsed: " << elapsed << " ms" << std::endl;
+    
+    std::string content;
+    int newest = capacity * 2 - 1;
+    bool found_newest = cache.lookup("User" + std::to_string(newest % 100) + "_" +
+                                     std::to_string(base_time + newest), content);
+    bool found_oldest = cache.lookup("User0_" + std::to_string(base_time), content);
+    std::cout << "   Newest message present: " << (found_newest ? "✓ PASS" : "✗ FAIL") << std::endl;
+    std::cout << "   Oldest message evicted: " << (!found_oldest ? "✓ PASS" : "✗ FAIL") << std::endl;
+    std::cout << "   Final cache size: " << cache.get_size() << "/" << capacity << std::endl;
+}
+
 void test_cache_performance() {
     print_test_header("Cache Performance Test");
     
@@ -144,7 +239,7 @@ void test_concurrent_access() {
         }
     };
     
-    auto reader = [&](int thread_id) {
+    auto reader = [&](int) {
         std::string content;
         for (int i = 0; i < 20; i++) {
             int target_thread = i % 2;
@@ -176,6 +271,629 @@ void test_concurrent_access() {
     std::cout << "\n✓ No crashes or deadlocks detected" << std::endl;
 }
 
+void test_sharded_cache() {
+    print_test_header("Sharded Cache");
+    
+    ShardedMessageCache cache(10, 4);
+    std::string content;
+    time_t base_time = time(nullptr);
+    
+    std::cout << "\n1. Shard layout..." << std::endl;
+    std::cout << "   Shards: " << cache.get_shard_count() << ", capacity: " << cache.get_capacity() << std::endl;
+    
+    std::cout << "\n2. Insert and lookup across shards..." << std::endl;
+    for (int i = 0; i < 10; i++) {
+        cache.insert("User" + std::to_string(i), "Message " + std::to_string(i), base_time + i);
+    }
+    int found = 0;
+    for (int i = 0; i < 10; i++) {
+        if (cache.lookup("User" + std::to_string(i) + "_" + std::to_string(base_time + i), content)) {
+            found++;
+        }
+    }
+    // LRU is per shard, so an unlucky hash spread can evict before the total fills
+    std::cout << "   Found " << found << " of 10 inserted messages" << std::endl;
+    std::cout << "   " << (found > 0 ? "✓ PASS" : "✗ FAIL") << std::endl;
+    
+    std::cout << "\n3. Overfilling (100 messages into capacity 10)..." << std::endl;
+    for (int i = 10; i < 110; i++) {
+        cache.insert("User" + std::to_string(i), "Message " + std::to_string(i), base_time + i);
+    }
+    std::cout << "   Final cache size: " << cache.get_size() << "/10" << std::endl;
+    std::cout << "   " << (cache.get_size() == 10 ? "✓ PASS" : "✗ FAIL") << std::endl;
+    
+    print_cache_stats(cache);
+}
+
+void test_message_keys() {
+    print_test_header("Composite Message Keys");
+    
+    MessageCache cache(16);
+    time_t base_time = time(nullptr);
+    uint32_t alice = SenderTable::instance().intern("KeyAlice");
+    uint32_t bob = SenderTable::instance().intern("KeyBob");
+    
+    std::cout << "\n1. Interning is stable..." << std::endl;
+    bool stable = SenderTable::instance().intern("KeyAlice") == alice && alice != bob &&
+                  SenderTable::instance().name(bob) == "KeyBob";
+    std::cout << "   " << (stable ? "✓ PASS" : "✗ FAIL") << std::endl;
+    
+    std::cout << "\n2. Key and textual IDs find the same entry..." << std::endl;
+    cache.insert(alice, "From Alice", base_time);
+    cache.insert("KeyBob", "From Bob", base_time);
+    std::string by_key, by_name;
+    bool found_key = cache.lookup(make_message_key(bob, base_time), by_key);
+    bool found_name = cache.lookup("KeyAlice_" + std::to_string(base_time), by_name);
+    std::cout << "   " << (found_key && by_key == "From Bob" && found_name && by_name == "From Alice"
+                           ? "✓ PASS" : "✗ FAIL") << std::endl;
+    
+    std::cout << "\n3. Malformed and unknown IDs miss..." << std::endl;
+    bool any_found = cache.lookup("KeyAlice", by_name) ||
+                     cache.lookup("KeyAlice_12x", by_name) ||
+                     cache.lookup("NeverSeen_" + std::to_string(base_time), by_name);
+    std::cout << "   " << (!any_found ? "✓ PASS" : "✗ FAIL") << std::endl;
+    
+    std::cout << "\n4. Key lookups do not allocate..." << std::endl;
+    std::string content;
+    content.reserve(64);
+    uint64_t before = allocation_count.load();
+    for (int i = 0; i < 10000; i++) {
+        cache.lookup(make_message_key(alice, base_time - (i % 4)), content);
+        cache.update_access(make_message_key(alice, base_time));
+    }
+    uint64_t allocations = allocation_count.load() - before;
+    std::cout << "   Allocations during 20000 operations: " << allocations << std::endl;
+    std::cout << "   " << (allocations == 0 ? "✓ PASS" : "✗ FAIL") << std::endl;
+    
+    print_cache_stats(cache);
+}
+
+template <typename Cache>
+double run_mixed_workload(Cache& cache, int thread_count, int ops_per_thread) {
+    time_t base_time = time(nullptr);
+    std::vector<std::thread> threads;
+    
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < thread_count; t++) {
+        threads.emplace_back([&cache, t, ops_per_thread, base_time]() {
+            std::string sender = "Worker" + std::to_string(t);
+            std::string content;
+            for (int i = 0; i < ops_per_thread; i++) {
+                // One insert for every three lookups, like the server's TEXT path
+                if (i % 4 == 0) {
+                    cache.insert(sender, "payload", base_time + i);
+                } else {
+                    cache.lookup(sender + "_" + std::to_string(base_time + i - (i % 4)), content);
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return (thread_count * ops_per_thread) / seconds;
+}
+
+void test_payload_slab() {
+    print_test_header("Slab-Allocated Payloads");
+    
+    MessageCache cache(8);
+    time_t base_time = time(nullptr);
+    
+    std::cout << "\n1. Contents round-trip across size classes..." << std::endl;
+    const size_t sizes[] = {0, 1, 31, 32, 33, 1000, 4096, 5000};
+    bool intact = true;
+    for (size_t i = 0; i < 8; i++) {
+        cache.insert("SlabUser", std::string(sizes[i], static_cast<char>('a' + i)), base_time + i);
+    }
+    for (size_t i = 0; i < 8; i++) {
+        std::string content;
+        bool found = cache.lookup("SlabUser_" + std::to_string(base_time + i), content);
+        intact = intact && found && content == std::string(sizes[i], static_cast<char>('a' + i));
+    }
+    std::cout << "   " << (intact ? "✓ PASS" : "✗ FAIL") << std::endl;
+    
+    std::cout << "\n2. Evictions reuse slots instead of growing the slab..." << std::endl;
+    std::string payload(200, 'x');
+    for (int i = 0; i < 100; i++) {
+        cache.insert("SlabChurn", payload, base_time + 100 + i);
+    }
+    size_t warm_bytes = cache.get_payload_bytes();
+    for (int i = 100; i < 10000; i++) {
+        cache.insert("SlabChurn", payload, base_time + 100 + i);
+    }
+    std::cout << "   Reserved bytes: " << warm_bytes << " -> " << cache.get_payload_bytes() << std::endl;
+    std::cout << "   " << (cache.get_payload_bytes() == warm_bytes ? "✓ PASS" : "✗ FAIL") << std::endl;
+    
+    print_cache_stats(cache);
+}
+
+void test_tiny_lfu_admission() {
+    print_test_header("W-TinyLFU Admission");
+    
+    std::cout << "\n1. Frequency sketch ranks keys and ages..." << std::endl;
+    FrequencySketch sketch(64);
+    for (int i = 0; i < 12; i++) {
+        sketch.increment(42);
+    }
+    sketch.increment(7);
+    int hot = sketch.frequency(42);
+    int cold = sketch.frequency(7);
+    std::cout << "   Estimates: hot " << hot << ", once " << cold << ", never " << sketch.frequency(99) << std::endl;
+    bool ranked = hot >= 12 && cold >= 1 && hot > cold;
+    // 640 increments trigger an aging pass that halves every counter
+    for (uint64_t key = 1000; key < 1700; key++) {
+        sketch.increment(key);
+    }
+    bool aged = sketch.get_resets() >= 1 && sketch.frequency(42) <= hot / 2 + 1;
+    std::cout << "   After aging: hot " << sketch.frequency(42) << std::endl;
+    std::cout << "   " << (ranked && aged ? "✓ PASS" : "✗ FAIL") << std::endl;
+    
+    std::cout << "\n2. A burst of one-off messages does not flush re-read ones..." << std::endl;
+    const int capacity = 200;
+    const int hot_count = 100;
+    uint32_t sender = SenderTable::instance().intern("Replay");
+    MessageCache lru(capacity);
+    MessageCache tiny(capacity, CacheAdmission::TINY_LFU);
+    for (MessageCache* cache : {&lru, &tiny}) {
+        std::string content;
+        for (int i = 0; i < hot_count; i++) {
+            cache->insert(sender, "hot", 1000 + i);
+        }
+        for (int round = 0; round < 3; round++) {
+            for (int i = 0; i < hot_count; i++) {
+                cache->lookup(make_message_key(sender, 1000 + i), content);
+            }
+        }
+        for (int i = 0; i < 5000; i++) {
+            cache->insert(sender, "burst", 100000 + i);
+        }
+    }
+    int lru_kept = 0;
+    int tiny_kept = 0;
+    std::string content;
+    for (int i = 0; i < hot_count; i++) {
+        lru_kept += lru.lookup(make_message_key(sender, 1000 + i), content) ? 1 : 0;
+        tiny_kept += tiny.lookup(make_message_key(sender, 1000 + i), content) ? 1 : 0;
+    }
+    std::cout << "   Hot messages kept: LRU " << lru_kept << "/" << hot_count
+              << ", TinyLFU " << tiny_kept << "/" << hot_count
+              << " (" << tiny.get_rejections() << " newcomers rejected)" << std::endl;
+    std::cout << "   " << (tiny_kept >= hot_count * 9 / 10 && lru_kept == 0 ? "✓ PASS" : "✗ FAIL") << std::endl;
+    
+    std::cout << "\n3. Replay-style trace at equal capacity..." << std::endl;
+    // Every message is inserted once. Half the reads go to a popular set
+    // that drifts slowly, a third to the newest messages, the rest anywhere
+    MessageCache lru_trace(capacity);
+    MessageCache tiny_trace(capacity, CacheAdmission::TINY_LFU);
+    uint64_t rng = 88172645463325252ULL;
+    auto next = [&rng]() {
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        return rng;
+    };
+    for (int i = 0; i < 200000; i++) {
+        time_t newest = 10000 + i / 4;
+        if (i % 4 == 0) {
+            lru_trace.insert(sender, "trace", newest);
+            tiny_trace.insert(sender, "trace", newest);
+            continue;
+        }
+        uint64_t r = next();
+        uint64_t pick = (r >> 8) % 1000;
+        time_t target;
+        if (r % 6 < 3) {
+            time_t epoch_start = 10000 + (newest - 10000) / 5000 * 5000;
+            target = epoch_start + static_cast<time_t>(pick % 100) * 7;
+        } else if (r % 6 < 5) {
+            target = newest - static_cast<time_t>(pick % 50);
+        } else {
+            target = 10000 + static_cast<time_t>(r % static_cast<uint64_t>(newest - 9999));
+        }
+        MessageKey key = make_message_key(sender, target);
+        lru_trace.lookup(key, content);
+        tiny_trace.lookup(key, content);
+    }
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "   Hit rate: LRU " << lru_trace.get_hit_rate() << "%, TinyLFU "
+              << tiny_trace.get_hit_rate() << "%" << std::endl;
+    std::cout << "   Segments: window " << tiny_trace.get_segment_size(MessageCache::WINDOW)
+              << ", probation " << tiny_trace.get_segment_size(MessageCache::PROBATION)
+              << ", protected " << tiny_trace.get_segment_size(MessageCache::PROTECTED) << std::endl;
+    bool full = tiny_trace.get_size() == capacity &&
+                tiny_trace.get_segment_size(MessageCache::WINDOW) +
+                tiny_trace.get_segment_size(MessageCache::PROBATION) +
+                tiny_trace.get_segment_size(MessageCache::PROTECTED) == capacity;
+    std::cout << "   " << (full && tiny_trace.get_hit_rate() > lru_trace.get_hit_rate() ? "✓ PASS" : "✗ FAIL")
+              << std::endl;
+    
+    std::cout << "\n4. Tiny capacities and clear()..." << std::endl;
+    bool small_ok = true;
+    for (int cap = 1; cap <= 3; cap++) {
+        MessageCache small(cap, CacheAdmission::TINY_LFU);
+        for (int i = 0; i < 20; i++) {
+            small.insert(sender, "small", 500 + i);
+        }
+        // The newest insert always lands in the window
+        small_ok = small_ok && small.get_size() == cap && small.lookup(make_message_key(sender, 519), content);
+        small.clear();
+        small_ok = small_ok && small.get_size() == 0 && !small.lookup(make_message_key(sender, 519), content);
+        small.insert(sender, "again", 600);
+        small_ok = small_ok && small.lookup(make_message_key(sender, 600), content) && content == "again";
+    }
+    std::cout << "   " << (small_ok ? "✓ PASS" : "✗ FAIL") << std::endl;
+}
+
+void test_expiry_and_byte_budget() {
+    print_test_header("TTL Expiry and Byte Budget");
+    uint32_t sender = SenderTable::instance().intern("Budget");
+    std::string content;
+    
+    std::cout << "\n1. Byte budget evicts until the newcomer fits..." << std::endl;
+    MessageCache budgeted(100, CacheAdmission::LRU, 1000);
+    std::string big(200, 'b');
+    for (int i = 0; i < 10; i++) {
+        budgeted.insert(sender, big, 100 + i);
+    }
+    std::cout << "   Entries: " << budgeted.get_size() << ", bytes " << budgeted.get_stored_bytes()
+              << " / " << budgeted.get_byte_budget() << std::endl;
+    bool evicted_oldest = budgeted.get_size() == 5 && !budgeted.lookup(make_message_key(sender, 104), content) &&
+                          budgeted.lookup(make_message_key(sender, 105), content);
+    bool oversize_rejected = !budgeted.insert(sender, std::string(2000, 'x'), 200) &&
+                             budgeted.get_rejections() == 1;
+    bool bounded = true;
+    for (int i = 0; i < 300; i++) {
+        budgeted.insert(sender, std::string(static_cast<size_t>(1 + i % 97), 's'), 300 + i);
+        bounded = bounded && budgeted.get_stored_bytes() <= 1000 && budgeted.get_size() <= 100;
+    }
+    std::cout << "   " << (evicted_oldest && oversize_rejected && bounded
+                               ? "✓ PASS" : "✗ FAIL") << std::endl;
+    
+    std::cout << "\n2. Lookups drop expired entries lazily..." << std::endl;
+    time_t now = time(nullptr);
+    MessageCache expiring(10, CacheAdmission::LRU, 0, 60);
+    expiring.insert(sender, "stale", now - 120);
+    expiring.insert(sender, "fresh", now);
+    bool stale_missed = !expiring.lookup(make_message_key(sender, now - 120), content);
+    bool fresh_hit = expiring.lookup(make_message_key(sender, now), content) && content == "fresh";
+    std::cout << "   Expired: " << expiring.get_expirations() << ", entries left " << expiring.get_size()
+              << std::endl;
+    std::cout << "   " << (stale_missed && fresh_hit && expiring.get_expirations() == 1 && expiring.get_size() == 1
+                               ? "✓ PASS" : "✗ FAIL") << std::endl;
+    
+    std::cout << "\n3. Sweeper reclaims expired slots in bounded batches..." << std::endl;
+    const int capacity = 1000;
+    MessageCache swept(capacity, CacheAdmission::TINY_LFU, 0, 60);
+    for (int i = 0; i < capacity; i++) {
+        // Every other entry is already past its TTL
+        swept.insert(sender, "entry", i % 2 == 0 ? now - 3600 - i : now + i);
+    }
+    size_t passes = 0;
+    size_t max_batch = 0;
+    size_t total = 0;
+    size_t dropped;
+    while ((dropped = swept.sweep_expired(64)) > 0 || passes * 64 < static_cast<size_t>(capacity)) {
+        max_batch = std::max(max_batch, dropped);
+        total += dropped;
+        passes++;
+    }
+    bool fresh_kept = true;
+    for (int i = 1; i < capacity; i += 2) {
+        fresh_kept = fresh_kept && swept.lookup(make_message_key(sender, now + i), content);
+    }
+    // Emptied slots are reused before anything is evicted
+    for (int i = 0; i < capacity / 2; i++) {
+        swept.insert(sender, "refill", now + capacity + i);
+    }
+    std::cout << "   Dropped " << total << " in " << passes << " passes (largest " << max_batch
+              << "), size after refill " << swept.get_size() << std::endl;
+    std::cout << "   " << (total == capacity / 2 && max_batch <= 64 && fresh_kept && swept.get_size() == capacity &&
+                           swept.get_expirations() == static_cast<uint64_t>(capacity / 2)
+                               ? "✓ PASS" : "✗ FAIL") << std::endl;
+    
+    std::cout << "\n4. Sharded cache splits the budget..." << std::endl;
+    ShardedMessageCache sharded(64, 4, CacheAdmission::LRU, 4096, 60);
+    for (int i = 0; i < 200; i++) {
+        sharded.insert(sender, std::string(100, 'p'), now + i);
+    }
+    size_t swept_sharded = sharded.sweep_expired();
+    std::cout << "   Bytes: " << sharded.get_stored_bytes() << " / 4096, entries " << sharded.get_size()
+              << std::endl;
+    std::cout << "   " << (sharded.get_stored_bytes() <= 4096 && sharded.get_size() > 0 && swept_sharded == 0
+                               ? "✓ PASS" : "✗ FAIL") << std::endl;
+}
+
+void test_batched_operations() {
+    print_test_header("Batched Lookups and Inserts");
+    uint32_t sender = SenderTable::instance().intern("Batch");
+    time_t base_time = time(nullptr);
+    
+    std::cout << "\n1. insert_many / lookup_many under one lock..." << std::endl;
+    MessageCache cache(64);
+    std::vector<std::string> texts;
+    for (int i = 0; i < 32; i++) {
+        texts.push_back("batched " + std::to_string(i));
+    }
+    std::vector<CacheInsert> entries;
+    for (int i = 0; i < 32; i++) {
+        entries.push_back({sender, texts[i], base_time + i});
+    }
+    entries.push_back({sender, "duplicate", base_time});
+    size_t inserted = cache.insert_many(entries.data(), entries.size());
+    
+    // Every other key is absent
+    std::vector<MessageKey> keys;
+    for (int i = 0; i < 64; i += 2) {
+        keys.push_back(make_message_key(sender, base_time + i));
+    }
+    std::vector<std::string> contents(keys.size());
+    std::unique_ptr<bool[]> found(new bool[keys.size()]);
+    size_t hit_count = cache.lookup_many(keys.data(), keys.size(), contents.data(), found.get());
+    bool matched = true;
+    for (size_t i = 0; i < keys.size(); i++) {
+        int offset = static_cast<int>(i) * 2;
+        bool expected = offset < 32;
+        matched = matched && found[i] == expected && (!expected || contents[i] == texts[offset]);
+    }
+    std::cout << "   Inserted " << inserted << " of " << entries.size() << ", hits " << hit_count << " of "
+              << keys.size() << std::endl;
+    std::cout << "   " << (inserted == 32 && hit_count == 16 && matched && cache.get_hits() == 16 &&
+                           cache.get_misses() == 16 ? "✓ PASS" : "✗ FAIL") << std::endl;
+    
+    std::cout << "\n2. lookup_and_touch refreshes recency..." << std::endl;
+    MessageCache small(3);
+    std::string content;
+    small.insert(sender, "first", base_time + 100);
+    small.insert(sender, "second", base_time + 101);
+    small.insert(sender, "third", base_time + 102);
+    bool touched = small.lookup_and_touch(make_message_key(sender, base_time + 100), content) && content == "first";
+    small.insert(sender, "fourth", base_time + 103);
+    bool kept = small.lookup(make_message_key(sender, base_time + 100), content);
+    bool evicted = !small.lookup(make_message_key(sender, base_time + 101), content);
+    std::cout << "   " << (touched && kept && evicted ? "✓ PASS" : "✗ FAIL") << std::endl;
+    
+    std::cout << "\n3. Sharded batches keep key order..." << std::endl;
+    ShardedMessageCache sharded(256, 8);
+    size_t sharded_inserted = sharded.insert_many(entries.data(), entries.size());
+    std::vector<std::string> sharded_contents(keys.size());
+    std::unique_ptr<bool[]> sharded_found(new bool[keys.size()]);
+    size_t sharded_hits = sharded.lookup_many(keys.data(), keys.size(), sharded_contents.data(), sharded_found.get());
+    bool same = sharded_contents == contents;
+    for (size_t i = 0; i < keys.size(); i++) {
+        same = same && sharded_found[i] == found[i];
+    }
+    std::cout << "   " << (sharded_inserted == 32 && sharded_hits == 16 && same ? "✓ PASS" : "✗ FAIL") << std::endl;
+    
+    std::cout << "\n4. Per-message cost: 4 lookups + 3 touches vs one lookup_many..." << std::endl;
+    const int rounds = 200000;
+    MessageKey probes[4] = {keys[0], keys[1], keys[20], keys[2]};
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        for (MessageKey key : probes) {
+            if (cache.lookup(key, content) && key != probes[0]) {
+                cache.update_access(key);
+            }
+        }
+    }
+    auto separate = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::high_resolution_clock::now() - start).count();
+    start = std::chrono::high_resolution_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        cache.lookup_many(probes, 4, nullptr, nullptr);
+    }
+    auto batched = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::high_resolution_clock::now() - start).count();
+    std::cout << "   Separate calls: " << separate << " us, batched: " << batched << " us" << std::endl;
+    std::cout << "   " << (batched < separate ? "✓ PASS" : "✗ FAIL") << std::endl;
+}
+
+void test_key_index() {
+    print_test_header("SIMD-Probed Key Index (" + std::string(KeyIndex::probe_kind()) + ")");
+    
+    std::cout << "\n1. Matches std::unordered_map under insert/erase churn..." << std::endl;
+    // A roomy index, and a small one whose full groups leave tombstones to rehash away
+    bool agreed = true;
+    uint64_t rehashes = 0;
+    for (size_t max_keys : {size_t(5000), size_t(24)}) {
+        KeyIndex index(max_keys);
+        std::unordered_map<MessageKey, int> reference;
+        std::vector<MessageKey> present;
+        uint64_t state = 0x2545f4914f6cdd1dULL;
+        for (int op = 0; op < 200000; op++) {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            // Keys share senders and nearby timestamps, like real message keys
+            MessageKey key = make_message_key(static_cast<uint32_t>(state % 7),
+                                              static_cast<time_t>((state >> 8) % 20000));
+            if (present.size() < max_keys && (state >> 40) % 3 != 0) {
+                bool inserted = index.insert(key, op);
+                bool expected = reference.emplace(key, op).second;
+                agreed = agreed && inserted == expected;
+                if (expected) {
+                    present.push_back(key);
+                }
+            } else if (!present.empty()) {
+                size_t pick = static_cast<size_t>((state >> 20) % present.size());
+                MessageKey victim = present[pick];
+                present[pick] = present.back();
+                present.pop_back();
+                agreed = agreed && index.erase(victim) && reference.erase(victim) == 1;
+                agreed = agreed && !index.erase(victim);
+            }
+            auto it = reference.find(key);
+            agreed = agreed && index.find(key) == (it == reference.end() ? -1 : it->second);
+        }
+        for (MessageKey key : present) {
+            agreed = agreed && index.find(key) == reference[key];
+        }
+        agreed = agreed && index.size() == reference.size();
+        rehashes += index.get_rehashes();
+        std::cout << "   Max " << max_keys << ": live keys " << index.size() << ", slots "
+                  << index.get_slot_count() << ", rehashes " << index.get_rehashes() << std::endl;
+    }
+    std::cout << "   " << (agreed && rehashes > 0 ? "✓ PASS" : "✗ FAIL") << std::endl;
+    
+    std::cout << "\n2. Full index and clear()..." << std::endl;
+    KeyIndex small(3);
+    bool bounded = small.insert(1, 10) && small.insert(2, 20) && small.insert(3, 30) && !small.insert(4, 40);
+    small.clear();
+    bool cleared = small.size() == 0 && small.find(1) == -1 && small.insert(4, 40) && small.find(4) == 40;
+    std::cout << "   " << (bounded && cleared ? "✓ PASS" : "✗ FAIL") << std::endl;
+}
+
+void test_index_rehash_churn() {
+    print_test_header("Cache Churn Through Key Index Rehashes");
+    
+    std::cout << "\n1. Lookups stay right across several in-place rehashes..." << std::endl;
+    // Every insert past capacity evicts, and erases in full groups leave tombstones
+    const int capacity = 100;
+    MessageCache churned(capacity);
+    uint32_t senders[5];
+    for (int s = 0; s < 5; s++) {
+        senders[s] = SenderTable::instance().intern("Churn" + std::to_string(s));
+    }
+    auto key_of = [&](int i) { return make_message_key(senders[i % 5], 1000 + i / 5); };
+    bool intact = true;
+    uint64_t checked_rehashes = 0;
+    std::string content;
+    for (int i = 0; i < 400000; i++) {
+        churned.insert(senders[i % 5], std::to_string(i), 1000 + i / 5);
+        if (churned.get_index_rehashes() == checked_rehashes) {
+            continue;
+        }
+        // Right after each rehash: the newest entries are all there, the one just evicted is not
+        checked_rehashes = churned.get_index_rehashes();
+        for (int j = i - capacity + 1; j <= i; j++) {
+            intact = intact && churned.lookup(key_of(j), content) && content == std::to_string(j);
+        }
+        intact = intact && !churned.lookup(key_of(i - capacity), content);
+    }
+    for (int j = 400000 - capacity; j < 400000; j++) {
+        intact = intact && churned.lookup(key_of(j), content) && content == std::to_string(j);
+    }
+    std::cout << "   Rehashes " << checked_rehashes << ", size " << churned.get_size() << std::endl;
+    std::cout << "   " << (intact && checked_rehashes >= 3 && churned.get_size() == capacity ? "✓ PASS" : "✗ FAIL")
+              << std::endl;
+}
+
+void test_history_store() {
+    print_test_header("History Ring Store");
+    
+    HistoryStore history(256, 8);
+    time_t base_time = 1000;
+    
+    std::cout << "\n1. Records read back in order without copies..." << std::endl;
+    for (int i = 0; i < 5; i++) {
+        std::string payload = "message " + std::to_string(i);
+        history.append(MSG_TEXT, 7, base_time + i, payload.data(), payload.size());
+    }
+    std::vector<HistoryRecord> records;
+    history.read_since(base_time + 2, records, 10);
+    bool ordered = records.size() == 3 && records[0].payload == "message 2" &&
+                   records[2].payload == "message 4" && records[1].sender_id == 7 &&
+                   history.is_intact(records[0].sequence);
+    std::cout << "   " << (ordered ? "✓ PASS" : "✗ FAIL") << std::endl;
+    
+    std::cout << "\n2. Wrapping retires the oldest records..." << std::endl;
+    std::string big(100, 'z');
+    for (int i = 5; i < 12; i++) {
+        history.append(MSG_TEXT, 7, base_time + i, big.data(), big.size());
+    }
+    // 256 bytes hold two 100-byte payloads; earlier views are no longer intact
+    bool retired = !history.is_intact(records[0].sequence) && history.get_record_count() == 2;
+    size_t visited = history.for_each_since(0, [](const HistoryRecord& record) {
+        return record.payload.size() == 100;
+    });
+    std::cout << "   Records kept: " << history.get_record_count() << std::endl;
+    std::cout << "   " << (retired && visited == 2 ? "✓ PASS" : "✗ FAIL") << std::endl;
+    
+    std::cout << "\n3. Readers never see torn payloads while a writer wraps..." << std::endl;
+    HistoryStore shared(4096, 64);
+    std::atomic<bool> done(false);
+    std::atomic<int> torn(0);
+    std::thread reader([&]() {
+        while (!done.load()) {
+            shared.for_each_since(0, [&](const HistoryRecord& record) {
+                // Each payload is a run of one character; check after reading
+                bool uniform = std::all_of(record.payload.begin(), record.payload.end(),
+                                           [&](char c) { return c == record.payload[0]; });
+                if (!uniform && shared.is_intact(record.sequence)) {
+                    torn.fetch_add(1);
+                }
+                return true;
+            });
+        }
+    });
+    for (int i = 0; i < 200000; i++) {
+        std::string payload(32 + i % 64, static_cast<char>('a' + i % 26));
+        shared.append(MSG_TEXT, 1, base_time + i, payload.data(), payload.size());
+    }
+    done = true;
+    reader.join();
+    std::cout << "   Torn reads accepted: " << torn.load() << std::endl;
+    std::cout << "   " << (torn.load() == 0 ? "✓ PASS" : "✗ FAIL") << std::endl;
+    
+    std::cout << "\n4. Recent records of one room among others..." << std::endl;
+    HistoryStore mixed(4096, 64);
+    for (int i = 0; i < 30; i++) {
+        std::string payload = "room " + std::to_string(i % 3) + " #" + std::to_string(i);
+        mixed.append(MSG_TEXT, 1, base_time + i, payload.data(), payload.size(), static_cast<uint32_t>(i % 3));
+    }
+    std::vector<std::string> seen;
+    size_t matched = mixed.for_each_recent_in_room(2, 4, [&](const HistoryRecord& record) {
+        seen.push_back(std::string(record.payload));
+        return record.room_id == 2;
+    });
+    bool filtered = matched == 4 && seen.size() == 4 && seen.front() == "room 2 #20" && seen.back() == "room 2 #29";
+    size_t none = mixed.for_each_recent_in_room(5, 4, [](const HistoryRecord&) { return true; });
+    std::cout << "   " << (filtered && none == 0 ? "✓ PASS" : "✗ FAIL") << std::endl;
+}
+
+void test_hello_handshake() {
+    print_test_header("Username Handshake");
+    
+    std::cout << "\n1. A framed hello split across two reads..." << std::endl;
+    std::string user_id;
+    size_t consumed = 0;
+    std::string buffer("alice\0FRA", 9);
+    bool waited = parse_hello(buffer, user_id, consumed) == HelloStatus::INCOMPLETE;
+    buffer += "MED/1";
+    buffer.append(FRAME_HEADER_SIZE, '\0');
+    bool framed = parse_hello(buffer, user_id, consumed) == HelloStatus::FRAMED &&
+                  user_id == "alice" && consumed == 6 + FRAMING_TAG_LEN;
+    std::cout << "   " << (waited && framed ? "✓ PASS" : "✗ FAIL") << std::endl;
+    
+    std::cout << "\n2. Legacy hellos keep the bytes that follow the name..." << std::endl;
+    std::string terminated("bob\0\1xyz", 8);
+    bool nul_legacy = parse_hello(terminated, user_id, consumed) == HelloStatus::LEGACY &&
+                      user_id == "bob" && consumed == 4;
+    bool bare_legacy = parse_hello("carol", user_id, consumed) == HelloStatus::LEGACY &&
+                       user_id == "carol" && consumed == 5;
+    std::cout << "   " << (nul_legacy && bare_legacy ? "✓ PASS" : "✗ FAIL") << std::endl;
+}
+
+void test_concurrent_scaling() {
+    print_test_header("Concurrent Throughput: Single Lock vs Sharded");
+    
+    const int ops_per_thread = 100000;
+    std::cout << "\n" << std::setw(10) << "Threads" << std::setw(20) << "Single (ops/s)"
+              << std::setw(20) << "Sharded (ops/s)" << std::endl;
+    
+    for (int threads = 1; threads <= 8; threads *= 2) {
+        MessageCache single(1000);
+        ShardedMessageCache sharded(1000);
+        double single_rate = run_mixed_workload(single, threads, ops_per_thread);
+        double sharded_rate = run_mixed_workload(sharded, threads, ops_per_thread);
+        std::cout << std::setw(10) << threads << std::setw(20) << std::fixed << std::setprecision(0)
+                  << single_rate << std::setw(20) << sharded_rate << std::endl;
+    }
+    std::cout << "\n   Hardware threads available: " << std::thread::hardware_concurrency() << std::endl;
+}
+
 void test_edge_cases() {
     print_test_header("Edge Cases and Stress Test");
     
@@ -221,12 +939,51 @@ int main() {
         test_lru_eviction();
         std::cout << "\n\n";
         
+        test_lru_ordering();
+        std::cout << "\n\n";
+        
+        test_large_capacity();
+        std::cout << "\n\n";
+        
         test_cache_performance();
         std::cout << "\n\n";
         
         test_concurrent_access();
         std::cout << "\n\n";
         
+        test_message_keys();
+        std::cout << "\n\n";
+        
+        test_sharded_cache();
+        std::cout << "\n\n";
+        
+        test_payload_slab();
+        std::cout << "\n\n";
+        
+        test_tiny_lfu_admission();
+        std::cout << "\n\n";
+        
+        test_expiry_and_byte_budget();
+        std::cout << "\n\n";
+        
+        test_batched_operations();
+        std::cout << "\n\n";
+        
+        test_key_index();
+        std::cout << "\n\n";
+        
+        test_index_rehash_churn();
+        std::cout << "\n\n";
+        
+        test_history_store();
+        std::cout << "\n\n";
+        
+        test_hello_handshake();
+        std::cout << "\n\n";
+        
+        test_concurrent_scaling();
+        std::cout << "\n\n";
+        
         test_edge_cases();
         std::cout << "\n\n";
         
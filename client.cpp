@@ -1,4 +1,5 @@
 #include "common.h"
+#include "protocol.h"
 #include <iostream>
 #include <cstring>
 #include <unistd.h>
@@ -12,12 +13,76 @@
 
 std::atomic<bool> client_running(true);
 
-void receive_messages(int socket_fd) {
-    Message msg;
+// How long to wait for the server to acknowledge framing before falling
+// back to fixed-size Message structs
+constexpr int FRAMING_ACK_TIMEOUT_MS = 2000;
+
+void display_message(uint8_t type, const std::string& sender, const std::string& payload,
+                     time_t timestamp) {
+    char time_str[64];
+    struct tm* tm_info = localtime(&timestamp);
+    if (tm_info) {
+        strftime(time_str, sizeof(time_str), "%H:%M:%S", tm_info);
+    } else {
+        strncpy(time_str, "??:??:??", sizeof(time_str) - 1);
+    }
+    
+    switch (type) {
+        case MSG_TEXT:
+            std::cout << "\n[" << time_str << "] " << sender << ": " 
+                      << payload << std::endl;
+            std::cout << "You: " << std::flush;
+            break;
+            
+        case MSG_JOIN:
+            std::cout << "\n[" << time_str << "] >>> " << payload << std::endl;
+            std::cout << "You: " << std::flush;
+            break;
+            
+        case MSG_LEAVE:
+            std::cout << "\n[" << time_str << "] <<< " << payload << std::endl;
+            std::cout << "You: " << std::flush;
+            break;
+            
+        default:
+            // Unknown message type, ignore
+            break;
+    }
+}
+
+void receive_messages(int socket_fd, bool framed, std::string pending) {
+    FrameDecoder decoder;
+    char chunk[BUFFER_SIZE * 2];
     
     while (client_running.load()) {
-        memset(&msg, 0, sizeof(msg));
-        ssize_t bytes = recv(socket_fd, &msg, sizeof(Message), 0);
+        // Display everything complete so far; partial messages stay buffered
+        if (framed) {
+            decoder.feed(pending.data(), pending.size());
+            pending.clear();
+            
+            Frame frame;
+            while (decoder.next(frame)) {
+                display_message(frame.type, frame.sender, frame.payload, frame.timestamp);
+            }
+            if (decoder.has_error()) {
+                std::cout << "\n[ERROR] Malformed frame from server" << std::endl;
+                client_running.store(false);
+                break;
+            }
+        } else {
+            size_t offset = 0;
+            while (pending.size() - offset >= sizeof(Message)) {
+                Message msg;
+                memcpy(&msg, pending.data() + offset, sizeof(Message));
+                offset += sizeof(Message);
+                
+                Frame frame = frame_from_message(msg);
+                display_message(frame.type, frame.sender, frame.payload, frame.timestamp);
+            }
+            pending.erase(0, offset);
+        }
+        
+        ssize_t bytes = recv(socket_fd, chunk, sizeof(chunk), 0);
         
         if (bytes <= 0) {
             // Connection closed or error
@@ -27,51 +92,11 @@ void receive_messages(int socket_fd) {
             }
             break;
         }
-        
-        if (bytes != sizeof(Message)) {
-            // Partial or invalid message received
-            continue;
-        }
-        
-        // Ensure null-terminated strings
-        msg.sender[sizeof(msg.sender) - 1] = '\0';
-        msg.payload[sizeof(msg.payload) - 1] = '\0';
-        
-        // Display message based on type
-        time_t timestamp = msg.timestamp;
-        char time_str[64];
-        struct tm* tm_info = localtime(&timestamp);
-        if (tm_info) {
-            strftime(time_str, sizeof(time_str), "%H:%M:%S", tm_info);
-        } else {
-            strncpy(time_str, "??:??:??", sizeof(time_str) - 1);
-        }
-        
-        switch (msg.type) {
-            case MSG_TEXT:
-                std::cout << "\n[" << time_str << "] " << msg.sender << ": " 
-                          << msg.payload << std::endl;
-                std::cout << "You: " << std::flush;
-                break;
-                
-            case MSG_JOIN:
-                std::cout << "\n[" << time_str << "] >>> " << msg.payload << std::endl;
-                std::cout << "You: " << std::flush;
-                break;
-                
-            case MSG_LEAVE:
-                std::cout << "\n[" << time_str << "] <<< " << msg.payload << std::endl;
-                std::cout << "You: " << std::flush;
-                break;
-                
-            default:
-                // Unknown message type, ignore
-                break;
-        }
+        pending.append(chunk, static_cast<size_t>(bytes));
     }
 }
 
-void send_messages(int socket_fd, const std::string& user_id) {
+void send_messages(int socket_fd, const std::string& user_id, bool framed) {
     std::string input;
     Message msg;
     
@@ -96,11 +121,19 @@ void send_messages(int socket_fd, const std::string& user_id) {
         if (input == "/help") {
             std::cout << "\nAvailable commands:" << std::endl;
             std::cout << "  /quit, /exit - Disconnect from chat" << std::endl;
+            std::cout << "  /join <room> - Move to another room (default: " << DEFAULT_ROOM << ")" << std::endl;
             std::cout << "  /help        - Show this help message" << std::endl;
             std::cout << std::endl;
             continue;
         }
         
+        // Room changes go out as ROOM_JOIN with the room name as payload
+        uint8_t type = MSG_TEXT;
+        if (input.compare(0, 6, "/join ") == 0) {
+            type = MSG_ROOM_JOIN;
+            input.erase(0, 6);
+        }
+        
         // Skip empty messages
         if (input.empty()) {
             continue;
@@ -114,13 +147,24 @@ void send_messages(int socket_fd, const std::string& user_id) {
         }
         
         // Send text message
-        memset(&msg, 0, sizeof(msg));
-        msg.type = MSG_TEXT;
-        msg.set_sender(user_id);
-        msg.set_payload(input);
-        msg.timestamp = time(nullptr);
+        ssize_t sent;
+        if (framed) {
+            // The server fills in the sender from the connection
+            Frame frame;
+            frame.type = type;
+            frame.payload = input;
+            frame.timestamp = time(nullptr);
+            std::string wire = encode_frame(frame);
+            sent = send(socket_fd, wire.data(), wire.size(), MSG_NOSIGNAL);
+        } else {
+            msg = Message();
+            msg.type = type;
+            msg.set_sender(user_id);
+            msg.set_payload(input);
+            msg.timestamp = time(nullptr);
+            sent = send(socket_fd, &msg, sizeof(Message), MSG_NOSIGNAL);
+        }
         
-        ssize_t sent = send(socket_fd, &msg, sizeof(Message), MSG_NOSIGNAL);
         if (sent <= 0) {
             std::cout << "\n[ERROR] Failed to send message" << std::endl;
             client_running.store(false);
@@ -130,7 +174,8 @@ void send_messages(int socket_fd, const std::string& user_id) {
 }
 
 bool connect_to_server(const std::string& server_ip, int server_port, 
-                       const std::string& user_id, int& client_socket) {
+                       const std::string& user_id, int& client_socket,
+                       bool& framed, std::string& pending) {
     // Create socket
     client_socket = socket(AF_INET, SOCK_STREAM, 0);
     if (client_socket < 0) {
@@ -161,14 +206,48 @@ bool connect_to_server(const std::string& server_ip, int server_port,
     
     std::cout << "Connected to server!" << std::endl;
     
-    // Send user ID to server
-    ssize_t sent = send(client_socket, user_id.c_str(), user_id.length(), MSG_NOSIGNAL);
+    // Send user ID to server, offering the framed protocol after it;
+    // servers without framing only read the name up to the terminator
+    std::string hello = user_id;
+    hello.push_back('\0');
+    hello.append(FRAMING_TAG, FRAMING_TAG_LEN);
+    ssize_t sent = send(client_socket, hello.data(), hello.size(), MSG_NOSIGNAL);
     if (sent <= 0) {
         std::cerr << "ERROR: Failed to send user ID to server" << std::endl;
         close(client_socket);
         return false;
     }
     
+    // Wait briefly for the framing acknowledgement
+    struct timeval tv;
+    tv.tv_sec = FRAMING_ACK_TIMEOUT_MS / 1000;
+    tv.tv_usec = (FRAMING_ACK_TIMEOUT_MS % 1000) * 1000;
+    setsockopt(client_socket, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    
+    framed = false;
+    pending.clear();
+    char ack[FRAMING_TAG_LEN];
+    while (pending.size() < FRAMING_TAG_LEN) {
+        ssize_t bytes = recv(client_socket, ack, FRAMING_TAG_LEN - pending.size(), 0);
+        if (bytes <= 0) {
+            break;
+        }
+        pending.append(ack, static_cast<size_t>(bytes));
+        if (pending.compare(0, pending.size(), FRAMING_TAG, pending.size()) != 0) {
+            break;
+        }
+    }
+    
+    if (pending.size() == FRAMING_TAG_LEN && pending.compare(0, FRAMING_TAG_LEN, FRAMING_TAG) == 0) {
+        framed = true;
+        pending.clear();
+    }
+    // Otherwise anything read belongs to the first legacy Message
+    
+    tv.tv_sec = 0;
+    tv.tv_usec = 0;
+    setsockopt(client_socket, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    
     return true;
 }
 
@@ -225,7 +304,9 @@ int main(int argc, char* argv[]) {
     }
     
     int client_socket;
-    if (!connect_to_server(server_ip, server_port, user_id, client_socket)) {
+    bool framed = false;
+    std::string pending;
+    if (!connect_to_server(server_ip, server_port, user_id, client_socket, framed, pending)) {
         return 1;
     }
     
@@ -234,10 +315,10 @@ int main(int argc, char* argv[]) {
     std::cout << "Type /quit to disconnect\n" << std::endl;
     
     // Start receiver thread
-    std::thread receiver_thread(receive_messages, client_socket);
+    std::thread receiver_thread(receive_messages, client_socket, framed, std::move(pending));
     
     // Main thread handles sending
-    send_messages(client_socket, user_id);
+    send_messages(client_socket, user_id, framed);
     
     // Cleanup
     std::cout << "\nDisconnecting from server..." << std::endl;
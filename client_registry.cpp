@@ -0,0 +1,125 @@
+#include "client_registry.h"
+#include <stdexcept>
+
+ClientRegistry::ClientRegistry(size_t fds)
+    : max_fds(fds), current(std::make_shared<const Snapshot>()), count(0) {
+    if (max_fds == 0) {
+        throw std::invalid_argument("Client registry needs room for at least one fd");
+    }
+
+    size_t page_count = (max_fds + PAGE_SLOTS - 1) / PAGE_SLOTS;
+    pages.reset(new std::atomic<Slot*>[page_count]);
+    for (size_t i = 0; i < page_count; ++i) {
+        pages[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+ClientRegistry::~ClientRegistry() {
+    size_t page_count = (max_fds + PAGE_SLOTS - 1) / PAGE_SLOTS;
+    for (size_t i = 0; i < page_count; ++i) {
+        delete[] pages[i].load(std::memory_order_relaxed);
+    }
+}
+
+ClientRegistry::Slot* ClientRegistry::find_slot(int fd) const {
+    if (fd < 0 || static_cast<size_t>(fd) >= max_fds) {
+        return nullptr;
+    }
+    Slot* page = pages[static_cast<size_t>(fd) >> PAGE_BITS].load(std::memory_order_acquire);
+    return page ? &page[static_cast<size_t>(fd) & (PAGE_SLOTS - 1)] : nullptr;
+}
+
+ClientRegistry::Slot* ClientRegistry::slot_for_write(int fd) {
+    if (fd < 0 || static_cast<size_t>(fd) >= max_fds) {
+        return nullptr;
+    }
+    std::atomic<Slot*>& entry = pages[static_cast<size_t>(fd) >> PAGE_BITS];
+    Slot* page = entry.load(std::memory_order_relaxed);
+    if (!page) {
+        page = new Slot[PAGE_SLOTS];
+        entry.store(page, std::memory_order_release);
+    }
+    return &page[static_cast<size_t>(fd) & (PAGE_SLOTS - 1)];
+}
+
+bool ClientRegistry::add(int fd, const ConnectionPtr& conn) {
+    std::lock_guard<std::mutex> lock(writer_mutex);
+
+    Slot* slot = slot_for_write(fd);
+    if (!slot || slot->conn.load(std::memory_order_relaxed) != nullptr) {
+        return false;
+    }
+
+    SnapshotPtr old = std::atomic_load(&current);
+    auto next = std::make_shared<Snapshot>();
+    next->members.reserve(old->members.size() + 1);
+    next->members = old->members;
+    next->members.push_back(conn);
+    next->version = old->version + 1;
+
+    slot->member_index = next->members.size() - 1;
+    slot->last_active.store(static_cast<int64_t>(time(nullptr)), std::memory_order_relaxed);
+    slot->conn.store(conn.get(), std::memory_order_release);
+    std::atomic_store(&current, SnapshotPtr(std::move(next)));
+    count.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool ClientRegistry::remove(int fd) {
+    std::lock_guard<std::mutex> lock(writer_mutex);
+
+    Slot* slot = find_slot(fd);
+    if (!slot || slot->conn.load(std::memory_order_relaxed) == nullptr) {
+        return false;
+    }
+
+    // Move the last member into the hole so the snapshot stays dense
+    SnapshotPtr old = std::atomic_load(&current);
+    auto next = std::make_shared<Snapshot>();
+    next->members = old->members;
+    next->version = old->version + 1;
+    size_t index = slot->member_index;
+    if (index + 1 != next->members.size()) {
+        next->members[index] = std::move(next->members.back());
+        find_slot(next->members[index]->socket_fd)->member_index = index;
+    }
+    next->members.pop_back();
+
+    slot->conn.store(nullptr, std::memory_order_release);
+    std::atomic_store(&current, SnapshotPtr(std::move(next)));
+    count.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+ClientRegistry::SnapshotPtr ClientRegistry::clear() {
+    std::lock_guard<std::mutex> lock(writer_mutex);
+
+    SnapshotPtr old = std::atomic_load(&current);
+    for (const auto& conn : old->members) {
+        find_slot(conn->socket_fd)->conn.store(nullptr, std::memory_order_release);
+    }
+    auto next = std::make_shared<Snapshot>();
+    next->version = old->version + 1;
+    std::atomic_store(&current, SnapshotPtr(std::move(next)));
+    count.store(0, std::memory_order_relaxed);
+    return old;
+}
+
+ClientRegistry::SnapshotPtr ClientRegistry::snapshot() const {
+    return std::atomic_load(&current);
+}
+
+void ClientRegistry::touch(int fd, time_t now) {
+    Slot* slot = find_slot(fd);
+    if (slot) {
+        slot->last_active.store(static_cast<int64_t>(now), std::memory_order_relaxed);
+    }
+}
+
+time_t ClientRegistry::get_last_active(int fd) const {
+    Slot* slot = find_slot(fd);
+    if (!slot || slot->conn.load(std::memory_order_acquire) == nullptr) {
+        return 0;
+    }
+    return static_cast<time_t>(slot->last_active.load(std::memory_order_relaxed));
+}
@@ -0,0 +1,83 @@
+#ifndef CLIENT_REGISTRY_H
+#define CLIENT_REGISTRY_H
+
+#include "common.h"
+#include "connection.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * Registered clients, indexed by socket fd
+ * File descriptors are small dense integers, so clients live in a flat table
+ * of fixed-size pages addressed directly by fd; pages are allocated on first
+ * use and never move, so per-slot state (last activity) is read and updated
+ * with plain atomics and no lock.
+ *
+ * Broadcasts walk an immutable, contiguous snapshot of the members instead of
+ * the table. Joins and leaves serialize on a writer mutex, copy the current
+ * snapshot with the change applied and publish it (read-copy-update); readers
+ * just take a reference to whichever snapshot is current, so they never wait
+ * for registration and the old snapshot goes away with its last reader.
+ */
+class ClientRegistry {
+public:
+    using ConnectionPtr = std::shared_ptr<Connection>;
+
+    struct Snapshot {
+        std::vector<ConnectionPtr> members;
+        uint64_t version;
+
+        Snapshot() : version(0) {}
+    };
+    using SnapshotPtr = std::shared_ptr<const Snapshot>;
+
+private:
+    static constexpr int PAGE_BITS = 10;
+    static constexpr size_t PAGE_SLOTS = size_t(1) << PAGE_BITS;
+
+    struct Slot {
+        std::atomic<Connection*> conn;  // owned through the current snapshot
+        std::atomic<int64_t> last_active;
+        size_t member_index;            // position in the snapshot, writers only
+
+        Slot() : conn(nullptr), last_active(0), member_index(0) {}
+    };
+
+    size_t max_fds;
+    std::unique_ptr<std::atomic<Slot*>[]> pages;
+    std::mutex writer_mutex;
+    SnapshotPtr current;  // accessed with std::atomic_load/atomic_store
+    std::atomic<size_t> count;
+
+    Slot* find_slot(int fd) const;
+    Slot* slot_for_write(int fd);
+
+public:
+    explicit ClientRegistry(size_t max_fds = CLIENT_REGISTRY_MAX_FDS);
+    ~ClientRegistry();
+
+    // Delete copy constructor and assignment operator
+    ClientRegistry(const ClientRegistry&) = delete;
+    ClientRegistry& operator=(const ClientRegistry&) = delete;
+
+    // false if the fd is out of range or already registered
+    bool add(int fd, const ConnectionPtr& conn);
+
+    // false if nothing was registered under the fd
+    bool remove(int fd);
+
+    // Drop every client; returns the members as they were
+    SnapshotPtr clear();
+
+    // The current members; never blocks and stays valid while held
+    SnapshotPtr snapshot() const;
+
+    void touch(int fd, time_t now);
+    time_t get_last_active(int fd) const;
+
+    size_t size() const { return count.load(std::memory_order_relaxed); }
+};
+
+#endif
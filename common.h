@@ -8,12 +8,52 @@
 
 // Server configuration
 constexpr int SERVER_PORT = 8080;
-constexpr int MAX_CLIENTS = 50;
+constexpr int STATS_PORT = 9100;  // Prometheus text endpoint
+constexpr int MAX_CLIENTS = 4096;
+constexpr size_t CLIENT_REGISTRY_MAX_FDS = 65536;  // fds at or above this cannot register
 constexpr int THREAD_POOL_SIZE = 6;
+constexpr int IO_THREAD_COUNT = 2;
+constexpr int ACCEPT_BATCH_SIZE = 32;  // connections accepted per listener wakeup before serving I/O
+constexpr size_t WORKER_DEQUE_CAPACITY = 256;  // per-worker local queue in work-stealing mode
+constexpr size_t THREAD_POOL_QUEUE_CAPACITY = 4096;  // lock-free shared ring, power of two
+constexpr size_t THREAD_POOL_BULK_CHUNK = 32;        // tasks staged per ring claim in enqueue_bulk
+constexpr size_t TASK_INLINE_SIZE = 64;  // closure bytes stored without a heap allocation
 constexpr int BUFFER_SIZE = 4096;
 constexpr int CACHE_SIZE = 10;
+constexpr int CACHE_SHARD_COUNT = 8;
+constexpr size_t PAYLOAD_SLAB_CHUNK_BYTES = 16 * 1024;  // slab growth step per size class
+constexpr char DEFAULT_ROOM[] = "lobby";  // every client starts here
+constexpr size_t ROOM_NAME_MAX_LEN = 32;
+constexpr size_t MAX_ROOMS = 1024;
+constexpr int ROOM_CACHE_SIZE = CACHE_SIZE;  // per-room message cache partition
+constexpr int ROOM_CACHE_SHARD_COUNT = CACHE_SHARD_COUNT;  // lock stripes per room partition
+constexpr int CACHE_WINDOW_PERCENT = 1;       // TinyLFU: admission window share of capacity
+constexpr int CACHE_PROTECTED_PERCENT = 80;   // TinyLFU: protected share of the main segment
+constexpr size_t ROOM_CACHE_BYTE_BUDGET = 32 * 1024;  // payload bytes per room partition, 0 = entries only
+constexpr time_t ROOM_CACHE_TTL_S = 600;              // entries older than this are dropped, 0 = never
+constexpr size_t CACHE_SWEEP_BATCH = 64;              // slots the expiry sweeper visits per cache per tick
+constexpr size_t CACHE_BATCH_STACK_SIZE = 32;         // batched cache calls up to this size never allocate
+constexpr size_t HISTORY_RING_BYTES = 1024 * 1024;  // payload bytes kept for history replay
+constexpr size_t HISTORY_MAX_RECORDS = 4096;        // power of two
+constexpr size_t HISTORY_REPLAY_COUNT = 20;         // messages replayed to a joining client
+constexpr char MESSAGE_LOG_DIR[] = "message_log";
+constexpr size_t MESSAGE_LOG_SEGMENT_BYTES = 16 * 1024 * 1024;  // rotate when a segment fills
+constexpr size_t MESSAGE_LOG_MAX_SEGMENTS = 8;                  // older segments are deleted
+constexpr time_t MESSAGE_LOG_SEGMENT_MAX_AGE_S = 3600;          // rotate a segment after an hour
+constexpr int MESSAGE_LOG_SYNC_INTERVAL_MS = 1000;              // msync(MS_ASYNC) period
 constexpr int TIME_QUANTUM_MS = 100;
+constexpr size_t SCHEDULER_QUANTUM_BYTES = 8192;  // per-turn DRR budget at weight 1
 constexpr int USERNAME_MAX_LEN = 63;  // 64 - 1 for null terminator
+constexpr size_t OUTBOUND_HIGH_WATER_BYTES = 1024 * 1024;  // per-client send queue limit
+constexpr int OUTBOUND_FLUSH_DELAY_US = 200;  // max time queued output waits to be coalesced
+constexpr int TIMER_TICK_MS = 100;           // reactor timer wheel resolution
+constexpr int CLIENT_IDLE_TIMEOUT_S = 300;   // close clients whose peer neither sends nor ACKs this long
+constexpr int HEARTBEAT_INTERVAL_S = 30;     // send a STATUS frame after this long without output
+constexpr int KEEPALIVE_PROBES = 4;          // unanswered TCP keepalives before the kernel drops a peer
+constexpr int SLOW_WRITE_TIMEOUT_S = 10;     // close clients whose queued output stalls this long
+constexpr size_t LOG_RING_CAPACITY = 4096;  // queued log lines before new ones are dropped
+constexpr size_t LOG_ENTRY_SIZE = 480;      // longer log messages are truncated
+constexpr int RESOURCE_SAMPLE_INTERVAL_MS = 1000;  // getrusage / procfs sampling period
 
 // Message types
 enum class MessageType : uint8_t {
@@ -23,7 +63,8 @@ enum class MessageType : uint8_t {
     AUDIO = 0x04,
     VIDEO = 0x05,
     STATUS = 0x06,
-    CACHE_TEST = 0x07  // New type for cache testing
+    CACHE_TEST = 0x07,  // New type for cache testing
+    ROOM_JOIN = 0x08    // payload is the room name; moves the client there
 };
 
 // Legacy defines for backward compatibility
@@ -34,6 +75,7 @@ enum class MessageType : uint8_t {
 #define MSG_VIDEO static_cast<uint8_t>(MessageType::VIDEO)
 #define MSG_STATUS static_cast<uint8_t>(MessageType::STATUS)
 #define MSG_CACHE_TEST static_cast<uint8_t>(MessageType::CACHE_TEST)
+#define MSG_ROOM_JOIN static_cast<uint8_t>(MessageType::ROOM_JOIN)
 
 // Message structure with better memory alignment
 struct Message {
@@ -65,44 +107,54 @@ struct Message {
     }
 };
 
-// Cache entry structure
-struct CacheEntry {
-    std::string message_id;
-    std::string content;
-    std::string sender;
-    time_t timestamp;
-    time_t last_access;
-    int access_count;
-    bool valid;
+// Payload bytes owned by a PayloadSlab; trivially copyable handle
+struct PayloadRef {
+    char* data;          // nullptr for an empty payload
+    uint32_t length;
+    uint8_t size_class;  // slab class the slot came from
     
-    CacheEntry() : timestamp(0), last_access(0), access_count(0), valid(false) {}
+    PayloadRef() : data(nullptr), length(0), size_class(0) {}
+};
+
+// How a full MessageCache decides what to keep
+enum class CacheAdmission : uint8_t {
+    LRU,      // every insert is admitted, the least recently used entry goes
+    TINY_LFU  // W-TinyLFU: a newcomer displaces an entry only if used more often
 };
 
+constexpr CacheAdmission ROOM_CACHE_ADMISSION = CacheAdmission::LRU;
+
 // Client information
 struct ClientInfo {
     int socket_fd;
     std::string user_id;
     time_t connect_time;
-    time_t last_active;
     bool active;
     
-    ClientInfo() : socket_fd(-1), connect_time(0), last_active(0), active(false) {}
+    ClientInfo() : socket_fd(-1), connect_time(0), active(false) {}
 };
 
 // Performance metrics
 struct PerformanceMetrics {
     uint64_t messages_sent;
     uint64_t messages_received;
+    uint64_t send_calls;
     uint64_t cache_hits;
     uint64_t cache_misses;
     uint64_t page_faults_minor;
     uint64_t page_faults_major;
+    uint64_t rss_bytes;
+    uint64_t peak_rss_bytes;
+    uint64_t voluntary_switches;
+    uint64_t involuntary_switches;
     int active_threads;
     int active_clients;
     
-    PerformanceMetrics() : messages_sent(0), messages_received(0), 
+    PerformanceMetrics() : messages_sent(0), messages_received(0), send_calls(0),
                            cache_hits(0), cache_misses(0),
                            page_faults_minor(0), page_faults_major(0),
+                           rss_bytes(0), peak_rss_bytes(0),
+                           voluntary_switches(0), involuntary_switches(0),
                            active_threads(0), active_clients(0) {}
 };
 
@@ -0,0 +1,115 @@
+#ifndef CONNECTION_H
+#define CONNECTION_H
+
+#include "common.h"
+#include "protocol.h"
+#include "timer_wheel.h"
+#include <string>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <unistd.h>
+
+// Immutable encoded bytes, shared by every recipient of a broadcast
+using SharedBuffer = std::shared_ptr<const std::string>;
+
+// Work items queued for a client, processed in arrival order by a worker
+enum class InboundKind : uint8_t {
+    HANDSHAKE,  // username received, client should be registered
+    MESSAGE,    // complete message received from the client
+    CLOSE       // connection closed, client should be unregistered
+};
+
+struct InboundEvent {
+    InboundKind kind;
+    Frame frame;
+    uint64_t received_ns;  // monotonic time the bytes were read
+
+    explicit InboundEvent(InboundKind k) : kind(k), received_ns(0) {}
+};
+
+struct Connection;
+struct Room;
+
+// Deadlines the reactor keeps per connection
+enum class TimerKind : uint8_t {
+    IDLE,        // nothing received for the idle timeout
+    HEARTBEAT,   // nothing sent for the heartbeat interval
+    SLOW_WRITE   // queued output made no progress for the write timeout
+};
+
+// Timers are never cancelled from other threads, so they only hold a weak
+// reference and retire on their next expiry once the connection is gone
+struct ConnectionTimer {
+    std::weak_ptr<Connection> conn;
+    TimerKind kind;
+    uint64_t armed_ns;  // monotonic time the timer was (re)armed
+
+    ConnectionTimer() : kind(TimerKind::IDLE), armed_ns(0) {}
+    ConnectionTimer(std::weak_ptr<Connection> c, TimerKind k, uint64_t armed)
+        : conn(std::move(c)), kind(k), armed_ns(armed) {}
+};
+
+using ConnectionTimerWheel = TimerWheel<ConnectionTimer>;
+
+/**
+ * Per-socket state shared between the reactor I/O threads and the worker
+ * threads that process the client's messages. The socket is closed when the
+ * last reference goes away, so a file descriptor is never reused while a
+ * worker still holds the connection.
+ */
+struct Connection {
+    const int socket_fd;
+    int io_thread;
+
+    // Touched only by the owning reactor thread
+    std::string read_buffer;
+    bool handshake_done;
+    FrameDecoder decoder;
+    uint64_t last_read_ns;    // monotonic time of the last received bytes
+    bool timers_armed;
+    bool write_timer_armed;
+
+    // Negotiated during the handshake, before the client is registered
+    bool framed;
+
+    // Touched only by the worker currently draining the inbound queue
+    ClientInfo info;
+    uint32_t sender_id;  // interned info.user_id, 0 until registered
+    bool registered;
+    std::shared_ptr<Room> room;  // where the client's messages go, set once registered
+
+    // Messages waiting for a worker; the scheduler decides when they run
+    std::mutex inbound_mutex;
+    std::deque<InboundEvent> inbound;
+
+    // Buffers waiting to be written by the owning reactor thread; send_gather
+    // may also write directly, under the lock, while none are queued or in flight
+    std::mutex outbound_mutex;
+    std::deque<SharedBuffer> outbound;
+    size_t outbound_offset;  // bytes of outbound.front() already written
+    size_t outbound_bytes;   // total bytes still queued
+    bool send_in_flight;     // an io_uring send owns the front of outbound
+    std::atomic<bool> flush_scheduled;
+    std::atomic<uint64_t> last_write_ns;  // also stamped by direct writes from send_gather
+
+    std::atomic<bool> closed;
+
+    explicit Connection(int fd)
+        : socket_fd(fd), io_thread(0), handshake_done(false), last_read_ns(0), timers_armed(false),
+          write_timer_armed(false), framed(false), sender_id(0), registered(false),
+          outbound_offset(0), outbound_bytes(0), send_in_flight(false), flush_scheduled(false), last_write_ns(0),
+          closed(false) {}
+
+    ~Connection() {
+        if (socket_fd >= 0) {
+            close(socket_fd);
+        }
+    }
+
+    Connection(const Connection&) = delete;
+    Connection& operator=(const Connection&) = delete;
+};
+
+#endif
@@ -0,0 +1,85 @@
+#include "frequency_sketch.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+// One odd multiplier per row; the mixed key picks a word and a nibble
+constexpr uint64_t ROW_SEEDS[4] = {
+    0x9e3779b97f4a7c15ULL, 0xc2b2ae3d27d4eb4fULL, 0x165667b19e3779f9ULL, 0xd6e8feb86659fd93ULL
+};
+
+uint64_t mix(uint64_t key, uint64_t seed) {
+    key = (key ^ (key >> 32)) * seed;
+    key ^= key >> 29;
+    key *= 0xbf58476d1ce4e5b9ULL;
+    return key ^ (key >> 32);
+}
+}
+
+FrequencySketch::FrequencySketch(size_t capacity) : table_mask(0), sample_size(0), additions(0), resets(0) {
+    if (capacity == 0 || capacity > (1u << 30)) {
+        throw std::invalid_argument("Sketch capacity must be between 1 and 2^30");
+    }
+    size_t words = 1;
+    while (words < capacity) {
+        words <<= 1;
+    }
+    table.assign(words, 0);
+    table_mask = words - 1;
+    sample_size = static_cast<uint32_t>(std::min<size_t>(capacity * 10, UINT32_MAX));
+}
+
+void FrequencySketch::locate(uint64_t key, int i, size_t& word, int& shift) const {
+    uint64_t hash = mix(key, ROW_SEEDS[i]);
+    word = static_cast<size_t>(hash & table_mask);
+    // Rows use disjoint quarters of the word so one key's counters never overlap
+    shift = static_cast<int>(((hash >> 60) & 3) + i * 4) * 4;
+}
+
+void FrequencySketch::increment(uint64_t key) {
+    size_t words[4];
+    int shifts[4];
+    int minimum = MAX_FREQUENCY;
+    for (int i = 0; i < 4; ++i) {
+        locate(key, i, words[i], shifts[i]);
+        minimum = std::min(minimum, static_cast<int>((table[words[i]] >> shifts[i]) & 0xf));
+    }
+    if (minimum == MAX_FREQUENCY) {
+        return;
+    }
+
+    for (int i = 0; i < 4; ++i) {
+        if (static_cast<int>((table[words[i]] >> shifts[i]) & 0xf) == minimum) {
+            table[words[i]] += uint64_t(1) << shifts[i];
+        }
+    }
+    if (++additions >= sample_size) {
+        age();
+    }
+}
+
+int FrequencySketch::frequency(uint64_t key) const {
+    int minimum = MAX_FREQUENCY;
+    for (int i = 0; i < 4; ++i) {
+        size_t word;
+        int shift;
+        locate(key, i, word, shift);
+        minimum = std::min(minimum, static_cast<int>((table[word] >> shift) & 0xf));
+    }
+    return minimum;
+}
+
+void FrequencySketch::age() {
+    // Halve every counter at once: shift the word, drop the bit each
+    // nibble received from its neighbour
+    for (uint64_t& word : table) {
+        word = (word >> 1) & 0x7777777777777777ULL;
+    }
+    additions /= 2;
+    resets++;
+}
+
+void FrequencySketch::clear() {
+    std::fill(table.begin(), table.end(), 0);
+    additions = 0;
+}
@@ -0,0 +1,48 @@
+#ifndef FREQUENCY_SKETCH_H
+#define FREQUENCY_SKETCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Count-min sketch of recent access frequencies, for TinyLFU admission
+ * Four 4-bit counters per key, each in a different 64-bit word of a table
+ * sized to the next power of two at or above the cache capacity, so the
+ * whole history of a cache costs 8 bytes per entry. Increments are
+ * conservative: only the counters at the current minimum go up, which
+ * keeps colliding keys from inflating each other. After 10 x capacity
+ * increments every counter is halved, so old popularity fades.
+ *
+ * Not thread-safe; each MessageCache owns one and uses it under its lock.
+ */
+class FrequencySketch {
+public:
+    static constexpr int MAX_FREQUENCY = 15;
+
+private:
+    std::vector<uint64_t> table;
+    uint64_t table_mask;
+    uint32_t sample_size;  // increments between agings
+    uint32_t additions;
+    uint64_t resets;
+
+    // Word and nibble of the key's i-th counter
+    void locate(uint64_t key, int i, size_t& word, int& shift) const;
+    void age();
+
+public:
+    explicit FrequencySketch(size_t capacity);
+
+    // Record one access to key
+    void increment(uint64_t key);
+
+    // Estimated accesses since the last aging or two, 0..MAX_FREQUENCY
+    int frequency(uint64_t key) const;
+
+    void clear();
+    uint64_t get_resets() const { return resets; }
+    size_t get_bytes() const { return table.size() * sizeof(uint64_t); }
+};
+
+#endif
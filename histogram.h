@@ -0,0 +1,131 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Monotonic clock in nanoseconds for latency measurements
+inline uint64_t monotonic_ns() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+/**
+ * HDR-style log-linear latency histogram
+ * Values below 2^SUB_BUCKET_BITS get one bucket each; above that every power
+ * of two is split into 2^SUB_BUCKET_BITS equal sub-buckets, so a reported
+ * percentile is within ~3% of the true value. Values past the last
+ * magnitude (~18 minutes in ns) are clamped into the top bucket.
+ *
+ * record() is meant for a single writer thread (plain relaxed load/store, no
+ * read-modify-write); merge_into() may run concurrently from any thread.
+ */
+class LatencyHistogram {
+public:
+    static constexpr int SUB_BUCKET_BITS = 5;
+    static constexpr uint64_t SUB_BUCKETS = 1ULL << SUB_BUCKET_BITS;
+    static constexpr int MAX_MAGNITUDE = 40;
+    static constexpr size_t BUCKET_COUNT = static_cast<size_t>(MAX_MAGNITUDE + 1) * SUB_BUCKETS;
+
+    static size_t bucket_index(uint64_t value) {
+        if (value < SUB_BUCKETS) {
+            return static_cast<size_t>(value);
+        }
+        int magnitude = 63 - __builtin_clzll(value) - SUB_BUCKET_BITS;  // >= 0
+        if (magnitude >= MAX_MAGNITUDE) {
+            return BUCKET_COUNT - 1;
+        }
+        uint64_t sub = (value >> magnitude) - SUB_BUCKETS;
+        return static_cast<size_t>(magnitude + 1) * SUB_BUCKETS + static_cast<size_t>(sub);
+    }
+
+    // Largest value that maps to the bucket
+    static uint64_t bucket_upper_bound(size_t index) {
+        if (index < SUB_BUCKETS) {
+            return index;
+        }
+        int magnitude = static_cast<int>(index / SUB_BUCKETS) - 1;
+        uint64_t sub = index % SUB_BUCKETS;
+        return ((SUB_BUCKETS + sub + 1) << magnitude) - 1;
+    }
+
+private:
+    std::atomic<uint64_t> counts[BUCKET_COUNT];
+    std::atomic<uint64_t> total;
+    std::atomic<uint64_t> sum;
+    std::atomic<uint64_t> max;
+
+    static void bump(std::atomic<uint64_t>& cell, uint64_t delta) {
+        cell.store(cell.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+    }
+
+public:
+    LatencyHistogram() : total(0), sum(0), max(0) {
+        for (auto& count : counts) {
+            count.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    // Delete copy constructor and assignment operator
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    void record(uint64_t value) {
+        bump(counts[bucket_index(value)], 1);
+        bump(total, 1);
+        bump(sum, value);
+        if (value > max.load(std::memory_order_relaxed)) {
+            max.store(value, std::memory_order_relaxed);
+        }
+    }
+
+    struct Snapshot {
+        std::vector<uint64_t> counts;
+        uint64_t total;
+        uint64_t sum;
+        uint64_t max;
+
+        Snapshot() : counts(BUCKET_COUNT, 0), total(0), sum(0), max(0) {}
+
+        // p in [0, 100]; 0 when empty
+        uint64_t percentile(double p) const {
+            if (total == 0) {
+                return 0;
+            }
+            uint64_t rank = static_cast<uint64_t>(p / 100.0 * static_cast<double>(total) + 0.5);
+            if (rank == 0) {
+                rank = 1;
+            }
+            uint64_t seen = 0;
+            for (size_t i = 0; i < counts.size(); ++i) {
+                seen += counts[i];
+                if (seen >= rank) {
+                    uint64_t bound = bucket_upper_bound(i);
+                    return bound < max ? bound : max;
+                }
+            }
+            return max;
+        }
+
+        double mean() const {
+            return total ? static_cast<double>(sum) / static_cast<double>(total) : 0.0;
+        }
+    };
+
+    void merge_into(Snapshot& snapshot) const {
+        for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+            snapshot.counts[i] += counts[i].load(std::memory_order_relaxed);
+        }
+        snapshot.total += total.load(std::memory_order_relaxed);
+        snapshot.sum += sum.load(std::memory_order_relaxed);
+        uint64_t m = max.load(std::memory_order_relaxed);
+        if (m > snapshot.max) {
+            snapshot.max = m;
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,156 @@
+#include "history_store.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+HistoryStore::HistoryStore(size_t bytes, size_t records)
+    : ring_bytes(bytes), max_records(records), write_position(0),
+      next_sequence(0), oldest_sequence(0) {
+    if (ring_bytes == 0) {
+        throw std::invalid_argument("History ring size must be positive");
+    }
+    if (max_records == 0 || (max_records & (max_records - 1)) != 0) {
+        throw std::invalid_argument("History record count must be a power of two");
+    }
+
+    ring.reset(new char[ring_bytes]);
+    timestamps.reset(new std::atomic<int64_t>[max_records]);
+    sender_ids.reset(new std::atomic<uint32_t>[max_records]);
+    room_ids.reset(new std::atomic<uint32_t>[max_records]);
+    types.reset(new std::atomic<uint8_t>[max_records]);
+    offsets.reset(new std::atomic<uint64_t>[max_records]);
+    lengths.reset(new std::atomic<uint32_t>[max_records]);
+    for (size_t i = 0; i < max_records; ++i) {
+        timestamps[i].store(0, std::memory_order_relaxed);
+        sender_ids[i].store(0, std::memory_order_relaxed);
+        room_ids[i].store(0, std::memory_order_relaxed);
+        types[i].store(0, std::memory_order_relaxed);
+        offsets[i].store(0, std::memory_order_relaxed);
+        lengths[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+uint64_t HistoryStore::append(uint8_t type, uint32_t sender_id, time_t timestamp,
+                              const char* payload, size_t length, uint32_t room_id) {
+    std::lock_guard<std::mutex> lock(writer_mutex);
+
+    length = std::min(length, ring_bytes);
+
+    // A payload never wraps: if it would cross the end, start it at the front
+    uint64_t position = write_position;
+    size_t physical = static_cast<size_t>(position % ring_bytes);
+    if (physical + length > ring_bytes) {
+        position += ring_bytes - physical;
+        physical = 0;
+    }
+    uint64_t end = position + length;
+
+    // Retire every record whose bytes the new payload will cover, and the one
+    // whose metadata slot it takes, before touching either
+    uint64_t sequence = next_sequence.load(std::memory_order_relaxed);
+    uint64_t oldest = oldest_sequence.load(std::memory_order_relaxed);
+    uint64_t retained_from = end > ring_bytes ? end - ring_bytes : 0;
+    uint64_t new_oldest = oldest;
+    while (new_oldest < sequence &&
+           offsets[slot(new_oldest)].load(std::memory_order_relaxed) < retained_from) {
+        new_oldest++;
+    }
+    if (sequence - new_oldest >= max_records) {
+        new_oldest = sequence - max_records + 1;
+    }
+    if (new_oldest != oldest) {
+        oldest_sequence.store(new_oldest, std::memory_order_relaxed);
+        // Readers who see the old bytes below must also see the retirement
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    if (length > 0) {
+        memcpy(ring.get() + physical, payload, length);
+    }
+
+    size_t index = slot(sequence);
+    timestamps[index].store(static_cast<int64_t>(timestamp), std::memory_order_relaxed);
+    sender_ids[index].store(sender_id, std::memory_order_relaxed);
+    room_ids[index].store(room_id, std::memory_order_relaxed);
+    types[index].store(type, std::memory_order_relaxed);
+    offsets[index].store(position, std::memory_order_relaxed);
+    lengths[index].store(static_cast<uint32_t>(length), std::memory_order_relaxed);
+
+    write_position = end;
+    next_sequence.store(sequence + 1, std::memory_order_release);
+    return sequence;
+}
+
+bool HistoryStore::read_record(uint64_t sequence, HistoryRecord& record) const {
+    if (sequence < oldest_sequence.load(std::memory_order_acquire)) {
+        return false;
+    }
+
+    size_t index = slot(sequence);
+    uint64_t offset = offsets[index].load(std::memory_order_relaxed);
+    uint32_t length = lengths[index].load(std::memory_order_relaxed);
+    size_t physical = static_cast<size_t>(offset % ring_bytes);
+
+    record.sequence = sequence;
+    record.timestamp = static_cast<time_t>(timestamps[index].load(std::memory_order_relaxed));
+    record.sender_id = sender_ids[index].load(std::memory_order_relaxed);
+    record.room_id = room_ids[index].load(std::memory_order_relaxed);
+    record.type = types[index].load(std::memory_order_relaxed);
+
+    // Metadata torn by a concurrent overwrite can point anywhere; never build such a view
+    if (physical + length > ring_bytes || !is_intact(sequence)) {
+        return false;
+    }
+    record.payload = std::string_view(ring.get() + physical, length);
+    return true;
+}
+
+uint64_t HistoryStore::first_since(time_t since, uint64_t oldest, uint64_t newest) const {
+    // Broadcast timestamps come from one clock and are appended in order, so
+    // binary search; a racing overwrite only makes the start approximate
+    uint64_t low = oldest;
+    uint64_t high = newest;
+    while (low < high) {
+        uint64_t mid = low + (high - low) / 2;
+        time_t stamp = static_cast<time_t>(timestamps[slot(mid)].load(std::memory_order_relaxed));
+        if (stamp < since) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+uint64_t HistoryStore::first_recent_in_room(uint32_t room_id, size_t count, uint64_t oldest,
+                                            uint64_t newest) const {
+    // Walk back until count of the room's records are behind us; a racing
+    // overwrite only makes the start approximate, as with first_since
+    uint64_t sequence = newest;
+    size_t found = 0;
+    while (sequence > oldest && found < count) {
+        --sequence;
+        if (room_ids[slot(sequence)].load(std::memory_order_relaxed) == room_id) {
+            found++;
+        }
+    }
+    return sequence;
+}
+
+size_t HistoryStore::read_since(time_t since, std::vector<HistoryRecord>& out, size_t max_count) const {
+    size_t added = 0;
+    if (max_count == 0) {
+        return 0;
+    }
+    for_each_since(since, [&](const HistoryRecord& record) {
+        out.push_back(record);
+        return ++added < max_count;
+    });
+    return added;
+}
+
+size_t HistoryStore::get_record_count() const {
+    uint64_t oldest = oldest_sequence.load(std::memory_order_acquire);
+    uint64_t newest = next_sequence.load(std::memory_order_acquire);
+    return newest > oldest ? static_cast<size_t>(newest - oldest) : 0;
+}
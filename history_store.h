@@ -0,0 +1,148 @@
+#ifndef HISTORY_STORE_H
+#define HISTORY_STORE_H
+
+#include "common.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+// One message as seen by a reader; payload points into the store's ring
+struct HistoryRecord {
+    uint64_t sequence;
+    time_t timestamp;
+    uint32_t sender_id;  // index into the SenderTable
+    uint32_t room_id;    // 0 is the default room
+    uint8_t type;
+    std::string_view payload;
+};
+
+/**
+ * Append-only chat history in one preallocated byte ring
+ * Payload bytes are laid out back to back in a contiguous ring; per-record
+ * metadata (timestamp, sender, room, type, offset, length) is kept as parallel
+ * arrays indexed by sequence number. Old records are overwritten once either
+ * the ring bytes or the metadata slots run out.
+ *
+ * Writers serialize on a mutex among themselves but never wait for readers.
+ * Readers take no lock: before reusing space the writer advances
+ * oldest_sequence, so a reader that finishes with a record checks
+ * is_intact(sequence) and knows whether the bytes it saw could have been
+ * overwritten meanwhile (the seqlock idea, per record).
+ */
+class HistoryStore {
+private:
+    size_t ring_bytes;
+    size_t max_records;  // power of two
+    std::unique_ptr<char[]> ring;
+
+    // Structure-of-arrays metadata, slot = sequence & (max_records - 1).
+    // Relaxed atomics: readers may race with the writer and validate afterwards.
+    std::unique_ptr<std::atomic<int64_t>[]> timestamps;
+    std::unique_ptr<std::atomic<uint32_t>[]> sender_ids;
+    std::unique_ptr<std::atomic<uint32_t>[]> room_ids;
+    std::unique_ptr<std::atomic<uint8_t>[]> types;
+    std::unique_ptr<std::atomic<uint64_t>[]> offsets;  // logical byte position
+    std::unique_ptr<std::atomic<uint32_t>[]> lengths;
+
+    std::mutex writer_mutex;
+    uint64_t write_position;                  // logical byte position of the next payload
+    std::atomic<uint64_t> next_sequence;      // published after a record is complete
+    std::atomic<uint64_t> oldest_sequence;    // first record whose bytes are still intact
+
+    size_t slot(uint64_t sequence) const { return static_cast<size_t>(sequence & (max_records - 1)); }
+    bool read_record(uint64_t sequence, HistoryRecord& record) const;
+    uint64_t first_since(time_t since, uint64_t oldest, uint64_t newest) const;
+    uint64_t first_recent_in_room(uint32_t room_id, size_t count, uint64_t oldest, uint64_t newest) const;
+
+    template <typename F>
+    size_t for_each_from(uint64_t sequence, uint64_t newest, F& fn) const {
+        size_t visited = 0;
+        HistoryRecord record;
+        for (; sequence < newest; ++sequence) {
+            if (!read_record(sequence, record)) {
+                // Overtaken by the writer; skip ahead to what still exists
+                uint64_t oldest = oldest_sequence.load(std::memory_order_acquire);
+                if (oldest > sequence + 1) {
+                    sequence = oldest - 1;
+                }
+                continue;
+            }
+            visited++;
+            if (!fn(record)) {
+                break;
+            }
+        }
+        return visited;
+    }
+
+public:
+    HistoryStore(size_t ring_bytes = HISTORY_RING_BYTES, size_t max_records = HISTORY_MAX_RECORDS);
+
+    // Delete copy constructor and assignment operator
+    HistoryStore(const HistoryStore&) = delete;
+    HistoryStore& operator=(const HistoryStore&) = delete;
+
+    // Returns the record's sequence number; payloads larger than the ring are truncated
+    uint64_t append(uint8_t type, uint32_t sender_id, time_t timestamp,
+                    const char* payload, size_t length, uint32_t room_id = 0);
+
+    // Call after using a record: false if it may have been overwritten while read
+    bool is_intact(uint64_t sequence) const {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return sequence >= oldest_sequence.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Calls fn(const HistoryRecord&) for each record with timestamp >= since,
+     * oldest first, without copying payloads. fn returns false to stop early.
+     * The views are only valid while is_intact(record.sequence) holds, so a
+     * caller that keeps them past the callback must check before trusting them.
+     * Returns how many records were visited.
+     */
+    template <typename F>
+    size_t for_each_since(time_t since, F&& fn) const {
+        uint64_t newest = next_sequence.load(std::memory_order_acquire);
+        uint64_t oldest = oldest_sequence.load(std::memory_order_acquire);
+        return for_each_from(first_since(since, oldest, newest), newest, fn);
+    }
+
+    // Same contract as for_each_since, over the last count records
+    template <typename F>
+    size_t for_each_recent(size_t count, F&& fn) const {
+        uint64_t newest = next_sequence.load(std::memory_order_acquire);
+        uint64_t oldest = oldest_sequence.load(std::memory_order_acquire);
+        uint64_t start = newest - std::min<uint64_t>(count, newest - std::min(oldest, newest));
+        return for_each_from(start, newest, fn);
+    }
+
+    // Same contract as for_each_since, over the last count records of one room. Only metadata is
+    // scanned to find where they start; other rooms' payloads are never read.
+    template <typename F>
+    size_t for_each_recent_in_room(uint32_t room_id, size_t count, F&& fn) const {
+        uint64_t newest = next_sequence.load(std::memory_order_acquire);
+        uint64_t oldest = oldest_sequence.load(std::memory_order_acquire);
+        size_t matched = 0;
+        auto in_room = [&](const HistoryRecord& record) {
+            if (record.room_id != room_id) {
+                return true;
+            }
+            matched++;
+            return static_cast<bool>(fn(record));
+        };
+        for_each_from(first_recent_in_room(room_id, count, oldest, newest), newest, in_room);
+        return matched;
+    }
+
+    // Span-style read: up to max_count records since the timestamp, appended to out
+    size_t read_since(time_t since, std::vector<HistoryRecord>& out, size_t max_count) const;
+
+    uint64_t get_next_sequence() const { return next_sequence.load(std::memory_order_acquire); }
+    uint64_t get_oldest_sequence() const { return oldest_sequence.load(std::memory_order_acquire); }
+    size_t get_record_count() const;
+    size_t get_ring_bytes() const { return ring_bytes; }
+};
+
+#endif
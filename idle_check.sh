@@ -0,0 +1,46 @@
+#!/usr/bin/env bash
+# Liveness check: clients that only listen must outlive the idle timeout.
+# Starts the server with a 3 s idle timeout and 1 s heartbeats, connects one
+# framed client (./client) and one legacy client (raw socket) that never
+# send after their user ID, and fails if the server reaps either of them.
+# Usage: ./idle_check.sh   (run from the build directory, port 8080 free)
+
+set -u
+IDLE_S=3
+HOLD_S=$((IDLE_S * 3))
+OUT=$(mktemp)
+
+cleanup() {
+    kill -INT "$SERVER_PID" 2>/dev/null
+    wait "$SERVER_PID" 2>/dev/null
+    rm -f "$OUT"
+}
+
+CLIENT_IDLE_TIMEOUT_S=$IDLE_S HEARTBEAT_INTERVAL_S=1 ./server > "$OUT" 2>&1 &
+SERVER_PID=$!
+trap cleanup EXIT
+sleep 0.5
+
+# Framed: stdin stays open and empty until the hold time is up
+sleep "$HOLD_S" | ./client quiet_framed > /dev/null 2>&1 &
+FRAMED_PID=$!
+
+# Legacy: bare name as the original client sent it, then silence
+exec 3<>/dev/tcp/127.0.0.1/8080
+printf 'quiet_legacy' >&3
+
+sleep "$HOLD_S"
+LEGACY_OPEN=1
+if ! printf '' >&3 2>/dev/null || grep -q "without input" "$OUT"; then
+    LEGACY_OPEN=0
+fi
+exec 3>&-
+wait "$FRAMED_PID" 2>/dev/null
+
+if [ "$LEGACY_OPEN" -eq 1 ] && ! grep -q "without input" "$OUT"; then
+    echo "✓ PASS: silent framed and legacy clients survived ${HOLD_S}s with a ${IDLE_S}s idle timeout"
+    exit 0
+fi
+echo "✗ FAIL: a silent client was reaped"
+grep "without input" "$OUT"
+exit 1
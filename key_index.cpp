@@ -0,0 +1,257 @@
+#include "key_index.h"
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#if defined(__SSE2__) && !defined(KEY_INDEX_SCALAR)
+#include <emmintrin.h>
+#define KEY_INDEX_SSE2 1
+#endif
+
+namespace {
+// Group from the high bits, tag from the low 7 so the two stay independent
+size_t hash_of(MessageKey key) {
+    return MessageKeyHash{}(key);
+}
+
+uint8_t tag_of(size_t hash) {
+    return static_cast<uint8_t>(hash & 0x7F);
+}
+
+size_t home_group(size_t hash) {
+    return hash >> 7;
+}
+
+int lowest_bit(uint32_t mask) {
+    return __builtin_ctz(mask);
+}
+}
+
+KeyIndex::KeyIndex(size_t max)
+    : group_mask(0), max_keys(max), live(0), used(0), max_used(0), rehashes(0) {
+    if (max_keys == 0 || max_keys > (1u << 30)) {
+        throw std::invalid_argument("Key index size must be between 1 and 2^30");
+    }
+    // At least twice as many slots as keys, in a power-of-two number of groups
+    size_t groups = 1;
+    while (groups * GROUP_SIZE < max_keys * 2) {
+        groups <<= 1;
+    }
+    control.reset(groups * GROUP_SIZE);
+    keys.reset(groups * GROUP_SIZE);
+    values.reset(groups * GROUP_SIZE);
+    control.fill(EMPTY);
+    group_mask = groups - 1;
+    max_used = control.size() - control.size() / 8;
+}
+
+#ifdef KEY_INDEX_SSE2
+uint32_t KeyIndex::match_tag(const uint8_t* group, uint8_t tag) {
+    __m128i bytes = _mm_load_si128(reinterpret_cast<const __m128i*>(group));
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(static_cast<char>(tag)))));
+}
+
+uint32_t KeyIndex::match_empty(const uint8_t* group) {
+    return match_tag(group, EMPTY);
+}
+
+uint32_t KeyIndex::match_free(const uint8_t* group) {
+    // The top bit of every byte: set for both markers only
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_load_si128(reinterpret_cast<const __m128i*>(group))));
+}
+
+const char* KeyIndex::probe_kind() {
+    return "SSE2";
+}
+#elif defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+// SWAR: a group is two 64-bit words, slot i in byte i % 8 of word i / 8
+namespace {
+constexpr uint64_t LSBS = 0x0101010101010101ULL;
+constexpr uint64_t MSBS = 0x8080808080808080ULL;
+
+// Top bit of each byte down to one bit per byte, byte 0 lowest
+uint32_t compress(uint64_t top_bits) {
+    return static_cast<uint32_t>(((top_bits >> 7) * 0x0102040810204080ULL) >> 56);
+}
+
+template <typename Match>
+uint32_t match_words(const uint8_t* group, Match match) {
+    uint64_t words[2];
+    memcpy(words, group, sizeof(words));
+    return compress(match(words[0])) | (compress(match(words[1])) << 8);
+}
+}
+
+uint32_t KeyIndex::match_tag(const uint8_t* group, uint8_t tag) {
+    // Zero bytes of word ^ tag. A borrow can also flag a live slot holding
+    // tag ^ 1 just above a true match, which only costs a key comparison;
+    // markers differ from any tag in the top bit, so they never report
+    return match_words(group, [tag](uint64_t word) {
+        uint64_t x = word ^ (LSBS * tag);
+        return (x - LSBS) & ~x & MSBS;
+    });
+}
+
+uint32_t KeyIndex::match_empty(const uint8_t* group) {
+    // Exact: EMPTY is the only control byte with the top bit set and bit 1 clear
+    return match_words(group, [](uint64_t word) { return word & ~(word << 6) & MSBS; });
+}
+
+uint32_t KeyIndex::match_free(const uint8_t* group) {
+    return match_words(group, [](uint64_t word) { return word & MSBS; });
+}
+
+const char* KeyIndex::probe_kind() {
+    return "scalar (SWAR)";
+}
+#else
+uint32_t KeyIndex::match_tag(const uint8_t* group, uint8_t tag) {
+    uint32_t mask = 0;
+    for (size_t i = 0; i < GROUP_SIZE; ++i) {
+        mask |= static_cast<uint32_t>(group[i] == tag) << i;
+    }
+    return mask;
+}
+
+uint32_t KeyIndex::match_empty(const uint8_t* group) {
+    return match_tag(group, EMPTY);
+}
+
+uint32_t KeyIndex::match_free(const uint8_t* group) {
+    uint32_t mask = 0;
+    for (size_t i = 0; i < GROUP_SIZE; ++i) {
+        mask |= static_cast<uint32_t>(group[i] >> 7) << i;
+    }
+    return mask;
+}
+
+const char* KeyIndex::probe_kind() {
+    return "scalar";
+}
+#endif
+
+long KeyIndex::locate(MessageKey key) const {
+    size_t hash = hash_of(key);
+    uint8_t tag = tag_of(hash);
+    size_t group = home_group(hash) & group_mask;
+
+    // Triangular steps visit every group of a power-of-two table once
+    for (size_t step = 1; step <= group_mask + 1; ++step) {
+        const uint8_t* bytes = control.data() + group * GROUP_SIZE;
+        uint32_t candidates = match_tag(bytes, tag);
+        while (candidates != 0) {
+            size_t slot = group * GROUP_SIZE + static_cast<size_t>(lowest_bit(candidates));
+            if (keys[slot] == key) {
+                return static_cast<long>(slot);
+            }
+            candidates &= candidates - 1;
+        }
+        // Inserts stop at the first group with room, so an empty slot ends the chain
+        if (match_empty(bytes) != 0) {
+            return -1;
+        }
+        group = (group + step) & group_mask;
+    }
+    return -1;
+}
+
+size_t KeyIndex::find_free(size_t hash) const {
+    size_t group = home_group(hash) & group_mask;
+
+    // The table is never full, so some group on the chain has room
+    for (size_t step = 1;; ++step) {
+        uint32_t free_slots = match_free(control.data() + group * GROUP_SIZE);
+        if (free_slots != 0) {
+            return group * GROUP_SIZE + static_cast<size_t>(lowest_bit(free_slots));
+        }
+        group = (group + step) & group_mask;
+    }
+}
+
+void KeyIndex::place(MessageKey key, int32_t value) {
+    size_t hash = hash_of(key);
+    size_t slot = find_free(hash);
+    if (control[slot] == EMPTY) {
+        used++;
+    }
+    control[slot] = tag_of(hash);
+    keys[slot] = key;
+    values[slot] = value;
+    live++;
+}
+
+void KeyIndex::rehash() {
+    // In place: tombstones become empty and live entries are marked DELETED,
+    // meaning "not yet re-placed". Each marked entry then moves to the first
+    // free slot on its chain. Groups ahead of that slot hold only re-placed
+    // entries, which never move again, so every chain stays unbroken.
+    for (size_t slot = 0; slot < control.size(); ++slot) {
+        control[slot] = (control[slot] & 0x80) != 0 ? EMPTY : DELETED;
+    }
+
+    for (size_t slot = 0; slot < control.size(); ++slot) {
+        while (control[slot] == DELETED) {
+            size_t hash = hash_of(keys[slot]);
+            size_t target = find_free(hash);
+            if (target / GROUP_SIZE == slot / GROUP_SIZE) {
+                // Already in the first group with room
+                control[slot] = tag_of(hash);
+            } else if (control[target] == EMPTY) {
+                control[target] = tag_of(hash);
+                keys[target] = keys[slot];
+                values[target] = values[slot];
+                control[slot] = EMPTY;
+            } else {
+                // Target holds an entry not yet re-placed: trade places and
+                // go round again for the one that landed here
+                control[target] = tag_of(hash);
+                std::swap(keys[target], keys[slot]);
+                std::swap(values[target], values[slot]);
+            }
+        }
+    }
+    used = live;
+    rehashes++;
+}
+
+int KeyIndex::find(MessageKey key) const {
+    long slot = locate(key);
+    return slot < 0 ? -1 : values[static_cast<size_t>(slot)];
+}
+
+bool KeyIndex::insert(MessageKey key, int value) {
+    if (live >= max_keys || locate(key) >= 0) {
+        return false;
+    }
+    if (used >= max_used) {
+        rehash();
+    }
+    place(key, value);
+    return true;
+}
+
+bool KeyIndex::erase(MessageKey key) {
+    long found = locate(key);
+    if (found < 0) {
+        return false;
+    }
+    size_t slot = static_cast<size_t>(found);
+
+    // A group that already has an empty slot ends every probe reaching it,
+    // so nothing lives beyond it on this chain and the slot can be empty too
+    const uint8_t* group = control.data() + (slot / GROUP_SIZE) * GROUP_SIZE;
+    if (match_empty(group) != 0) {
+        control[slot] = EMPTY;
+        used--;
+    } else {
+        control[slot] = DELETED;
+    }
+    live--;
+    return true;
+}
+
+void KeyIndex::clear() {
+    control.fill(EMPTY);
+    live = 0;
+    used = 0;
+}
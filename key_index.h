@@ -0,0 +1,99 @@
+#ifndef KEY_INDEX_H
+#define KEY_INDEX_H
+
+#include "aligned_array.h"
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+
+// Compact message identifier: interned sender ID in the high 32 bits,
+// timestamp (seconds, truncated to 32 bits) in the low 32 bits
+using MessageKey = uint64_t;
+
+inline MessageKey make_message_key(uint32_t sender_id, time_t timestamp) {
+    return (static_cast<uint64_t>(sender_id) << 32) | static_cast<uint32_t>(timestamp);
+}
+
+// Integer mixer (splitmix64 finalizer); keys differ mostly in the low bits
+struct MessageKeyHash {
+    size_t operator()(MessageKey key) const noexcept {
+        key ^= key >> 30;
+        key *= 0xbf58476d1ce4e5b9ULL;
+        key ^= key >> 27;
+        key *= 0x94d049bb133111ebULL;
+        key ^= key >> 31;
+        return static_cast<size_t>(key);
+    }
+};
+
+/**
+ * Open-addressing map from MessageKey to a cache slot, probed 16 at a time
+ * Slots come in groups of 16 with one control byte each: the low 7 bits of
+ * the key's hash, or an empty / deleted marker. A probe compares a whole
+ * group of control bytes against the tag in one step (SSE2 where the
+ * compiler targets it, 64-bit SWAR otherwise or with KEY_INDEX_SCALAR)
+ * and reads only the keys whose tag matched, so a miss usually costs one
+ * 16-byte load. The table holds at most max_keys keys at under half load;
+ * tombstones left by erase() are swept by an occasional rehash that moves
+ * entries within the table and allocates nothing.
+ *
+ * Not thread-safe; each MessageCache owns one and uses it under its lock.
+ */
+class KeyIndex {
+public:
+    static constexpr size_t GROUP_SIZE = 16;
+
+private:
+    static constexpr uint8_t EMPTY = 0x80;
+    static constexpr uint8_t DELETED = 0xFE;  // both markers have the top bit set, tags never do
+
+    CacheLineArray<uint8_t> control;
+    CacheLineArray<MessageKey> keys;
+    CacheLineArray<int32_t> values;
+    size_t group_mask;
+    size_t max_keys;
+    size_t live;
+    size_t used;      // live keys plus tombstones
+    size_t max_used;  // rehash beyond this many
+    uint64_t rehashes;
+
+    // Bit i set for each slot i of the group that matches
+    static uint32_t match_tag(const uint8_t* group, uint8_t tag);
+    static uint32_t match_empty(const uint8_t* group);
+    static uint32_t match_free(const uint8_t* group);  // empty or deleted
+
+    // Slot holding key, or -1
+    long locate(MessageKey key) const;
+    // First empty or deleted slot on the key's probe chain
+    size_t find_free(size_t hash) const;
+    void place(MessageKey key, int32_t value);
+    void rehash();
+
+public:
+    explicit KeyIndex(size_t max_keys);
+
+    // Delete copy constructor and assignment operator
+    KeyIndex(const KeyIndex&) = delete;
+    KeyIndex& operator=(const KeyIndex&) = delete;
+
+    // Value stored for key, or -1
+    int find(MessageKey key) const;
+
+    // False if key is already present or the index is full
+    bool insert(MessageKey key, int value);
+
+    // False if key was not present
+    bool erase(MessageKey key);
+
+    void clear();
+
+    size_t size() const { return live; }
+    size_t get_slot_count() const { return control.size(); }
+    size_t get_bytes() const { return control.get_bytes() + keys.get_bytes() + values.get_bytes(); }
+    uint64_t get_rehashes() const { return rehashes; }
+
+    // "SSE2" or "scalar", whichever this build probes with
+    static const char* probe_kind();
+};
+
+#endif
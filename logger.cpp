@@ -0,0 +1,240 @@
+#include "logger.h"
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <fcntl.h>
+#include <iostream>
+#include <pthread.h>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace {
+// Flush once this much text has been batched, even if more is queued
+constexpr size_t WRITE_BATCH_BYTES = 64 * 1024;
+// Upper bound on how long a message can sit unwritten if a wakeup is missed
+constexpr auto WRITER_IDLE_TIMEOUT = std::chrono::milliseconds(50);
+
+const char* level_prefix(LogLevel level) {
+    switch (level) {
+        case LogLevel::LOG_DEBUG: return "DEBUG: ";
+        case LogLevel::LOG_WARNING: return "WARNING: ";
+        case LogLevel::LOG_ERROR: return "ERROR: ";
+        case LogLevel::LOG_INFO: break;
+    }
+    return "";
+}
+
+void write_all(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        data += n;
+        len -= static_cast<size_t>(n);
+    }
+}
+}
+
+AsyncLogger::AsyncLogger(size_t capacity, LogLevel level)
+    : mask(0), tail(0), head(0), dropped(0), reported_dropped(0),
+      min_level(static_cast<int>(level)), file_fd(-1), console(true), running(false),
+      writer_idle(false), cached_second(-1), cached_length(0) {
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
+        throw std::invalid_argument("Log ring capacity must be a power of two");
+    }
+    slots.reset(new Slot[capacity]);
+    for (size_t i = 0; i < capacity; ++i) {
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    mask = capacity - 1;
+}
+
+AsyncLogger::~AsyncLogger() {
+    stop();
+}
+
+bool AsyncLogger::open(const std::string& path) {
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    if (file_fd >= 0) {
+        close(file_fd);
+    }
+    file_fd = fd;
+    return true;
+}
+
+void AsyncLogger::start() {
+    if (running.exchange(true)) {
+        return;
+    }
+    writer = std::thread(&AsyncLogger::writer_loop, this);
+#ifdef __linux__
+    pthread_setname_np(writer.native_handle(), "logger");
+#endif
+}
+
+void AsyncLogger::stop() {
+    if (running.exchange(false)) {
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex);
+        }
+        wake_cv.notify_one();
+    }
+    if (writer.joinable()) {
+        writer.join();
+    }
+
+    // Anything logged after the writer exited (or if it never started)
+    std::string batch;
+    while (drain(batch) > 0) {
+        flush_batch(batch);
+    }
+    flush_batch(batch);
+
+    if (file_fd >= 0) {
+        close(file_fd);
+        file_fd = -1;
+    }
+}
+
+bool AsyncLogger::log(LogLevel level, std::string_view message) {
+    if (!enabled(level)) {
+        return false;
+    }
+
+    // Bounded MPSC enqueue: claim a position whose slot the writer has freed
+    uint64_t pos = tail.load(std::memory_order_relaxed);
+    Slot* slot;
+    while (true) {
+        slot = &slots[pos & mask];
+        uint64_t seq = slot->sequence.load(std::memory_order_acquire);
+        int64_t diff = static_cast<int64_t>(seq) - static_cast<int64_t>(pos);
+        if (diff == 0) {
+            if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // Ring full: drop rather than block the caller
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        } else {
+            pos = tail.load(std::memory_order_relaxed);
+        }
+    }
+
+    size_t length = std::min(message.size(), sizeof(slot->text));
+    memcpy(slot->text, message.data(), length);
+    slot->length = static_cast<uint16_t>(length);
+    slot->level = level;
+    slot->timestamp = time(nullptr);
+    slot->sequence.store(pos + 1, std::memory_order_release);
+
+    // Only the first producer after the writer went idle pays for the wakeup
+    if (writer_idle.load(std::memory_order_relaxed) && writer_idle.exchange(false)) {
+        wake_cv.notify_one();
+    }
+    return true;
+}
+
+void AsyncLogger::append_entry(std::string& batch, time_t timestamp, LogLevel level,
+                               const char* text, size_t length) {
+    if (timestamp != cached_second) {
+        struct tm local;
+        localtime_r(&timestamp, &local);
+        cached_length = strftime(cached_timestamp, sizeof(cached_timestamp),
+                                 "%Y-%m-%d %H:%M:%S", &local);
+        cached_second = timestamp;
+    }
+
+    batch.append(cached_timestamp, cached_length);
+    batch.append(" - ");
+    batch.append(level_prefix(level));
+    batch.append(text, length);
+    batch.push_back('\n');
+}
+
+size_t AsyncLogger::drain(std::string& batch) {
+    size_t count = 0;
+
+    while (batch.size() < WRITE_BATCH_BYTES) {
+        Slot& slot = slots[head & mask];
+        if (slot.sequence.load(std::memory_order_acquire) != head + 1) {
+            break;  // empty, or the producer is still copying
+        }
+        append_entry(batch, slot.timestamp, slot.level, slot.text, slot.length);
+        slot.sequence.store(head + mask + 1, std::memory_order_release);
+        head++;
+        count++;
+    }
+
+    uint64_t lost = dropped.load(std::memory_order_relaxed);
+    if (lost != reported_dropped) {
+        std::string note = std::to_string(lost - reported_dropped) +
+                           " log messages dropped (ring full)";
+        append_entry(batch, time(nullptr), LogLevel::LOG_WARNING, note.data(), note.size());
+        reported_dropped = lost;
+    }
+    return count;
+}
+
+void AsyncLogger::flush_batch(std::string& batch) {
+    if (batch.empty()) {
+        return;
+    }
+    if (console) {
+        write_all(STDOUT_FILENO, batch.data(), batch.size());
+    }
+    if (file_fd >= 0) {
+        write_all(file_fd, batch.data(), batch.size());
+    }
+    batch.clear();
+}
+
+void AsyncLogger::writer_loop() {
+    std::string batch;
+    batch.reserve(WRITE_BATCH_BYTES + LOG_ENTRY_SIZE + 64);
+
+    while (running.load()) {
+        if (drain(batch) > 0) {
+            flush_batch(batch);
+            continue;
+        }
+        flush_batch(batch);
+
+        // Announce idleness, then re-check so a message queued in between is
+        // not left waiting for the timeout
+        writer_idle.store(true);
+        if (drain(batch) > 0) {
+            writer_idle.store(false);
+            flush_batch(batch);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(wake_mutex);
+        wake_cv.wait_for(lock, WRITER_IDLE_TIMEOUT, [this] {
+            return !writer_idle.load() || !running.load();
+        });
+        writer_idle.store(false);
+    }
+}
+
+bool AsyncLogger::parse_level(const std::string& name, LogLevel& level) {
+    if (name == "debug") {
+        level = LogLevel::LOG_DEBUG;
+    } else if (name == "info") {
+        level = LogLevel::LOG_INFO;
+    } else if (name == "warning") {
+        level = LogLevel::LOG_WARNING;
+    } else if (name == "error") {
+        level = LogLevel::LOG_ERROR;
+    } else {
+        return false;
+    }
+    return true;
+}
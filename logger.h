@@ -0,0 +1,98 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include "common.h"
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+// Prefixed so debug builds (-DDEBUG) and system headers' ERROR macros don't collide
+enum class LogLevel : uint8_t {
+    LOG_DEBUG,
+    LOG_INFO,
+    LOG_WARNING,
+    LOG_ERROR
+};
+
+/**
+ * Asynchronous logger with a bounded lock-free ring
+ * Callers copy the message into a fixed-size slot (claimed with one CAS) and
+ * return immediately; a background thread formats timestamps and writes
+ * batches to the log file and stdout with large write() calls. When the ring
+ * is full, new messages are dropped and counted rather than blocking.
+ */
+class AsyncLogger {
+private:
+    struct Slot {
+        std::atomic<uint64_t> sequence;  // == position when free, position + 1 when filled
+        time_t timestamp;
+        LogLevel level;
+        uint16_t length;
+        char text[LOG_ENTRY_SIZE];
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    uint64_t mask;
+
+    alignas(64) std::atomic<uint64_t> tail;  // next position for producers
+    alignas(64) uint64_t head;               // next position for the writer
+
+    std::atomic<uint64_t> dropped;
+    uint64_t reported_dropped;
+    std::atomic<int> min_level;
+
+    int file_fd;
+    bool console;
+    std::thread writer;
+    std::atomic<bool> running;
+    std::atomic<bool> writer_idle;
+    std::mutex wake_mutex;
+    std::condition_variable wake_cv;
+
+    // Writer-thread timestamp cache, reformatted once per second
+    time_t cached_second;
+    char cached_timestamp[32];
+    size_t cached_length;
+
+    void writer_loop();
+    size_t drain(std::string& batch);
+    void append_entry(std::string& batch, time_t timestamp, LogLevel level,
+                      const char* text, size_t length);
+    void flush_batch(std::string& batch);
+
+public:
+    explicit AsyncLogger(size_t capacity = LOG_RING_CAPACITY, LogLevel level = LogLevel::LOG_INFO);
+    ~AsyncLogger();
+
+    // Delete copy constructor and assignment operator
+    AsyncLogger(const AsyncLogger&) = delete;
+    AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+    // Append to this file as well as stdout; call before start()
+    bool open(const std::string& path);
+    void set_console(bool enabled) { console = enabled; }
+
+    void start();
+
+    // Write everything still queued and stop the writer thread
+    void stop();
+
+    // Queue a message; false if filtered out or dropped because the ring is full
+    bool log(LogLevel level, std::string_view message);
+
+    bool enabled(LogLevel level) const {
+        return static_cast<int>(level) >= min_level.load(std::memory_order_relaxed);
+    }
+    void set_level(LogLevel level) { min_level.store(static_cast<int>(level)); }
+    LogLevel get_level() const { return static_cast<LogLevel>(min_level.load()); }
+    uint64_t get_dropped_count() const { return dropped.load(); }
+
+    // "debug", "info", "warning" or "error"; false if unrecognized
+    static bool parse_level(const std::string& name, LogLevel& level);
+};
+
+#endif
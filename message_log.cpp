@@ -0,0 +1,365 @@
+#include "message_log.h"
+#include "histogram.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <iostream>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+constexpr char SEGMENT_MAGIC[8] = {'C', 'H', 'A', 'T', 'L', 'O', 'G', '1'};
+constexpr uint32_t RECORD_MAGIC = 0x4d534731;  // "MSG1"
+
+struct SegmentHeader {
+    char magic[8];
+    int64_t created;
+};
+
+struct RecordHeader {
+    uint32_t magic;         // written last; zero marks the end of the segment
+    uint32_t payload_len;
+    int64_t timestamp;
+    uint8_t type;
+    uint8_t sender_len;
+    uint8_t room_len;       // room name after the sender; 0 for the default room
+    uint8_t reserved;
+    uint32_t checksum;      // FNV-1a over sender, room and payload
+};
+
+static_assert(sizeof(SegmentHeader) == 16, "segment header layout");
+static_assert(sizeof(RecordHeader) == 24, "record header layout");
+
+size_t record_size(size_t sender_len, size_t room_len, size_t payload_len) {
+    return (sizeof(RecordHeader) + sender_len + room_len + payload_len + 7) & ~static_cast<size_t>(7);
+}
+
+// An empty room hashes like the records written before rooms were logged
+uint32_t checksum(std::string_view sender, std::string_view room, std::string_view payload) {
+    uint32_t hash = 2166136261u;
+    for (std::string_view part : {sender, room, payload}) {
+        for (char c : part) {
+            hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+        }
+    }
+    return hash;
+}
+
+// Hop over record headers; returns the offset just past the last complete record
+size_t walk_records(const char* data, size_t size, std::vector<size_t>* offsets) {
+    size_t offset = sizeof(SegmentHeader);
+    while (offset + sizeof(RecordHeader) <= size) {
+        RecordHeader header;
+        memcpy(&header, data + offset, sizeof(header));
+        if (header.magic != RECORD_MAGIC) {
+            break;
+        }
+        size_t length = record_size(header.sender_len, header.room_len, header.payload_len);
+        if (offset + length > size) {
+            break;
+        }
+        if (offsets) {
+            offsets->push_back(offset);
+        }
+        offset += length;
+    }
+    return offset;
+}
+
+bool decode_record(const char* data, size_t offset, LoggedMessage& message) {
+    RecordHeader header;
+    memcpy(&header, data + offset, sizeof(header));
+    const char* body = data + offset + sizeof(RecordHeader);
+    message.type = header.type;
+    message.timestamp = static_cast<time_t>(header.timestamp);
+    message.sender = std::string_view(body, header.sender_len);
+    message.room = std::string_view(body + header.sender_len, header.room_len);
+    message.payload = std::string_view(body + header.sender_len + header.room_len, header.payload_len);
+    return checksum(message.sender, message.room, message.payload) == header.checksum;
+}
+
+std::string segment_path(const std::string& directory, uint64_t index) {
+    char name[40];
+    snprintf(name, sizeof(name), "segment-%010llu.log", static_cast<unsigned long long>(index));
+    return directory + "/" + name;
+}
+}
+
+MessageLog::MessageLog(const std::string& dir, size_t seg_bytes, size_t max_segs,
+                       time_t max_age, int sync_ms)
+    : directory(dir), segment_bytes(seg_bytes), max_segments(max_segs),
+      max_age_seconds(max_age), sync_interval_ms(sync_ms), fd(-1), base(nullptr),
+      mapped_bytes(0), write_offset(0), synced_offset(0), segment_index(0),
+      segment_created(0), last_sync_ns(0) {
+    if (segment_bytes < sizeof(SegmentHeader) + record_size(USERNAME_MAX_LEN, ROOM_NAME_MAX_LEN, MAX_LOGGED_PAYLOAD)) {
+        throw std::invalid_argument("Log segment too small for a full-size record");
+    }
+    if (max_segments == 0) {
+        throw std::invalid_argument("Log must keep at least one segment");
+    }
+}
+
+MessageLog::~MessageLog() {
+    close();
+}
+
+std::vector<MessageLog::Segment> MessageLog::list_segments() const {
+    std::vector<Segment> segments;
+    DIR* dir = opendir(directory.c_str());
+    if (!dir) {
+        return segments;
+    }
+    while (struct dirent* entry = readdir(dir)) {
+        unsigned long long index;
+        char suffix[8];
+        if (sscanf(entry->d_name, "segment-%llu.%7s", &index, suffix) == 2 && strcmp(suffix, "log") == 0) {
+            segments.push_back({index, directory + "/" + entry->d_name});
+        }
+    }
+    closedir(dir);
+    std::sort(segments.begin(), segments.end(),
+              [](const Segment& a, const Segment& b) { return a.index < b.index; });
+    return segments;
+}
+
+bool MessageLog::open() {
+    std::lock_guard<std::mutex> lock(log_mutex);
+    if (base) {
+        return true;
+    }
+    if (mkdir(directory.c_str(), 0755) < 0 && errno != EEXIST) {
+        std::cerr << "[MessageLog] Cannot create " << directory << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    std::vector<Segment> segments = list_segments();
+    if (segments.empty()) {
+        return open_segment(0, true);
+    }
+    // Keep appending to the newest segment; an unreadable one is left alone
+    if (open_segment(segments.back().index, false)) {
+        return true;
+    }
+    return open_segment(segments.back().index + 1, true);
+}
+
+bool MessageLog::open_segment(uint64_t index, bool create) {
+    std::string path = segment_path(directory, index);
+    int flags = O_RDWR | O_CLOEXEC | (create ? O_CREAT | O_EXCL : 0);
+    int segment_fd = ::open(path.c_str(), flags, 0644);
+    if (segment_fd < 0) {
+        std::cerr << "[MessageLog] Cannot open " << path << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    // Sparse preallocation: unwritten pages cost nothing and read as zero
+    struct stat st;
+    size_t size = segment_bytes;
+    if (!create && fstat(segment_fd, &st) == 0 && st.st_size > 0) {
+        size = static_cast<size_t>(st.st_size);
+    } else if (ftruncate(segment_fd, static_cast<off_t>(segment_bytes)) < 0) {
+        ::close(segment_fd);
+        return false;
+    }
+
+    void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, segment_fd, 0);
+    if (mapping == MAP_FAILED) {
+        std::cerr << "[MessageLog] mmap failed for " << path << ": " << strerror(errno) << std::endl;
+        ::close(segment_fd);
+        return false;
+    }
+
+    char* data = static_cast<char*>(mapping);
+    SegmentHeader header;
+    if (create) {
+        memcpy(header.magic, SEGMENT_MAGIC, sizeof(header.magic));
+        header.created = static_cast<int64_t>(time(nullptr));
+        memcpy(data, &header, sizeof(header));
+        write_offset = sizeof(SegmentHeader);
+    } else {
+        memcpy(&header, data, sizeof(header));
+        if (size < sizeof(SegmentHeader) || memcmp(header.magic, SEGMENT_MAGIC, sizeof(header.magic)) != 0) {
+            munmap(mapping, size);
+            ::close(segment_fd);
+            return false;
+        }
+        write_offset = walk_records(data, size, nullptr);
+    }
+
+    fd = segment_fd;
+    base = data;
+    mapped_bytes = size;
+    synced_offset = create ? 0 : write_offset;
+    segment_index = index;
+    segment_created = static_cast<time_t>(header.created);
+    last_sync_ns = monotonic_ns();
+    return true;
+}
+
+void MessageLog::close_segment() {
+    if (!base) {
+        return;
+    }
+    sync_locked(true);
+    munmap(base, mapped_bytes);
+    ::close(fd);
+    base = nullptr;
+    fd = -1;
+    mapped_bytes = 0;
+}
+
+void MessageLog::close() {
+    std::lock_guard<std::mutex> lock(log_mutex);
+    close_segment();
+}
+
+bool MessageLog::rotate() {
+    uint64_t next = segment_index + 1;
+    close_segment();
+    if (!open_segment(next, true)) {
+        return false;
+    }
+    enforce_retention();
+    return true;
+}
+
+void MessageLog::enforce_retention() {
+    std::vector<Segment> segments = list_segments();
+    for (size_t i = 0; i + max_segments < segments.size(); ++i) {
+        unlink(segments[i].path.c_str());
+    }
+}
+
+void MessageLog::sync_locked(bool wait) {
+    if (!base || write_offset <= synced_offset) {
+        return;
+    }
+    // msync wants a page-aligned start
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t start = synced_offset & ~(page - 1);
+    msync(base + start, write_offset - start, wait ? MS_SYNC : MS_ASYNC);
+    synced_offset = write_offset;
+    last_sync_ns = monotonic_ns();
+}
+
+void MessageLog::sync(bool wait) {
+    std::lock_guard<std::mutex> lock(log_mutex);
+    sync_locked(wait);
+}
+
+bool MessageLog::append(uint8_t type, std::string_view sender, time_t timestamp, std::string_view payload,
+                        std::string_view room) {
+    sender = sender.substr(0, USERNAME_MAX_LEN);
+    payload = payload.substr(0, MAX_LOGGED_PAYLOAD);
+    room = room.substr(0, ROOM_NAME_MAX_LEN);
+    size_t length = record_size(sender.size(), room.size(), payload.size());
+
+    std::lock_guard<std::mutex> lock(log_mutex);
+    if (!base) {
+        return false;
+    }
+
+    bool full = write_offset + length > mapped_bytes;
+    bool aged = write_offset > sizeof(SegmentHeader) && time(nullptr) - segment_created >= max_age_seconds;
+    if ((full || aged) && !rotate()) {
+        return false;
+    }
+
+    RecordHeader header;
+    header.magic = 0;
+    header.payload_len = static_cast<uint32_t>(payload.size());
+    header.timestamp = static_cast<int64_t>(timestamp);
+    header.type = type;
+    header.sender_len = static_cast<uint8_t>(sender.size());
+    header.room_len = static_cast<uint8_t>(room.size());
+    header.reserved = 0;
+    header.checksum = checksum(sender, room, payload);
+
+    char* record = base + write_offset;
+    memcpy(record, &header, sizeof(header));
+    memcpy(record + sizeof(header), sender.data(), sender.size());
+    memcpy(record + sizeof(header) + sender.size(), room.data(), room.size());
+    memcpy(record + sizeof(header) + sender.size() + room.size(), payload.data(), payload.size());
+    // Publishing the magic last means a crash mid-record just ends the segment here
+    __atomic_store_n(reinterpret_cast<uint32_t*>(record), RECORD_MAGIC, __ATOMIC_RELEASE);
+    write_offset += length;
+
+    if (monotonic_ns() - last_sync_ns >= static_cast<uint64_t>(sync_interval_ms) * 1000000) {
+        sync_locked(false);
+    }
+    return true;
+}
+
+size_t MessageLog::for_each_recent(size_t count, const Visitor& visit) {
+    std::lock_guard<std::mutex> lock(log_mutex);
+    if (count == 0) {
+        return 0;
+    }
+
+    struct Mapped {
+        const char* data;
+        size_t size;
+        bool owned;  // false for the active segment, which stays mapped
+        std::vector<size_t> offsets;
+    };
+    std::vector<Mapped> mapped;  // newest first
+    size_t collected = 0;
+
+    std::vector<Segment> segments = list_segments();
+    for (auto it = segments.rbegin(); it != segments.rend() && collected < count; ++it) {
+        Mapped segment{nullptr, 0, false, {}};
+        if (base && it->index == segment_index) {
+            segment.data = base;
+            segment.size = write_offset;
+        } else {
+            int segment_fd = ::open(it->path.c_str(), O_RDONLY | O_CLOEXEC);
+            struct stat st;
+            if (segment_fd < 0 || fstat(segment_fd, &st) < 0 ||
+                static_cast<size_t>(st.st_size) < sizeof(SegmentHeader)) {
+                if (segment_fd >= 0) {
+                    ::close(segment_fd);
+                }
+                continue;
+            }
+            void* mapping = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, segment_fd, 0);
+            ::close(segment_fd);
+            if (mapping == MAP_FAILED) {
+                continue;
+            }
+            segment.data = static_cast<const char*>(mapping);
+            segment.size = static_cast<size_t>(st.st_size);
+            segment.owned = true;
+            if (memcmp(segment.data, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC)) != 0) {
+                munmap(mapping, segment.size);
+                continue;
+            }
+        }
+        walk_records(segment.data, segment.size, &segment.offsets);
+        collected += segment.offsets.size();
+        mapped.push_back(std::move(segment));
+    }
+
+    // Oldest first, skipping whatever falls outside the last count records
+    size_t skip = collected > count ? collected - count : 0;
+    size_t visited = 0;
+    for (auto it = mapped.rbegin(); it != mapped.rend(); ++it) {
+        size_t first = std::min(skip, it->offsets.size());
+        skip -= first;
+        for (size_t i = first; i < it->offsets.size(); ++i) {
+            LoggedMessage message;
+            if (decode_record(it->data, it->offsets[i], message)) {
+                visit(message);
+                visited++;
+            }
+        }
+        if (it->owned) {
+            munmap(const_cast<char*>(it->data), it->size);
+        }
+    }
+    return visited;
+}
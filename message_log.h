@@ -0,0 +1,107 @@
+#ifndef MESSAGE_LOG_H
+#define MESSAGE_LOG_H
+
+#include "common.h"
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Longer payloads are truncated; matches MAX_FRAME_PAYLOAD
+constexpr size_t MAX_LOGGED_PAYLOAD = BUFFER_SIZE;
+
+// A record handed to recovery; views point into a mapped segment
+struct LoggedMessage {
+    uint8_t type;
+    time_t timestamp;
+    std::string_view sender;
+    std::string_view room;  // empty for the default room
+    std::string_view payload;
+};
+
+/**
+ * Append-only, memory-mapped log of broadcast messages
+ * The log is a directory of fixed-size segment files. Each segment starts
+ * with a small header and holds records back to back: a fixed 24-byte
+ * header (magic, lengths, timestamp, type, checksum) followed by the sender
+ * name, the room name (empty for the default room) and payload, padded to 8
+ * bytes. Appends are memcpy's into the mapping of the newest segment, with the
+ * record magic written last so a torn record ends the segment. Dirty pages
+ * are msync'd asynchronously at most once per sync interval and
+ * synchronously on close.
+ *
+ * A segment is rotated when it is full or older than the age limit, and the
+ * oldest segments are deleted beyond the retention count. Recovery maps
+ * segments newest first and hops from header to header, so finding the last
+ * N records never looks at the text of the ones before them.
+ */
+class MessageLog {
+public:
+    using Visitor = std::function<void(const LoggedMessage&)>;
+
+private:
+    struct Segment {
+        uint64_t index;
+        std::string path;
+    };
+
+    std::string directory;
+    size_t segment_bytes;
+    size_t max_segments;
+    time_t max_age_seconds;
+    int sync_interval_ms;
+
+    std::mutex log_mutex;
+    int fd;
+    char* base;         // mapping of the active segment, nullptr when closed
+    size_t mapped_bytes;
+    size_t write_offset;
+    size_t synced_offset;
+    uint64_t segment_index;
+    time_t segment_created;
+    uint64_t last_sync_ns;
+
+    std::vector<Segment> list_segments() const;
+    bool open_segment(uint64_t index, bool create);
+    void close_segment();
+    bool rotate();
+    void enforce_retention();
+    void sync_locked(bool wait);
+
+public:
+    MessageLog(const std::string& directory,
+               size_t segment_bytes = MESSAGE_LOG_SEGMENT_BYTES,
+               size_t max_segments = MESSAGE_LOG_MAX_SEGMENTS,
+               time_t max_age_seconds = MESSAGE_LOG_SEGMENT_MAX_AGE_S,
+               int sync_interval_ms = MESSAGE_LOG_SYNC_INTERVAL_MS);
+    ~MessageLog();
+
+    // Delete copy constructor and assignment operator
+    MessageLog(const MessageLog&) = delete;
+    MessageLog& operator=(const MessageLog&) = delete;
+
+    // Create the directory if needed and map the newest segment for appending
+    bool open();
+
+    // msync everything and unmap
+    void close();
+
+    // false if the log is closed or the record can never fit in a segment;
+    // room is empty for the default room
+    bool append(uint8_t type, std::string_view sender, time_t timestamp, std::string_view payload,
+                std::string_view room = {});
+
+    // Flush dirty pages; waits for the write-back when wait is true
+    void sync(bool wait = false);
+
+    /**
+     * Visit up to count of the most recent records, oldest first. Views are
+     * only valid during the call. Returns the number of records visited.
+     */
+    size_t for_each_recent(size_t count, const Visitor& visit);
+
+    bool is_open() const { return base != nullptr; }
+};
+
+#endif
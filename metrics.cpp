@@ -0,0 +1,57 @@
+#include "metrics.h"
+
+thread_local MetricsRegistry::ThreadMetrics* MetricsRegistry::local_block = nullptr;
+
+MetricsRegistry::MetricsRegistry() {
+    for (auto& gauge : gauges) {
+        gauge.store(0, std::memory_order_relaxed);
+    }
+}
+
+MetricsRegistry::ThreadMetrics& MetricsRegistry::local() {
+    // One registry per process, so a single thread_local pointer suffices
+    if (!local_block) {
+        auto block = std::make_unique<ThreadMetrics>();
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        local_block = block.get();
+        blocks.push_back(std::move(block));
+    }
+    return *local_block;
+}
+
+uint64_t MetricsRegistry::get(Counter counter) const {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    uint64_t total = 0;
+    for (const auto& block : blocks) {
+        total += block->counters[static_cast<size_t>(counter)].load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+int64_t MetricsRegistry::get(Gauge gauge) const {
+    return gauges[static_cast<size_t>(gauge)].load(std::memory_order_relaxed);
+}
+
+LatencyHistogram::Snapshot MetricsRegistry::snapshot(Latency latency) const {
+    LatencyHistogram::Snapshot result;
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    for (const auto& block : blocks) {
+        block->histograms[static_cast<size_t>(latency)].merge_into(result);
+    }
+    return result;
+}
+
+const char* MetricsRegistry::name(Latency latency) {
+    switch (latency) {
+        case Latency::RECV_TO_BROADCAST: return "recv_to_broadcast";
+        case Latency::SEND_DURATION: return "send_duration";
+        case Latency::QUEUE_WAIT: return "queue_wait";
+        case Latency::COUNT: break;
+    }
+    return "unknown";
+}
+
+MetricsRegistry& MetricsRegistry::instance() {
+    static MetricsRegistry registry;
+    return registry;
+}
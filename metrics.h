@@ -0,0 +1,91 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "histogram.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+enum class Counter : uint8_t {
+    MESSAGES_SENT,
+    MESSAGES_RECEIVED,
+    SEND_CALLS,  // sendmsg() calls on client sockets
+    COUNT
+};
+
+enum class Gauge : uint8_t {
+    ACTIVE_CLIENTS,
+    COUNT
+};
+
+enum class Latency : uint8_t {
+    RECV_TO_BROADCAST,  // bytes read by the reactor until the broadcast is queued
+    SEND_DURATION,      // one sendmsg() call while flushing a client
+    QUEUE_WAIT,         // ThreadPool task enqueue until a worker starts it
+    COUNT
+};
+
+/**
+ * Process-wide metrics without a shared lock on the hot path
+ * Each thread that records gets its own cache-line-aligned block of counters
+ * and histograms, written only by that thread; readers sum the blocks.
+ * Gauges go up and down from different threads, so they are single relaxed
+ * atomics instead. Blocks outlive their threads so totals never go backwards.
+ */
+class MetricsRegistry {
+private:
+    static constexpr size_t COUNTER_COUNT = static_cast<size_t>(Counter::COUNT);
+    static constexpr size_t GAUGE_COUNT = static_cast<size_t>(Gauge::COUNT);
+    static constexpr size_t LATENCY_COUNT = static_cast<size_t>(Latency::COUNT);
+
+    struct alignas(64) ThreadMetrics {
+        std::atomic<uint64_t> counters[COUNTER_COUNT];
+        LatencyHistogram histograms[LATENCY_COUNT];
+
+        ThreadMetrics() {
+            for (auto& counter : counters) {
+                counter.store(0, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    mutable std::mutex registry_mutex;  // guards blocks; taken once per thread
+    std::vector<std::unique_ptr<ThreadMetrics>> blocks;
+    std::atomic<int64_t> gauges[GAUGE_COUNT];
+
+    static thread_local ThreadMetrics* local_block;
+
+    ThreadMetrics& local();
+    
+    // Only instance() constructs one; local_block assumes a single registry
+    MetricsRegistry();
+
+public:
+    // Delete copy constructor and assignment operator
+    MetricsRegistry(const MetricsRegistry&) = delete;
+    MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+    void add(Counter counter, uint64_t amount = 1) {
+        std::atomic<uint64_t>& cell = local().counters[static_cast<size_t>(counter)];
+        cell.store(cell.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+
+    void record(Latency latency, uint64_t nanoseconds) {
+        local().histograms[static_cast<size_t>(latency)].record(nanoseconds);
+    }
+
+    void adjust(Gauge gauge, int64_t delta) {
+        gauges[static_cast<size_t>(gauge)].fetch_add(delta, std::memory_order_relaxed);
+    }
+
+    uint64_t get(Counter counter) const;
+    int64_t get(Gauge gauge) const;
+    LatencyHistogram::Snapshot snapshot(Latency latency) const;
+
+    static const char* name(Latency latency);
+    static MetricsRegistry& instance();
+};
+
+#endif
@@ -0,0 +1,190 @@
+#ifndef MPMC_QUEUE_H
+#define MPMC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+/**
+ * Bounded lock-free multi-producer multi-consumer FIFO
+ * Dmitry Vyukov's ring: every cell carries a sequence number that says
+ * whether it is free for the producer of a given position or holds the
+ * value for its consumer, so a push or pop is one CAS on the shared
+ * position plus a store to the cell. Producers and consumers only meet on
+ * a cell when the ring is nearly full or empty.
+ * try_push() fails when the ring is full instead of growing, so the caller
+ * decides where overflow goes. The bulk variants claim a run of positions
+ * with a single CAS. T must be default-constructible and move-assignable;
+ * a popped cell keeps its moved-from value until it is reused.
+ */
+template <typename T>
+class MpmcQueue {
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    // Producers and consumers each hammer one position; keep them apart
+    alignas(64) std::atomic<size_t> enqueue_pos;
+    alignas(64) std::atomic<size_t> dequeue_pos;
+    alignas(64) std::unique_ptr<Cell[]> cells;
+    size_t mask;
+
+    // Offsets the two positions may be apart are far below 2^63, so the
+    // signed difference tells ahead from behind across wrap-around
+    static intptr_t distance(size_t sequence, size_t pos) {
+        return static_cast<intptr_t>(sequence - pos);
+    }
+
+public:
+    explicit MpmcQueue(size_t capacity) : enqueue_pos(0), dequeue_pos(0), mask(0) {
+        if (capacity < 2 || (capacity & (capacity - 1)) != 0) {
+            throw std::invalid_argument("Queue capacity must be a power of two of at least 2");
+        }
+        cells.reset(new Cell[capacity]);
+        for (size_t i = 0; i < capacity; ++i) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        mask = capacity - 1;
+    }
+
+    // Delete copy constructor and assignment operator
+    MpmcQueue(const MpmcQueue&) = delete;
+    MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+    // False when full; value is left untouched then
+    template <typename U>
+    bool try_push(U&& value) {
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells[pos & mask];
+            intptr_t dif = distance(cell->sequence.load(std::memory_order_acquire), pos);
+            if (dif == 0) {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (dif < 0) {
+                return false;  // the consumer a lap behind has not freed the cell
+            } else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = std::forward<U>(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // False when empty
+    bool try_pop(T& out) {
+        size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells[pos & mask];
+            intptr_t dif = distance(cell->sequence.load(std::memory_order_acquire), pos + 1);
+            if (dif == 0) {
+                if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (dif < 0) {
+                return false;  // no producer has published this position yet
+            } else {
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        out = std::move(cell->value);
+        cell->sequence.store(pos + mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Move up to count items from items[] in; returns how many went in,
+    // always a prefix, 0 only when the ring is full
+    size_t try_push_bulk(T* items, size_t count) {
+        if (count > mask + 1) {
+            count = mask + 1;
+        }
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        size_t claimed = 0;
+        while (count > 0) {
+            // Free cells are contiguous from pos; one CAS takes all of them
+            claimed = 0;
+            intptr_t dif = 0;
+            while (claimed < count) {
+                dif = distance(cells[(pos + claimed) & mask].sequence.load(std::memory_order_acquire),
+                               pos + claimed);
+                if (dif != 0) {
+                    break;
+                }
+                ++claimed;
+            }
+            if (claimed == 0) {
+                if (dif < 0) {
+                    return 0;
+                }
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+                continue;
+            }
+            if (enqueue_pos.compare_exchange_weak(pos, pos + claimed, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        for (size_t i = 0; i < claimed; ++i) {
+            Cell& cell = cells[(pos + i) & mask];
+            cell.value = std::move(items[i]);
+            cell.sequence.store(pos + i + 1, std::memory_order_release);
+        }
+        return claimed;
+    }
+
+    // Pop up to max items into out[]; returns how many, 0 when empty
+    size_t try_pop_bulk(T* out, size_t max) {
+        if (max > mask + 1) {
+            max = mask + 1;
+        }
+        size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        size_t claimed = 0;
+        while (max > 0) {
+            claimed = 0;
+            intptr_t dif = 0;
+            while (claimed < max) {
+                dif = distance(cells[(pos + claimed) & mask].sequence.load(std::memory_order_acquire),
+                               pos + claimed + 1);
+                if (dif != 0) {
+                    break;
+                }
+                ++claimed;
+            }
+            if (claimed == 0) {
+                if (dif < 0) {
+                    return 0;
+                }
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+                continue;
+            }
+            if (dequeue_pos.compare_exchange_weak(pos, pos + claimed, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        for (size_t i = 0; i < claimed; ++i) {
+            Cell& cell = cells[(pos + i) & mask];
+            out[i] = std::move(cell.value);
+            cell.sequence.store(pos + i + mask + 1, std::memory_order_release);
+        }
+        return claimed;
+    }
+
+    size_t capacity() const { return mask + 1; }
+
+    // A snapshot; may be stale by the time the caller looks at it
+    size_t size_approx() const {
+        size_t tail = enqueue_pos.load(std::memory_order_acquire);
+        size_t head = dequeue_pos.load(std::memory_order_acquire);
+        return tail > head ? tail - head : 0;
+    }
+};
+
+#endif
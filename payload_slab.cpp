@@ -0,0 +1,93 @@
+#include "payload_slab.h"
+#include <algorithm>
+#include <cstring>
+
+PayloadSlab::PayloadSlab() : oversize_bytes(0) {
+    for (uint8_t i = 0; i < CLASS_COUNT; ++i) {
+        classes[i].slot_size = MIN_SLOT_SIZE << i;
+    }
+}
+
+uint8_t PayloadSlab::class_for(size_t length) {
+    if (length > MAX_SLOT_SIZE) {
+        return OVERSIZE_CLASS;
+    }
+    uint8_t index = 0;
+    while ((MIN_SLOT_SIZE << index) < length) {
+        index++;
+    }
+    return index;
+}
+
+void PayloadSlab::grow(SizeClass& size_class) {
+    size_t slot_count = std::max<size_t>(1, PAYLOAD_SLAB_CHUNK_BYTES / size_class.slot_size);
+    chunks.push_back(std::make_unique<char[]>(slot_count * size_class.slot_size));
+    char* chunk = chunks.back().get();
+
+    // Thread the new slots onto the free list, first slot on top
+    for (size_t i = slot_count; i-- > 0;) {
+        char* slot = chunk + i * size_class.slot_size;
+        memcpy(slot, &size_class.free_list, sizeof(char*));
+        size_class.free_list = slot;
+    }
+    size_class.slots_reserved += slot_count;
+}
+
+PayloadRef PayloadSlab::store(const char* data, size_t length) {
+    PayloadRef ref;
+    if (length == 0) {
+        return ref;
+    }
+
+    ref.length = static_cast<uint32_t>(length);
+    ref.size_class = class_for(length);
+
+    if (ref.size_class == OVERSIZE_CLASS) {
+        ref.data = new char[length];
+        oversize_bytes += length;
+    } else {
+        SizeClass& size_class = classes[ref.size_class];
+        if (!size_class.free_list) {
+            grow(size_class);
+        }
+        ref.data = size_class.free_list;
+        memcpy(&size_class.free_list, ref.data, sizeof(char*));
+        size_class.slots_in_use++;
+    }
+
+    memcpy(ref.data, data, length);
+    return ref;
+}
+
+void PayloadSlab::release(PayloadRef& ref) {
+    if (!ref.data) {
+        return;
+    }
+
+    if (ref.size_class == OVERSIZE_CLASS) {
+        delete[] ref.data;
+        oversize_bytes -= ref.length;
+    } else {
+        SizeClass& size_class = classes[ref.size_class];
+        memcpy(ref.data, &size_class.free_list, sizeof(char*));
+        size_class.free_list = ref.data;
+        size_class.slots_in_use--;
+    }
+    ref = PayloadRef();
+}
+
+size_t PayloadSlab::get_reserved_bytes() const {
+    size_t total = oversize_bytes;
+    for (const SizeClass& size_class : classes) {
+        total += size_class.slots_reserved * size_class.slot_size;
+    }
+    return total;
+}
+
+size_t PayloadSlab::get_used_slots() const {
+    size_t total = 0;
+    for (const SizeClass& size_class : classes) {
+        total += size_class.slots_in_use;
+    }
+    return total;
+}
@@ -0,0 +1,65 @@
+#ifndef PAYLOAD_SLAB_H
+#define PAYLOAD_SLAB_H
+
+#include "common.h"
+#include <memory>
+#include <string_view>
+#include <vector>
+
+/**
+ * Size-class slab allocator for cache payloads
+ * Payloads are rounded up to a power-of-two class between MIN_SLOT_SIZE and
+ * MAX_SLOT_SIZE and stored in slots carved from PAYLOAD_SLAB_CHUNK_BYTES
+ * chunks. Freed slots go on a per-class free list (the link lives in the
+ * slot itself), so a cache that keeps evicting and inserting similar sizes
+ * stops allocating once warm. Larger payloads get their own allocation.
+ *
+ * Not thread-safe; each MessageCache owns one and uses it under its lock.
+ */
+class PayloadSlab {
+public:
+    static constexpr size_t MIN_SLOT_SIZE = 32;
+    static constexpr size_t MAX_SLOT_SIZE = 4096;
+    static constexpr uint8_t CLASS_COUNT = 8;          // 32, 64, ... 4096
+    static constexpr uint8_t OVERSIZE_CLASS = CLASS_COUNT;
+
+private:
+    struct SizeClass {
+        char* free_list;  // singly linked through the first bytes of each slot
+        size_t slot_size;
+        size_t slots_in_use;
+        size_t slots_reserved;
+
+        SizeClass() : free_list(nullptr), slot_size(0), slots_in_use(0), slots_reserved(0) {}
+    };
+
+    SizeClass classes[CLASS_COUNT];
+    std::vector<std::unique_ptr<char[]>> chunks;
+    size_t oversize_bytes;
+
+    static uint8_t class_for(size_t length);
+    void grow(SizeClass& size_class);
+
+public:
+    PayloadSlab();
+
+    // Delete copy constructor and assignment operator
+    PayloadSlab(const PayloadSlab&) = delete;
+    PayloadSlab& operator=(const PayloadSlab&) = delete;
+
+    // Copy data into a slot sized for it
+    PayloadRef store(const char* data, size_t length);
+
+    // Return the slot to its free list; ref is left empty
+    void release(PayloadRef& ref);
+
+    static std::string_view view(const PayloadRef& ref) {
+        return std::string_view(ref.data, ref.length);
+    }
+
+    // Bytes held in slab chunks (in use or free) plus live oversize payloads
+    size_t get_reserved_bytes() const;
+    size_t get_used_slots() const;
+};
+
+#endif
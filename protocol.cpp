@@ -0,0 +1,140 @@
+#include "protocol.h"
+#include <algorithm>
+#include <arpa/inet.h>
+
+namespace {
+void put_u16(char* out, uint16_t value) {
+    uint16_t be = htons(value);
+    memcpy(out, &be, sizeof(be));
+}
+
+void put_u32(char* out, uint32_t value) {
+    uint32_t be = htonl(value);
+    memcpy(out, &be, sizeof(be));
+}
+
+void put_i64(char* out, int64_t value) {
+    uint64_t bits = static_cast<uint64_t>(value);
+    put_u32(out, static_cast<uint32_t>(bits >> 32));
+    put_u32(out + 4, static_cast<uint32_t>(bits & 0xFFFFFFFFu));
+}
+
+uint32_t get_u32(const char* in) {
+    uint32_t be;
+    memcpy(&be, in, sizeof(be));
+    return ntohl(be);
+}
+
+int64_t get_i64(const char* in) {
+    uint64_t high = get_u32(in);
+    uint64_t low = get_u32(in + 4);
+    return static_cast<int64_t>((high << 32) | low);
+}
+}
+
+void encode_frame_header(char* out, uint8_t type, uint8_t sender_len, uint32_t user_id,
+                         uint32_t payload_size, time_t timestamp) {
+    out[0] = static_cast<char>(type);
+    out[1] = static_cast<char>(sender_len);
+    put_u16(out + 2, 0);
+    put_u32(out + 4, user_id);
+    put_u32(out + 8, payload_size);
+    put_i64(out + 12, static_cast<int64_t>(timestamp));
+}
+
+std::string encode_frame(const Frame& frame) {
+    size_t sender_len = std::min(frame.sender.size(), static_cast<size_t>(USERNAME_MAX_LEN));
+    size_t payload_len = std::min(frame.payload.size(), static_cast<size_t>(MAX_FRAME_PAYLOAD));
+
+    std::string out(FRAME_HEADER_SIZE + sender_len + payload_len, '\0');
+    encode_frame_header(&out[0], frame.type, static_cast<uint8_t>(sender_len), frame.user_id,
+                        static_cast<uint32_t>(payload_len), frame.timestamp);
+    memcpy(&out[FRAME_HEADER_SIZE], frame.sender.data(), sender_len);
+    memcpy(&out[FRAME_HEADER_SIZE + sender_len], frame.payload.data(), payload_len);
+    return out;
+}
+
+std::string encode_legacy_message(const Frame& frame) {
+    Message msg;
+    msg.type = frame.type;
+    msg.user_id = frame.user_id;
+    msg.timestamp = frame.timestamp;
+    msg.set_sender(frame.sender);
+    msg.set_payload(frame.payload);
+    return std::string(reinterpret_cast<const char*>(&msg), sizeof(Message));
+}
+
+Frame frame_from_message(const Message& msg) {
+    Frame frame;
+    frame.type = msg.type;
+    frame.user_id = msg.user_id;
+    frame.timestamp = msg.timestamp;
+    frame.sender.assign(msg.sender, strnlen(msg.sender, sizeof(msg.sender)));
+    frame.payload.assign(msg.payload, strnlen(msg.payload, sizeof(msg.payload)));
+    return frame;
+}
+
+void FrameDecoder::feed(const char* data, size_t len) {
+    // Compact consumed bytes before growing the buffer
+    if (offset > 0 && offset == buffer.size()) {
+        buffer.clear();
+        offset = 0;
+    } else if (offset > buffer.size() / 2) {
+        buffer.erase(0, offset);
+        offset = 0;
+    }
+    buffer.append(data, len);
+}
+
+HelloStatus parse_hello(const std::string& buffer, std::string& user_id, size_t& consumed) {
+    size_t len = std::min(buffer.size(), static_cast<size_t>(BUFFER_SIZE - 1));
+    size_t name_len = strnlen(buffer.data(), len);
+
+    if (name_len == len) {
+        user_id.assign(buffer.data(), name_len);
+        consumed = name_len;
+        return HelloStatus::LEGACY;
+    }
+
+    // A framed client follows the NUL with FRAMING_TAG
+    size_t tag_start = name_len + 1;
+    size_t seen = std::min(buffer.size() - tag_start, FRAMING_TAG_LEN);
+    bool matches = buffer.compare(tag_start, seen, FRAMING_TAG, seen) == 0;
+    if (matches && seen < FRAMING_TAG_LEN) {
+        return HelloStatus::INCOMPLETE;
+    }
+
+    user_id.assign(buffer.data(), name_len);
+    consumed = matches ? tag_start + FRAMING_TAG_LEN : tag_start;
+    return matches ? HelloStatus::FRAMED : HelloStatus::LEGACY;
+}
+
+bool FrameDecoder::next(Frame& frame) {
+    if (error || buffered() < FRAME_HEADER_SIZE) {
+        return false;
+    }
+
+    const char* header = buffer.data() + offset;
+    uint8_t sender_len = static_cast<uint8_t>(header[1]);
+    uint32_t payload_size = get_u32(header + 8);
+
+    if (sender_len > USERNAME_MAX_LEN || payload_size > MAX_FRAME_PAYLOAD) {
+        error = true;
+        return false;
+    }
+
+    size_t frame_size = FRAME_HEADER_SIZE + sender_len + payload_size;
+    if (buffered() < frame_size) {
+        return false;
+    }
+
+    const char* body = header + FRAME_HEADER_SIZE;
+    frame.type = static_cast<uint8_t>(header[0]);
+    frame.user_id = get_u32(header + 4);
+    frame.timestamp = static_cast<time_t>(get_i64(header + 12));
+    frame.sender.assign(body, sender_len);
+    frame.payload.assign(body + sender_len, payload_size);
+
+    offset += frame_size;
+    return true;
+}
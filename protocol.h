@@ -0,0 +1,102 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include "common.h"
+#include <string>
+#include <cstddef>
+
+/**
+ * Length-prefixed wire framing
+ *
+ * Each frame is a fixed 20-byte header in network byte order followed by
+ * sender_len bytes of sender name and exactly payload_size payload bytes:
+ *
+ *   offset  size  field
+ *   0       1     type (MessageType)
+ *   1       1     sender_len
+ *   2       2     reserved (zero)
+ *   4       4     user_id
+ *   8       4     payload_size
+ *   12      8     timestamp (seconds since epoch, signed)
+ *
+ * Framing is negotiated during the username handshake: a client that
+ * understands it sends "<username>\0" FRAMING_TAG, and the server echoes
+ * FRAMING_TAG before any frame. Legacy clients send the bare username and
+ * keep exchanging fixed-size Message structs.
+ */
+constexpr size_t FRAME_HEADER_SIZE = 20;
+constexpr uint32_t MAX_FRAME_PAYLOAD = BUFFER_SIZE;
+constexpr char FRAMING_TAG[] = "FRAMED/1";
+constexpr size_t FRAMING_TAG_LEN = sizeof(FRAMING_TAG) - 1;
+
+// Decoded frame
+struct Frame {
+    uint8_t type;
+    uint32_t user_id;
+    time_t timestamp;
+    std::string sender;
+    std::string payload;
+
+    Frame() : type(0), user_id(0), timestamp(0) {}
+};
+
+// Write a frame header into out (FRAME_HEADER_SIZE bytes)
+void encode_frame_header(char* out, uint8_t type, uint8_t sender_len, uint32_t user_id,
+                         uint32_t payload_size, time_t timestamp);
+
+/**
+ * Username handshake parser
+ * Bytes reach the server as they arrive, so the hello may be split across
+ * reads. After a NUL, parsing waits until FRAMING_TAG_LEN more bytes are
+ * buffered or one of them stops matching the tag. A buffer with no NUL is
+ * a legacy bare username, which the original client sent in one write.
+ */
+enum class HelloStatus {
+    INCOMPLETE,
+    LEGACY,
+    FRAMED
+};
+
+// Parse the hello at the front of buffer; on LEGACY or FRAMED, user_id is
+// set and consumed is the number of handshake bytes to drop from the front
+HelloStatus parse_hello(const std::string& buffer, std::string& user_id, size_t& consumed);
+
+// Serialize a complete frame; sender is truncated to USERNAME_MAX_LEN and
+// payload to MAX_FRAME_PAYLOAD bytes
+std::string encode_frame(const Frame& frame);
+
+// Serialize a frame as a legacy fixed-size Message
+std::string encode_legacy_message(const Frame& frame);
+
+// Convert a legacy Message into a frame
+Frame frame_from_message(const Message& msg);
+
+/**
+ * Streaming frame decoder
+ * Accepts arbitrary byte chunks and yields complete frames; a read may end
+ * in the middle of a frame or contain several of them
+ */
+class FrameDecoder {
+private:
+    std::string buffer;
+    size_t offset;
+    bool error;
+
+public:
+    FrameDecoder() : offset(0), error(false) {}
+
+    // Append received bytes
+    void feed(const char* data, size_t len);
+
+    // Extract the next complete frame; false if more bytes are needed or
+    // the stream is malformed (see has_error)
+    bool next(Frame& frame);
+
+    // True once an oversized or invalid header was seen
+    bool has_error() const { return error; }
+
+    // Number of bytes buffered but not yet decoded
+    size_t buffered() const { return buffer.size() - offset; }
+};
+
+#endif
@@ -0,0 +1,244 @@
+#include "mpmc_queue.h"
+#include "thread_pool.h"
+#include "common.h"
+#include <iostream>
+#include <iomanip>
+#include <queue>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <cstdlib>
+
+// Microbenchmarks: the lock-free MPMC ring against the mutex + condition
+// variable queue it replaces, raw and as the ThreadPool's shared queue.
+// Usage: queue_bench [items]
+
+namespace {
+constexpr size_t RING_CAPACITY = 4096;
+constexpr size_t BATCH_SIZE = 32;
+
+void print_separator() {
+    std::cout << std::string(70, '=') << std::endl;
+}
+
+void print_header(const std::string& name) {
+    print_separator();
+    std::cout << "BENCH: " << name << std::endl;
+    print_separator();
+}
+
+void print_result(const std::string& label, size_t items, double seconds, bool ok) {
+    std::cout << "   " << std::left << std::setw(34) << label << std::right << std::fixed
+              << std::setprecision(2) << std::setw(8) << (items / seconds / 1e6) << " M items/s"
+              << (ok ? "" : "   ✗ checksum mismatch") << std::endl;
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// The ThreadPool's queue before the ring: std::queue under a mutex, with
+// consumers waiting on a condition variable
+class LockedQueue {
+private:
+    std::queue<uint64_t> items;
+    std::mutex mutex;
+    std::condition_variable ready;
+
+public:
+    void push(uint64_t value) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            items.push(value);
+        }
+        ready.notify_one();
+    }
+
+    uint64_t pop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        ready.wait(lock, [this] { return !items.empty(); });
+        uint64_t value = items.front();
+        items.pop();
+        return value;
+    }
+};
+
+// Each producer pushes values 1..per_producer; consumers sum what they get
+template <typename Produce, typename Consume>
+bool run_threads(int producers, int consumers, size_t per_producer, Produce produce, Consume consume) {
+    std::atomic<uint64_t> sum(0);
+    std::vector<std::thread> threads;
+    size_t total = per_producer * producers;
+    for (int c = 0; c < consumers; ++c) {
+        // Split the total so every consumer knows when to stop
+        size_t share = total / consumers + (static_cast<size_t>(c) < total % consumers ? 1 : 0);
+        threads.emplace_back([&sum, &consume, share]() { sum.fetch_add(consume(share)); });
+    }
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&produce, per_producer]() { produce(per_producer); });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    uint64_t expected = static_cast<uint64_t>(producers) * per_producer * (per_producer + 1) / 2;
+    return sum.load() == expected;
+}
+
+void bench_raw_queues(size_t items) {
+    print_header("Raw queue throughput (" + std::to_string(items) + " items per run)");
+    const int shapes[][2] = {{1, 1}, {2, 2}, {4, 4}, {1, 4}, {4, 1}};
+
+    for (const auto& shape : shapes) {
+        int producers = shape[0];
+        int consumers = shape[1];
+        size_t per_producer = items / producers;
+        std::string name = std::to_string(producers) + "P/" + std::to_string(consumers) + "C ";
+        std::cout << "\n" << name << "producers/consumers" << std::endl;
+
+        {
+            LockedQueue queue;
+            auto start = std::chrono::steady_clock::now();
+            bool ok = run_threads(
+                producers, consumers, per_producer,
+                [&queue](size_t n) {
+                    for (size_t i = 1; i <= n; ++i) queue.push(i);
+                },
+                [&queue](size_t n) {
+                    uint64_t sum = 0;
+                    for (size_t i = 0; i < n; ++i) sum += queue.pop();
+                    return sum;
+                });
+            print_result("mutex + condvar std::queue", per_producer * producers, seconds_since(start), ok);
+        }
+
+        {
+            MpmcQueue<uint64_t> queue(RING_CAPACITY);
+            auto start = std::chrono::steady_clock::now();
+            bool ok = run_threads(
+                producers, consumers, per_producer,
+                [&queue](size_t n) {
+                    for (size_t i = 1; i <= n; ++i) {
+                        while (!queue.try_push(i)) std::this_thread::yield();
+                    }
+                },
+                [&queue](size_t n) {
+                    uint64_t sum = 0;
+                    uint64_t value;
+                    for (size_t i = 0; i < n; ++i) {
+                        while (!queue.try_pop(value)) std::this_thread::yield();
+                        sum += value;
+                    }
+                    return sum;
+                });
+            print_result("MpmcQueue try_push/try_pop", per_producer * producers, seconds_since(start), ok);
+        }
+
+        {
+            MpmcQueue<uint64_t> queue(RING_CAPACITY);
+            auto start = std::chrono::steady_clock::now();
+            bool ok = run_threads(
+                producers, consumers, per_producer,
+                [&queue](size_t n) {
+                    uint64_t batch[BATCH_SIZE];
+                    size_t next = 1;
+                    while (next <= n) {
+                        size_t count = 0;
+                        for (; count < BATCH_SIZE && next + count <= n; ++count) batch[count] = next + count;
+                        size_t pushed = 0;
+                        while (pushed < count) {
+                            size_t k = queue.try_push_bulk(batch + pushed, count - pushed);
+                            if (k == 0) std::this_thread::yield();
+                            pushed += k;
+                        }
+                        next += count;
+                    }
+                },
+                [&queue](size_t n) {
+                    uint64_t sum = 0;
+                    uint64_t batch[BATCH_SIZE];
+                    size_t taken = 0;
+                    while (taken < n) {
+                        size_t want = n - taken < BATCH_SIZE ? n - taken : BATCH_SIZE;
+                        size_t k = queue.try_pop_bulk(batch, want);
+                        if (k == 0) std::this_thread::yield();
+                        for (size_t i = 0; i < k; ++i) sum += batch[i];
+                        taken += k;
+                    }
+                    return sum;
+                });
+            print_result("MpmcQueue bulk (32)", per_producer * producers, seconds_since(start), ok);
+        }
+    }
+}
+
+// Tasks from outside the pool, as the reactor threads submit them
+template <typename Pool>
+void bench_pool(const std::string& label, PoolMode mode, size_t tasks, int producers, bool bulk) {
+    std::atomic<uint64_t> done(0);
+    auto start = std::chrono::steady_clock::now();
+    {
+        Pool pool(THREAD_POOL_SIZE, mode);
+        start = std::chrono::steady_clock::now();
+        std::vector<std::thread> threads;
+        size_t per_producer = tasks / producers;
+        for (int p = 0; p < producers; ++p) {
+            threads.emplace_back([&pool, &done, per_producer, bulk]() {
+                auto task = [&done]() { done.fetch_add(1, std::memory_order_relaxed); };
+                if (!bulk) {
+                    for (size_t i = 0; i < per_producer; ++i) pool.enqueue(task);
+                    return;
+                }
+                std::vector<Task> batch(BATCH_SIZE);
+                for (size_t i = 0; i < per_producer; i += BATCH_SIZE) {
+                    size_t count = per_producer - i < BATCH_SIZE ? per_producer - i : BATCH_SIZE;
+                    for (size_t k = 0; k < count; ++k) batch[k].emplace(task);
+                    pool.enqueue_bulk(batch.begin(), batch.begin() + static_cast<long>(count));
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        while (done.load() < per_producer * producers) {
+            std::this_thread::yield();
+        }
+        tasks = per_producer * producers;
+    }
+    print_result(label, tasks, seconds_since(start), done.load() == tasks);
+}
+
+void bench_thread_pool(size_t tasks) {
+    print_header("ThreadPool shared queue (" + std::to_string(tasks) + " tasks per run, " +
+                 std::to_string(THREAD_POOL_SIZE) + " workers)");
+    const PoolMode modes[] = {PoolMode::SHARED_QUEUE, PoolMode::WORK_STEALING};
+    const int producer_counts[] = {1, 2};
+
+    for (PoolMode mode : modes) {
+        for (int producers : producer_counts) {
+            std::cout << "\n" << (mode == PoolMode::SHARED_QUEUE ? "Shared queue" : "Work-stealing")
+                      << ", " << producers << " external producer(s)" << std::endl;
+            bench_pool<LockedThreadPool>("locked enqueue", mode, tasks, producers, false);
+            bench_pool<ThreadPool>("lock-free enqueue", mode, tasks, producers, false);
+            bench_pool<LockedThreadPool>("locked enqueue_bulk (32)", mode, tasks, producers, true);
+            bench_pool<ThreadPool>("lock-free enqueue_bulk (32)", mode, tasks, producers, true);
+        }
+    }
+}
+}
+
+int main(int argc, char* argv[]) {
+    size_t items = argc > 1 ? static_cast<size_t>(std::strtoull(argv[1], nullptr, 10)) : 1000000;
+    if (items == 0) {
+        std::cerr << "Usage: " << argv[0] << " [items]" << std::endl;
+        return 1;
+    }
+    std::cout << "Hardware threads: " << std::thread::hardware_concurrency() << "\n" << std::endl;
+
+    bench_raw_queues(items);
+    std::cout << "\n\n";
+    bench_thread_pool(items / 4);
+    return 0;
+}
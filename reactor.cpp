@@ -0,0 +1,903 @@
+#include "reactor.h"
+#include "metrics.h"
+#include <algorithm>
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <netinet/tcp.h>
+#include <sys/timerfd.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#ifdef USE_IO_URING
+#include "reactor_uring.h"
+#else
+struct Reactor::UringEngine {};
+#endif
+
+namespace {
+constexpr int REACTOR_MAX_EVENTS = 256;
+constexpr size_t READ_CHUNK_SIZE = 16384;
+constexpr int FLUSH_MAX_IOV = 64;
+constexpr uint64_t TIMER_TICK_NS = static_cast<uint64_t>(TIMER_TICK_MS) * 1000000;
+constexpr uint64_t NS_PER_SECOND = 1000000000;
+
+// The I/O thread running on this thread, if any
+thread_local const void* current_io_thread = nullptr;
+
+// Milliseconds since the peer last ACKed anything, as nanoseconds
+uint64_t ack_age_ns(int fd) {
+    struct tcp_info info;
+    socklen_t len = sizeof(info);
+    if (getsockopt(fd, IPPROTO_TCP, TCP_INFO, &info, &len) != 0) {
+        return UINT64_MAX;
+    }
+    return static_cast<uint64_t>(info.tcpi_last_ack_recv) * 1000000;
+}
+
+bool set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0) return false;
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+}
+
+Reactor::Reactor(int num_threads, DataHandler data_handler, CloseHandler close_handler,
+                 size_t high_water, BackpressurePolicy policy)
+    : on_data(std::move(data_handler)), on_close(std::move(close_handler)),
+      accept_batch(ACCEPT_BATCH_SIZE), high_water_bytes(high_water), backpressure(policy),
+      epoch_ns(monotonic_ns()), idle_timeout_ns(CLIENT_IDLE_TIMEOUT_S * NS_PER_SECOND),
+      heartbeat_ns(HEARTBEAT_INTERVAL_S * NS_PER_SECOND),
+      slow_write_ns(SLOW_WRITE_TIMEOUT_S * NS_PER_SECOND),
+      flush_delay_ns(static_cast<uint64_t>(OUTBOUND_FLUSH_DELAY_US) * 1000),
+      stop(false), connection_count(0), next_thread(0), dropped_count(0) {
+    if (num_threads <= 0) {
+        throw std::invalid_argument("Reactor thread count must be positive");
+    }
+    if (high_water == 0) {
+        throw std::invalid_argument("Outbound high-water mark must be positive");
+    }
+    if (!on_data || !on_close) {
+        throw std::invalid_argument("Reactor handlers must be set");
+    }
+    
+    try {
+        io_threads.reserve(num_threads);
+        for (int i = 0; i < num_threads; ++i) {
+            auto io = std::make_unique<IoThread>();
+            io->index = i;
+            io->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+            if (io->epoll_fd < 0) {
+                throw std::runtime_error("epoll_create1 failed: " + std::string(strerror(errno)));
+            }
+            io->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (io->wake_fd < 0) {
+                close(io->epoll_fd);
+                throw std::runtime_error("eventfd failed: " + std::string(strerror(errno)));
+            }
+            io->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+            io->flush_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+            if (io->timer_fd < 0 || io->flush_timer_fd < 0) {
+                int saved = errno;
+                if (io->timer_fd >= 0) close(io->timer_fd);
+                if (io->flush_timer_fd >= 0) close(io->flush_timer_fd);
+                close(io->wake_fd);
+                close(io->epoll_fd);
+                throw std::runtime_error("timerfd_create failed: " + std::string(strerror(saved)));
+            }
+            
+            struct epoll_event ev;
+            memset(&ev, 0, sizeof(ev));
+            ev.events = EPOLLIN;
+            ev.data.fd = io->wake_fd;
+            bool added = epoll_ctl(io->epoll_fd, EPOLL_CTL_ADD, io->wake_fd, &ev) == 0;
+            ev.data.fd = io->timer_fd;
+            added = added && epoll_ctl(io->epoll_fd, EPOLL_CTL_ADD, io->timer_fd, &ev) == 0;
+            ev.data.fd = io->flush_timer_fd;
+            added = added && epoll_ctl(io->epoll_fd, EPOLL_CTL_ADD, io->flush_timer_fd, &ev) == 0;
+            if (!added) {
+                close(io->flush_timer_fd);
+                close(io->timer_fd);
+                close(io->wake_fd);
+                close(io->epoll_fd);
+                throw std::runtime_error("epoll_ctl failed: " + std::string(strerror(errno)));
+            }
+            
+#ifdef USE_IO_URING
+            // The epoll set above stays as the fallback if this fails
+            try {
+                io->uring = std::make_unique<UringEngine>();
+            } catch (const std::exception& e) {
+                if (i == 0) {
+                    std::cerr << "[Reactor] " << e.what() << "; using epoll" << std::endl;
+                }
+            }
+#endif
+            io_threads.push_back(std::move(io));
+        }
+        
+        for (size_t i = 0; i < io_threads.size(); ++i) {
+            IoThread* raw = io_threads[i].get();
+            raw->thread = std::thread([this, raw]() { run_loop(*raw); });
+#ifdef __linux__
+            std::string name = "reactor-" + std::to_string(i);
+            pthread_setname_np(raw->thread.native_handle(), name.c_str());
+#endif
+        }
+        std::cout << "[Reactor] Started with " << num_threads << " I/O threads ("
+                  << (io_threads[0]->uring ? "io_uring" : "epoll") << ")" << std::endl;
+    } catch (const std::exception& e) {
+        // If setup fails, stop whatever was started and rethrow
+        shutdown_threads();
+        throw;
+    }
+}
+
+Reactor::IoThread::IoThread()
+    : index(0), epoll_fd(-1), wake_fd(-1), timer_fd(-1), flush_timer_fd(-1), listen_fd(-1),
+      ticking(false) {}
+
+Reactor::IoThread::~IoThread() = default;
+
+Reactor::~Reactor() {
+    shutdown();
+    close_listeners();
+    
+    for (auto& io : io_threads) {
+        if (io->wake_fd >= 0) {
+            close(io->wake_fd);
+        }
+        if (io->timer_fd >= 0) {
+            close(io->timer_fd);
+        }
+        if (io->flush_timer_fd >= 0) {
+            close(io->flush_timer_fd);
+        }
+        if (io->epoll_fd >= 0) {
+            close(io->epoll_fd);
+        }
+    }
+}
+
+void Reactor::shutdown_threads() {
+    stop = true;
+    
+    for (auto& io : io_threads) {
+        uint64_t one = 1;
+        if (io->wake_fd >= 0) {
+            ssize_t ignored = write(io->wake_fd, &one, sizeof(one));
+            (void)ignored;
+        }
+    }
+    
+    for (auto& io : io_threads) {
+        if (io->thread.joinable()) {
+            io->thread.join();
+        }
+    }
+}
+
+void Reactor::shutdown() {
+    if (stop.exchange(true)) return;
+    
+    shutdown_threads();
+    close_listeners();
+    
+    for (auto& io : io_threads) {
+        std::lock_guard<std::mutex> lock(io->connections_mutex);
+        for (auto& [fd, conn] : io->connections) {
+            conn->closed = true;
+        }
+        connection_count -= static_cast<int>(io->connections.size());
+        io->connections.clear();
+        
+        std::lock_guard<std::mutex> flush_lock(io->flush_mutex);
+        io->flush_queue.clear();
+    }
+    std::cout << "[Reactor] All I/O threads terminated" << std::endl;
+}
+
+Reactor::ConnectionPtr Reactor::add_connection(int socket_fd) {
+    if (stop.load() || !set_nonblocking(socket_fd)) {
+        close(socket_fd);
+        return nullptr;
+    }
+    
+    unsigned index = next_thread.fetch_add(1) % io_threads.size();
+    return register_connection(*io_threads[index], socket_fd);
+}
+
+Reactor::ConnectionPtr Reactor::register_connection(IoThread& io, int socket_fd) {
+    // The connection owns the fd from here on, including on failure
+    auto conn = std::make_shared<Connection>(socket_fd);
+    if (stop.load()) {
+        return nullptr;
+    }
+    conn->io_thread = io.index;
+    conn->last_read_ns = monotonic_ns();
+    conn->last_write_ns = conn->last_read_ns;
+    
+    // Coalescing is done here, so the kernel should not add its own delay
+    int nodelay = 1;
+    setsockopt(socket_fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+    
+    // Keepalive probes get ACKs out of clients that only listen, which the
+    // idle timer counts as life, and let the kernel drop peers that vanished
+    int probe_s = static_cast<int>(std::max<uint64_t>(heartbeat_ns / NS_PER_SECOND, 1));
+    int keepalive = 1;
+    int probes = KEEPALIVE_PROBES;
+    setsockopt(socket_fd, SOL_SOCKET, SO_KEEPALIVE, &keepalive, sizeof(keepalive));
+    setsockopt(socket_fd, IPPROTO_TCP, TCP_KEEPIDLE, &probe_s, sizeof(probe_s));
+    setsockopt(socket_fd, IPPROTO_TCP, TCP_KEEPINTVL, &probe_s, sizeof(probe_s));
+    setsockopt(socket_fd, IPPROTO_TCP, TCP_KEEPCNT, &probes, sizeof(probes));
+    
+    {
+        std::lock_guard<std::mutex> lock(io.connections_mutex);
+        io.connections[socket_fd] = conn;
+    }
+    
+#ifdef USE_IO_URING
+    // Requests are only ever prepared by the owning thread; from elsewhere,
+    // an empty flush hands the connection over
+    if (io.uring) {
+        connection_count++;
+        if (current_io_thread == &io) {
+            uring_watch(io, conn);
+        } else {
+            schedule_flush(conn);
+        }
+        return conn;
+    }
+#endif
+    
+    // Register for both directions once; edge-triggered mode means we only
+    // hear about transitions, so there is nothing to re-arm later
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.fd = socket_fd;
+    if (epoll_ctl(io.epoll_fd, EPOLL_CTL_ADD, socket_fd, &ev) < 0) {
+        std::cerr << "[Reactor] epoll_ctl ADD failed for fd " << socket_fd
+                  << ": " << strerror(errno) << std::endl;
+        conn->closed = true;
+        std::lock_guard<std::mutex> lock(io.connections_mutex);
+        io.connections.erase(socket_fd);
+        return nullptr;
+    }
+    
+    connection_count++;
+    return conn;
+}
+
+bool Reactor::listen(int port, AcceptHandler handler, int batch, int backlog) {
+    if (!handler || batch <= 0) {
+        throw std::invalid_argument("listen needs a handler and a positive batch size");
+    }
+    on_accept = std::move(handler);
+    accept_batch = batch;
+    
+    for (auto& io : io_threads) {
+        int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            std::cerr << "[Reactor] socket failed: " << strerror(errno) << std::endl;
+            close_listeners();
+            return false;
+        }
+        
+        // Every listener must set SO_REUSEPORT before bind to share the port
+        int opt = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+        if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
+            std::cerr << "[Reactor] SO_REUSEPORT failed: " << strerror(errno) << std::endl;
+            close(fd);
+            close_listeners();
+            return false;
+        }
+        
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = INADDR_ANY;
+        addr.sin_port = htons(port);
+        if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || ::listen(fd, backlog) < 0) {
+            std::cerr << "[Reactor] Cannot listen on port " << port << ": " << strerror(errno) << std::endl;
+            close(fd);
+            close_listeners();
+            return false;
+        }
+        
+        io->listen_fd = fd;
+#ifdef USE_IO_URING
+        // The thread arms a multishot accept on the new listener when woken
+        if (io->uring) {
+            uint64_t one = 1;
+            ssize_t ignored = write(io->wake_fd, &one, sizeof(one));
+            (void)ignored;
+            continue;
+        }
+#endif
+        
+        // Level-triggered: connections left over after a batch wake us again
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        if (epoll_ctl(io->epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            std::cerr << "[Reactor] epoll_ctl ADD failed for listener: " << strerror(errno) << std::endl;
+            close_listeners();
+            return false;
+        }
+    }
+    
+    std::cout << "[Reactor] Listening on port " << port << " with " << io_threads.size()
+              << " SO_REUSEPORT listeners" << std::endl;
+    return true;
+}
+
+void Reactor::close_listeners() {
+    for (auto& io : io_threads) {
+        if (io->listen_fd >= 0) {
+            epoll_ctl(io->epoll_fd, EPOLL_CTL_DEL, io->listen_fd, nullptr);
+            // Also ends a multishot accept, which holds its own file reference
+            ::shutdown(io->listen_fd, SHUT_RDWR);
+            close(io->listen_fd);
+            io->listen_fd = -1;
+        }
+    }
+}
+
+void Reactor::set_idle_timeout(uint64_t seconds) {
+    idle_timeout_ns = seconds * NS_PER_SECOND;
+}
+
+void Reactor::set_heartbeat_interval(uint64_t seconds) {
+    heartbeat_ns = seconds * NS_PER_SECOND;
+}
+
+bool Reactor::pin_threads() {
+    unsigned cpus = std::thread::hardware_concurrency();
+    if (cpus == 0) {
+        return false;
+    }
+    
+    bool pinned = true;
+    for (auto& io : io_threads) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(static_cast<unsigned>(io->index) % cpus, &set);
+        if (pthread_setaffinity_np(io->thread.native_handle(), sizeof(set), &set) != 0) {
+            pinned = false;
+        }
+    }
+    return pinned;
+}
+
+void Reactor::handle_accept(IoThread& io) {
+    for (int accepted = 0; accepted < accept_batch; ) {
+        struct sockaddr_in addr;
+        socklen_t addr_len = sizeof(addr);
+        int fd = accept4(io.listen_fd, (struct sockaddr*)&addr, &addr_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                std::cerr << "[Reactor] accept4 failed: " << strerror(errno) << std::endl;
+            }
+            return;
+        }
+        accepted++;
+        
+        if (!on_accept(fd, addr)) {
+            close(fd);
+            continue;
+        }
+        register_connection(io, fd);
+    }
+}
+
+SendResult Reactor::send(const ConnectionPtr& conn, const void* data, size_t len) {
+    return send(conn, std::make_shared<const std::string>(static_cast<const char*>(data), len));
+}
+
+SendResult Reactor::send(const ConnectionPtr& conn, SharedBuffer buffer) {
+    if (conn->closed.load()) {
+        return SendResult::CLOSED;
+    }
+    if (!buffer || buffer->empty()) {
+        return SendResult::QUEUED;
+    }
+    
+    bool over_limit = false;
+    {
+        std::lock_guard<std::mutex> lock(conn->outbound_mutex);
+        over_limit = conn->outbound_bytes + buffer->size() > high_water_bytes;
+        if (!over_limit) {
+            conn->outbound_bytes += buffer->size();
+            conn->outbound.push_back(std::move(buffer));
+        }
+    }
+    
+    if (over_limit) {
+        if (backpressure == BackpressurePolicy::DROP) {
+            dropped_count++;
+            return SendResult::DROPPED;
+        }
+        std::cerr << "[Reactor] fd " << conn->socket_fd
+                  << " exceeded outbound high-water mark, disconnecting" << std::endl;
+        close_connection(conn);
+        return SendResult::CLOSED;
+    }
+    
+    schedule_flush(conn);
+    return SendResult::QUEUED;
+}
+
+SendResult Reactor::send_gather(const ConnectionPtr& conn, const struct iovec* iov, int count) {
+    if (conn->closed.load()) {
+        return SendResult::CLOSED;
+    }
+    
+    size_t total = 0;
+    for (int i = 0; i < count; ++i) {
+        total += iov[i].iov_len;
+    }
+    if (total == 0) {
+        return SendResult::QUEUED;
+    }
+    
+    std::unique_lock<std::mutex> lock(conn->outbound_mutex);
+    
+    // Only write directly when that cannot reorder bytes already queued or
+    // being sent by the I/O thread
+    size_t written = 0;
+    if (conn->outbound.empty() && !conn->send_in_flight) {
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = const_cast<struct iovec*>(iov);
+        msg.msg_iovlen = static_cast<size_t>(count);
+        
+        while (true) {
+            uint64_t started = monotonic_ns();
+            ssize_t sent = sendmsg(conn->socket_fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+            MetricsRegistry::instance().record(Latency::SEND_DURATION, monotonic_ns() - started);
+            MetricsRegistry::instance().add(Counter::SEND_CALLS);
+            if (sent >= 0) {
+                written = static_cast<size_t>(sent);
+                if (sent > 0) {
+                    conn->last_write_ns.store(monotonic_ns(), std::memory_order_relaxed);
+                }
+                break;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            lock.unlock();
+            close_connection(conn);
+            return SendResult::CLOSED;
+        }
+        if (written == total) {
+            return SendResult::QUEUED;
+        }
+    }
+    
+    // Copy the remainder so the caller's buffers can be released
+    auto rest = std::make_shared<std::string>();
+    rest->reserve(total - written);
+    size_t skip = written;
+    for (int i = 0; i < count; ++i) {
+        if (skip >= iov[i].iov_len) {
+            skip -= iov[i].iov_len;
+            continue;
+        }
+        rest->append(static_cast<const char*>(iov[i].iov_base) + skip, iov[i].iov_len - skip);
+        skip = 0;
+    }
+    
+    if (conn->outbound_bytes + rest->size() > high_water_bytes) {
+        lock.unlock();
+        if (backpressure == BackpressurePolicy::DROP && written == 0) {
+            dropped_count++;
+            return SendResult::DROPPED;
+        }
+        // A partly written message cannot be dropped without corrupting the stream
+        std::cerr << "[Reactor] fd " << conn->socket_fd
+                  << " exceeded outbound high-water mark, disconnecting" << std::endl;
+        close_connection(conn);
+        return SendResult::CLOSED;
+    }
+    conn->outbound_bytes += rest->size();
+    conn->outbound.push_back(std::move(rest));
+    lock.unlock();
+    
+    schedule_flush(conn);
+    return SendResult::QUEUED;
+}
+
+void Reactor::schedule_flush(const ConnectionPtr& conn) {
+    // One pending entry per connection, however many buffers get queued
+    if (conn->flush_scheduled.exchange(true)) {
+        return;
+    }
+    
+    IoThread& io = *io_threads[conn->io_thread];
+    bool was_empty;
+    {
+        std::lock_guard<std::mutex> lock(io.flush_mutex);
+        was_empty = io.flush_queue.empty();
+        io.flush_queue.push_back(conn);
+    }
+    
+    if (!was_empty) {
+        return;
+    }
+    
+    // Let the first buffer wait up to the flush delay, so whatever is queued
+    // for this thread's connections meanwhile goes out in the same writes
+    uint64_t delay = flush_delay_ns.load(std::memory_order_relaxed);
+    if (delay > 0) {
+        struct itimerspec spec;
+        memset(&spec, 0, sizeof(spec));
+        spec.it_value.tv_sec = static_cast<time_t>(delay / NS_PER_SECOND);
+        spec.it_value.tv_nsec = static_cast<long>(delay % NS_PER_SECOND);
+        if (timerfd_settime(io.flush_timer_fd, 0, &spec, nullptr) == 0) {
+            return;
+        }
+    }
+    uint64_t one = 1;
+    ssize_t ignored = write(io.wake_fd, &one, sizeof(one));
+    (void)ignored;
+}
+
+void Reactor::run_flush_queue(IoThread& io) {
+    std::vector<ConnectionPtr> pending;
+    {
+        std::lock_guard<std::mutex> lock(io.flush_mutex);
+        pending.swap(io.flush_queue);
+    }
+    
+    for (auto& conn : pending) {
+        // Clear first so buffers queued during the flush schedule another one
+        conn->flush_scheduled = false;
+        if (!conn->closed.load()) {
+            flush_outbound(conn);
+        }
+    }
+}
+
+bool Reactor::flush_outbound(const ConnectionPtr& conn) {
+#ifdef USE_IO_URING
+    IoThread& owner = *io_threads[conn->io_thread];
+    if (owner.uring) {
+        uring_flush(owner, conn);
+        return !conn->closed.load();
+    }
+#endif
+    std::unique_lock<std::mutex> lock(conn->outbound_mutex);
+    
+    while (!conn->outbound.empty()) {
+        struct iovec iov[FLUSH_MAX_IOV];
+        int count = 0;
+        size_t skip = conn->outbound_offset;
+        auto it = conn->outbound.begin();
+        for (; it != conn->outbound.end() && count < FLUSH_MAX_IOV; ++it) {
+            iov[count].iov_base = const_cast<char*>((*it)->data()) + skip;
+            iov[count].iov_len = (*it)->size() - skip;
+            skip = 0;
+            ++count;
+        }
+        // More than one iovec batch queued: let the kernel fill whole segments
+        int flags = MSG_NOSIGNAL | (it != conn->outbound.end() ? MSG_MORE : 0);
+        
+        // sendmsg rather than writev so MSG_NOSIGNAL can be passed
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = static_cast<size_t>(count);
+        
+        uint64_t started = monotonic_ns();
+        ssize_t sent = sendmsg(conn->socket_fd, &msg, flags);
+        MetricsRegistry::instance().record(Latency::SEND_DURATION, monotonic_ns() - started);
+        MetricsRegistry::instance().add(Counter::SEND_CALLS);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                // Wait for the next EPOLLOUT edge, but not forever
+                arm_write_timer(*io_threads[conn->io_thread], conn);
+                return true;
+            }
+            lock.unlock();
+            close_connection(conn);
+            return false;
+        }
+        
+        consume_outbound(*conn, static_cast<size_t>(sent));
+    }
+    
+    return true;
+}
+
+void Reactor::consume_outbound(Connection& conn, size_t sent) {
+    // Release fully written buffers and remember the partial one
+    if (sent > 0) {
+        conn.last_write_ns.store(monotonic_ns(), std::memory_order_relaxed);
+    }
+    conn.outbound_bytes -= sent;
+    while (sent > 0) {
+        size_t front_left = conn.outbound.front()->size() - conn.outbound_offset;
+        if (sent >= front_left) {
+            sent -= front_left;
+            conn.outbound.pop_front();
+            conn.outbound_offset = 0;
+        } else {
+            conn.outbound_offset += sent;
+            sent = 0;
+        }
+    }
+}
+
+void Reactor::arm_write_timer(IoThread& io, const ConnectionPtr& conn) {
+    if (!conn->write_timer_armed && slow_write_ns > 0) {
+        conn->write_timer_armed = true;
+        schedule_timer(io, conn, TimerKind::SLOW_WRITE, slow_write_ns);
+    }
+}
+
+void Reactor::handle_readable(const ConnectionPtr& conn) {
+    char chunk[READ_CHUNK_SIZE];
+    
+    // Edge-triggered: keep reading until the kernel buffer is drained
+    while (!conn->closed.load()) {
+        ssize_t bytes = recv(conn->socket_fd, chunk, sizeof(chunk), 0);
+        
+        if (bytes > 0) {
+            conn->last_read_ns = monotonic_ns();
+            conn->read_buffer.append(chunk, static_cast<size_t>(bytes));
+            on_data(conn);
+            continue;
+        }
+        
+        if (bytes < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return;
+        }
+        
+        // Orderly shutdown by the peer or a real error
+        close_connection(conn);
+        return;
+    }
+}
+
+void Reactor::close_connection(const ConnectionPtr& conn) {
+    // After shutdown the connection tables are already gone
+    if (conn->closed.exchange(true) || stop.load()) {
+        return;
+    }
+    
+    IoThread& io = *io_threads[conn->io_thread];
+    
+    // With io_uring the shutdown completes the connection's pending requests
+    if (!io.uring) {
+        epoll_ctl(io.epoll_fd, EPOLL_CTL_DEL, conn->socket_fd, nullptr);
+    }
+    ::shutdown(conn->socket_fd, SHUT_RDWR);
+    
+    {
+        std::lock_guard<std::mutex> lock(io.connections_mutex);
+        io.connections.erase(conn->socket_fd);
+    }
+    connection_count--;
+    
+    on_close(conn);
+}
+
+uint64_t Reactor::ticks_for(uint64_t ns) const {
+    return std::max<uint64_t>(1, (ns + TIMER_TICK_NS - 1) / TIMER_TICK_NS);
+}
+
+void Reactor::schedule_timer(IoThread& io, const ConnectionPtr& conn, TimerKind kind, uint64_t delay_ns) {
+    uint64_t now = monotonic_ns();
+    if (!io.ticking) {
+        // The wheel stood still while empty; catch it up before adding to it
+        io.timers.advance((now - epoch_ns) / TIMER_TICK_NS, [](ConnectionTimer&) { return uint64_t(0); });
+    }
+    io.timers.schedule(ticks_for(delay_ns), ConnectionTimer(conn, kind, now));
+    if (io.ticking) {
+        return;
+    }
+    
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    spec.it_interval.tv_nsec = static_cast<long>(TIMER_TICK_NS);
+    spec.it_value.tv_nsec = static_cast<long>(TIMER_TICK_NS);
+    if (timerfd_settime(io.timer_fd, 0, &spec, nullptr) == 0) {
+        io.ticking = true;
+    } else {
+        std::cerr << "[Reactor] timerfd_settime failed: " << strerror(errno) << std::endl;
+    }
+}
+
+void Reactor::arm_connection_timers(IoThread& io, const ConnectionPtr& conn) {
+    conn->timers_armed = true;
+    if (idle_timeout_ns > 0) {
+        schedule_timer(io, conn, TimerKind::IDLE, idle_timeout_ns);
+    }
+    if (on_heartbeat && heartbeat_ns > 0) {
+        schedule_timer(io, conn, TimerKind::HEARTBEAT, heartbeat_ns);
+    }
+}
+
+uint64_t Reactor::on_timer(ConnectionTimer& timer) {
+    ConnectionPtr conn = timer.conn.lock();
+    if (!conn || conn->closed.load()) {
+        return 0;
+    }
+    
+    uint64_t now = monotonic_ns();
+    switch (timer.kind) {
+        case TimerKind::IDLE: {
+            // Input or an ACK of our heartbeats and keepalive probes both show
+            // the peer is still there; only a peer silent on both is reaped
+            uint64_t quiet = now - conn->last_read_ns;
+            if (quiet >= idle_timeout_ns) {
+                quiet = std::min(quiet, ack_age_ns(conn->socket_fd));
+            }
+            if (quiet < idle_timeout_ns) {
+                return ticks_for(idle_timeout_ns - quiet);
+            }
+            std::cout << "[Reactor] Closing fd " << conn->socket_fd << " after "
+                      << quiet / NS_PER_SECOND << "s without input or ACKs" << std::endl;
+            close_connection(conn);
+            return 0;
+        }
+        case TimerKind::HEARTBEAT: {
+            uint64_t quiet = now - conn->last_write_ns.load(std::memory_order_relaxed);
+            if (quiet < heartbeat_ns) {
+                return ticks_for(heartbeat_ns - quiet);
+            }
+            on_heartbeat(conn);
+            return ticks_for(heartbeat_ns);
+        }
+        case TimerKind::SLOW_WRITE: {
+            {
+                std::lock_guard<std::mutex> lock(conn->outbound_mutex);
+                if (conn->outbound.empty()) {
+                    conn->write_timer_armed = false;
+                    return 0;
+                }
+            }
+            uint64_t progress = std::max(conn->last_write_ns.load(std::memory_order_relaxed), timer.armed_ns);
+            uint64_t stalled = now - progress;
+            if (stalled < slow_write_ns) {
+                return ticks_for(slow_write_ns - stalled);
+            }
+            std::cerr << "[Reactor] fd " << conn->socket_fd << " made no write progress for "
+                      << stalled / NS_PER_SECOND << "s, disconnecting" << std::endl;
+            close_connection(conn);
+            return 0;
+        }
+    }
+    return 0;
+}
+
+void Reactor::run_timers(IoThread& io) {
+    uint64_t expirations;
+    ssize_t ignored = read(io.timer_fd, &expirations, sizeof(expirations));
+    (void)ignored;
+    
+    io.timers.advance((monotonic_ns() - epoch_ns) / TIMER_TICK_NS,
+                      [this](ConnectionTimer& timer) { return on_timer(timer); });
+    
+    // Nothing left to watch: stop the periodic wakeups until the next timer
+    if (io.timers.empty() && io.ticking) {
+        struct itimerspec spec;
+        memset(&spec, 0, sizeof(spec));
+        timerfd_settime(io.timer_fd, 0, &spec, nullptr);
+        io.ticking = false;
+    }
+}
+
+int Reactor::get_connection_count() const {
+    return connection_count.load();
+}
+
+void Reactor::run_loop(IoThread& io) {
+    current_io_thread = &io;
+#ifdef USE_IO_URING
+    if (io.uring) {
+        uring_loop(io);
+        return;
+    }
+#endif
+    io_loop(io);
+}
+
+void Reactor::io_loop(IoThread& io) {
+    std::vector<struct epoll_event> events(REACTOR_MAX_EVENTS);
+    
+    while (!stop.load()) {
+        int ready = epoll_wait(io.epoll_fd, events.data(), REACTOR_MAX_EVENTS, -1);
+        
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "[Reactor] epoll_wait failed: " << strerror(errno) << std::endl;
+            break;
+        }
+        
+        for (int i = 0; i < ready; ++i) {
+            int fd = events[i].data.fd;
+            
+            if (fd == io.listen_fd) {
+                handle_accept(io);
+                continue;
+            }
+            
+            if (fd == io.timer_fd) {
+                run_timers(io);
+                continue;
+            }
+            
+            if (fd == io.flush_timer_fd) {
+                uint64_t expirations;
+                ssize_t ignored = read(io.flush_timer_fd, &expirations, sizeof(expirations));
+                (void)ignored;
+                run_flush_queue(io);
+                continue;
+            }
+            
+            if (fd == io.wake_fd) {
+                uint64_t value;
+                ssize_t ignored = read(io.wake_fd, &value, sizeof(value));
+                (void)ignored;
+                run_flush_queue(io);
+                continue;
+            }
+            
+            ConnectionPtr conn;
+            {
+                std::lock_guard<std::mutex> lock(io.connections_mutex);
+                auto it = io.connections.find(fd);
+                if (it != io.connections.end()) {
+                    conn = it->second;
+                }
+            }
+            if (!conn) {
+                continue;
+            }
+            
+            // The first event for a new socket is its initial EPOLLOUT edge
+            if (!conn->timers_armed) {
+                arm_connection_timers(io, conn);
+            }
+            
+            uint32_t flags = events[i].events;
+            
+            if (flags & EPOLLERR) {
+                close_connection(conn);
+                continue;
+            }
+            
+            if ((flags & EPOLLOUT) && !flush_outbound(conn)) {
+                continue;
+            }
+            
+            if (flags & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)) {
+                handle_readable(conn);
+            }
+        }
+    }
+}
@@ -0,0 +1,196 @@
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include "connection.h"
+#include <vector>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <functional>
+#include <stdexcept>
+#include <sys/uio.h>
+#include <netinet/in.h>
+
+struct UringCompletion;
+
+// What to do with a client whose outbound queue passes the high-water mark
+enum class BackpressurePolicy : uint8_t {
+    DROP,       // discard the new buffer, keep the connection
+    DISCONNECT  // close the connection
+};
+
+enum class SendResult : uint8_t {
+    QUEUED,
+    DROPPED,
+    CLOSED
+};
+
+/**
+ * Event-driven I/O multiplexer built on edge-triggered epoll
+ * A few I/O threads each own an epoll instance and service many
+ * non-blocking sockets; complete messages are handed off through callbacks.
+ * Outgoing data is queued per connection and written only by the owning
+ * I/O thread, so callers never block on a slow receiver. Output queued within
+ * the flush delay is coalesced and written with one sendmsg() per connection.
+ * The one exception is send_gather(), which may write from the calling
+ * thread: non-blocking, under the connection's outbound lock, and only when
+ * nothing is queued or held by an in-flight io_uring send, so bytes are
+ * never reordered.
+ *
+ * Each I/O thread also drives a timer wheel for its connections' idle,
+ * heartbeat and slow-write deadlines off one timerfd, which only ticks while
+ * some timer is pending. Deadlines are checked lazily: activity just stamps
+ * the connection, and an expired timer re-arms itself for the remainder.
+ * A client that only listens still counts as alive while its TCP stack ACKs
+ * our heartbeats or the keepalive probes sent at the heartbeat interval.
+ *
+ * Built with USE_IO_URING, each I/O thread instead drives an io_uring when
+ * the kernel provides one: multishot accept and receive into a pool of
+ * provided buffers, sockets in the registered file table, and every request
+ * prepared while handling a batch of completions submitted together. Threads
+ * fall back to epoll when io_uring cannot be set up.
+ */
+class Reactor {
+public:
+    using ConnectionPtr = std::shared_ptr<Connection>;
+    // Called on the I/O thread after new bytes were appended to read_buffer
+    using DataHandler = std::function<void(const ConnectionPtr&)>;
+    // Called once per connection after it has been removed from the reactor
+    using CloseHandler = std::function<void(const ConnectionPtr&)>;
+    // Called on the I/O thread for each accepted socket; false rejects it
+    using AcceptHandler = std::function<bool(int socket_fd, const struct sockaddr_in& addr)>;
+    // Called on the I/O thread when a connection has sent nothing for the heartbeat interval
+    using HeartbeatHandler = std::function<void(const ConnectionPtr&)>;
+
+private:
+    struct UringEngine;  // per-thread io_uring state, see reactor_uring.h
+
+    struct IoThread {
+        int index;
+        int epoll_fd;
+        int wake_fd;
+        int timer_fd;                 // ticks the wheel while it holds timers
+        int flush_timer_fd;           // one-shot, fires flush_delay after output is queued
+        std::atomic<int> listen_fd;  // this thread's SO_REUSEPORT listener, -1 until listen()
+        std::thread thread;
+        std::mutex connections_mutex;
+        std::unordered_map<int, ConnectionPtr> connections;
+
+        // Connections with newly queued output, drained on wake_fd
+        std::mutex flush_mutex;
+        std::vector<ConnectionPtr> flush_queue;
+
+        // Touched only by this thread
+        ConnectionTimerWheel timers;
+        bool ticking;
+        std::unique_ptr<UringEngine> uring;  // nullptr when the thread runs epoll
+
+        // Out of line, where UringEngine is complete
+        IoThread();
+        ~IoThread();
+    };
+
+    std::vector<std::unique_ptr<IoThread>> io_threads;
+    DataHandler on_data;
+    CloseHandler on_close;
+    AcceptHandler on_accept;
+    HeartbeatHandler on_heartbeat;
+    int accept_batch;
+    size_t high_water_bytes;
+    BackpressurePolicy backpressure;
+    uint64_t epoch_ns;  // tick 0 of every timer wheel
+    uint64_t idle_timeout_ns;
+    uint64_t heartbeat_ns;
+    uint64_t slow_write_ns;
+    std::atomic<uint64_t> flush_delay_ns;
+    std::atomic<bool> stop;
+    std::atomic<int> connection_count;
+    std::atomic<unsigned> next_thread;
+    std::atomic<uint64_t> dropped_count;
+
+    void run_loop(IoThread& io);
+    void io_loop(IoThread& io);
+    void handle_readable(const ConnectionPtr& conn);
+    void handle_accept(IoThread& io);
+    ConnectionPtr register_connection(IoThread& io, int socket_fd);
+    void close_listeners();
+    void schedule_flush(const ConnectionPtr& conn);
+    void run_flush_queue(IoThread& io);
+    bool flush_outbound(const ConnectionPtr& conn);
+    void consume_outbound(Connection& conn, size_t sent);
+    void arm_write_timer(IoThread& io, const ConnectionPtr& conn);
+    uint64_t ticks_for(uint64_t ns) const;
+    void schedule_timer(IoThread& io, const ConnectionPtr& conn, TimerKind kind, uint64_t delay_ns);
+    void arm_connection_timers(IoThread& io, const ConnectionPtr& conn);
+    void run_timers(IoThread& io);
+    uint64_t on_timer(ConnectionTimer& timer);
+#ifdef USE_IO_URING
+    void uring_loop(IoThread& io);
+    void uring_complete(IoThread& io, const UringCompletion& completion);
+    void uring_watch(IoThread& io, const ConnectionPtr& conn);
+    void uring_flush(IoThread& io, const ConnectionPtr& conn);
+#endif
+    void shutdown_threads();
+
+public:
+    Reactor(int num_threads, DataHandler data_handler, CloseHandler close_handler,
+            size_t high_water = OUTBOUND_HIGH_WATER_BYTES,
+            BackpressurePolicy policy = BackpressurePolicy::DISCONNECT);
+    ~Reactor();
+
+    // Delete copy constructor and assignment operator
+    Reactor(const Reactor&) = delete;
+    Reactor& operator=(const Reactor&) = delete;
+
+    // Make the socket non-blocking and start watching it; nullptr on failure
+    ConnectionPtr add_connection(int socket_fd);
+    
+    /**
+     * Give every I/O thread its own SO_REUSEPORT listener on the port, so the
+     * kernel spreads new connections across threads and each one accepts
+     * into its own epoll set. Up to batch connections are accepted per
+     * wakeup before the thread goes back to serving I/O.
+     */
+    bool listen(int port, AcceptHandler handler, int batch = ACCEPT_BATCH_SIZE, int backlog = MAX_CLIENTS);
+    
+    // Set before connections arrive; without one no heartbeats are scheduled
+    void set_heartbeat_handler(HeartbeatHandler handler) { on_heartbeat = std::move(handler); }
+    
+    // Set before connections arrive; 0 never reaps idle connections
+    void set_idle_timeout(uint64_t seconds);
+    
+    // Set before connections arrive; also paces TCP keepalive probes
+    void set_heartbeat_interval(uint64_t seconds);
+    
+    // How long queued output may wait for more to join it; 0 flushes at once
+    void set_flush_delay(uint64_t delay_us) { flush_delay_ns = delay_us * 1000; }
+    
+    // Pin I/O thread i to CPU i modulo the number of CPUs
+    bool pin_threads();
+
+    // Queue a shared buffer for the client; safe to call from any thread
+    SendResult send(const ConnectionPtr& conn, SharedBuffer buffer);
+
+    // Copy bytes into a new buffer and queue it
+    SendResult send(const ConnectionPtr& conn, const void* data, size_t len);
+    
+    // Gathered write from caller-owned buffers: goes straight to the socket
+    // with one sendmsg() on the calling thread when nothing is queued or in
+    // flight ahead of it, and only the part the kernel did not take is copied
+    // into the queue. The buffers are no longer referenced once this returns.
+    SendResult send_gather(const ConnectionPtr& conn, const struct iovec* iov, int count);
+
+    // Stop watching the socket and report it through the close handler
+    void close_connection(const ConnectionPtr& conn);
+
+    // Stop all I/O threads and drop every connection without callbacks
+    void shutdown();
+
+    int get_connection_count() const;
+    uint64_t get_dropped_count() const { return dropped_count.load(); }
+    int get_thread_count() const { return static_cast<int>(io_threads.size()); }
+};
+
+#endif
@@ -0,0 +1,259 @@
+#include "reactor_uring.h"
+#include "metrics.h"
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+namespace {
+constexpr unsigned URING_MAX_COMPLETIONS = 256;
+
+// user_data: a Connection pointer (8-byte aligned) or null, plus the request kind
+enum UringTag : uint64_t {
+    TAG_WAKE = 1,
+    TAG_TIMER = 2,
+    TAG_FLUSH_TIMER = 3,
+    TAG_ACCEPT = 4,
+    TAG_RECV = 5,
+    TAG_SEND = 6
+};
+constexpr uint64_t TAG_MASK = 7;
+
+uint64_t tag(const Connection* conn, UringTag kind) {
+    return reinterpret_cast<uint64_t>(conn) | kind;
+}
+
+void drain_fd(int fd) {
+    uint64_t value;
+    ssize_t ignored = read(fd, &value, sizeof(value));
+    (void)ignored;
+}
+}
+
+void Reactor::uring_loop(IoThread& io) {
+    UringEngine& engine = *io.uring;
+    engine.ring.poll_multishot(io.wake_fd, TAG_WAKE);
+    engine.ring.poll_multishot(io.timer_fd, TAG_TIMER);
+    engine.ring.poll_multishot(io.flush_timer_fd, TAG_FLUSH_TIMER);
+
+    UringCompletion completions[URING_MAX_COMPLETIONS];
+    while (!stop.load()) {
+        int listen_fd = io.listen_fd.load();
+        if (listen_fd >= 0 && !engine.accept_armed) {
+            engine.accept_armed = engine.ring.accept_multishot(listen_fd, TAG_ACCEPT);
+        }
+
+        // One enter submits everything prepared since the last one
+        if (engine.ring.submit_and_wait(1) < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            std::cerr << "[Reactor] io_uring_enter failed: " << strerror(errno) << std::endl;
+            break;
+        }
+
+        unsigned count;
+        while ((count = engine.ring.reap(completions, URING_MAX_COMPLETIONS)) > 0) {
+            for (unsigned i = 0; i < count && !stop.load(); ++i) {
+                uring_complete(io, completions[i]);
+            }
+        }
+    }
+}
+
+void Reactor::uring_watch(IoThread& io, const ConnectionPtr& conn) {
+    UringEngine& engine = *io.uring;
+    if (conn->closed.load() || engine.watched.count(conn.get()) > 0) {
+        return;
+    }
+
+    UringEngine::Watched& entry = engine.watched[conn.get()];
+    entry.conn = conn;
+    entry.fixed = conn->socket_fd >= 0 &&
+                  engine.ring.update_file(static_cast<unsigned>(conn->socket_fd), conn->socket_fd);
+    if (!engine.ring.recv_multishot(conn->socket_fd, entry.fixed, tag(conn.get(), TAG_RECV))) {
+        std::cerr << "[Reactor] io_uring submission queue full, dropping fd " << conn->socket_fd << std::endl;
+        if (entry.fixed) {
+            engine.ring.update_file(static_cast<unsigned>(conn->socket_fd), -1);
+        }
+        engine.watched.erase(conn.get());
+        close_connection(conn);
+        return;
+    }
+    entry.in_flight++;
+
+    if (!conn->timers_armed) {
+        arm_connection_timers(io, conn);
+    }
+
+    // Output may have been queued before the thread picked the socket up
+    uring_flush(io, conn);
+}
+
+void Reactor::uring_flush(IoThread& io, const ConnectionPtr& conn) {
+    UringEngine& engine = *io.uring;
+    auto it = engine.watched.find(conn.get());
+    if (it == engine.watched.end()) {
+        uring_watch(io, conn);
+        return;
+    }
+    UringEngine::Watched& entry = it->second;
+    if (entry.sending || conn->closed.load()) {
+        return;
+    }
+
+    // Buffers stay in the queue, and so stay alive, until the send completes
+    int count = 0;
+    bool more = false;
+    {
+        std::lock_guard<std::mutex> lock(conn->outbound_mutex);
+        size_t skip = conn->outbound_offset;
+        auto buffer = conn->outbound.begin();
+        for (; buffer != conn->outbound.end() && count < URING_SEND_MAX_IOV; ++buffer) {
+            entry.iov[count].iov_base = const_cast<char*>((*buffer)->data()) + skip;
+            entry.iov[count].iov_len = (*buffer)->size() - skip;
+            skip = 0;
+            ++count;
+        }
+        more = buffer != conn->outbound.end();
+        // Keeps send_gather() from writing past us until the send completes
+        conn->send_in_flight = count > 0;
+    }
+    if (count == 0) {
+        return;
+    }
+
+    memset(&entry.msg, 0, sizeof(entry.msg));
+    entry.msg.msg_iov = entry.iov;
+    entry.msg.msg_iovlen = static_cast<size_t>(count);
+    int flags = MSG_NOSIGNAL | (more ? MSG_MORE : 0);
+    if (!engine.ring.sendmsg(conn->socket_fd, entry.fixed, &entry.msg, flags, entry.blocked,
+                             tag(conn.get(), TAG_SEND))) {
+        // Try again on the next flush rather than block the thread
+        {
+            std::lock_guard<std::mutex> lock(conn->outbound_mutex);
+            conn->send_in_flight = false;
+        }
+        schedule_flush(conn);
+        return;
+    }
+    entry.sending = true;
+    entry.blocked = false;
+    entry.in_flight++;
+    MetricsRegistry::instance().add(Counter::SEND_CALLS);
+
+    // The kernel waits for socket space itself; still bound how long
+    arm_write_timer(io, conn);
+}
+
+void Reactor::uring_complete(IoThread& io, const UringCompletion& completion) {
+    UringEngine& engine = *io.uring;
+    auto kind = static_cast<UringTag>(completion.user_data & TAG_MASK);
+
+    switch (kind) {
+        case TAG_WAKE:
+        case TAG_TIMER:
+        case TAG_FLUSH_TIMER: {
+            int fd = kind == TAG_WAKE ? io.wake_fd : kind == TAG_TIMER ? io.timer_fd : io.flush_timer_fd;
+            if (kind == TAG_TIMER) {
+                run_timers(io);  // reads the timerfd itself
+            } else {
+                drain_fd(fd);
+                run_flush_queue(io);
+            }
+            if (!completion.more() && !stop.load()) {
+                engine.ring.poll_multishot(fd, kind);
+            }
+            return;
+        }
+
+        case TAG_ACCEPT: {
+            if (completion.res >= 0) {
+                int fd = completion.res;
+                struct sockaddr_in addr;
+                socklen_t addr_len = sizeof(addr);
+                memset(&addr, 0, sizeof(addr));
+                getpeername(fd, (struct sockaddr*)&addr, &addr_len);
+                if (on_accept(fd, addr)) {
+                    register_connection(io, fd);
+                } else {
+                    close(fd);
+                }
+            } else if (completion.res != -EINVAL && completion.res != -ECANCELED) {
+                std::cerr << "[Reactor] io_uring accept failed: " << strerror(-completion.res) << std::endl;
+            }
+            // Re-armed by the loop while the listener is still open
+            if (!completion.more()) {
+                engine.accept_armed = false;
+            }
+            return;
+        }
+
+        case TAG_RECV:
+        case TAG_SEND:
+            break;
+    }
+
+    auto* raw = reinterpret_cast<Connection*>(completion.user_data & ~TAG_MASK);
+    auto it = engine.watched.find(raw);
+    if (it == engine.watched.end()) {
+        return;
+    }
+    UringEngine::Watched& entry = it->second;
+    ConnectionPtr conn = entry.conn;  // on_data may close it
+
+    if (kind == TAG_RECV) {
+        if (completion.has_buffer()) {
+            uint16_t id = completion.buffer_id();
+            if (completion.res > 0 && !conn->closed.load()) {
+                conn->last_read_ns = monotonic_ns();
+                conn->read_buffer.append(engine.ring.buffer_data(id), static_cast<size_t>(completion.res));
+            }
+            engine.ring.recycle_buffer(id);
+            if (completion.res > 0 && !conn->closed.load()) {
+                on_data(conn);
+            }
+        }
+
+        // Out of provided buffers merely ends the multishot; anything else is the end
+        bool finished = completion.res == 0 || (completion.res < 0 && completion.res != -ENOBUFS);
+        if (finished) {
+            close_connection(conn);
+        }
+        if (!completion.more()) {
+            entry.in_flight--;
+            if (!conn->closed.load()) {
+                if (engine.ring.recv_multishot(conn->socket_fd, entry.fixed, tag(raw, TAG_RECV))) {
+                    entry.in_flight++;
+                } else {
+                    close_connection(conn);
+                }
+            }
+        }
+    } else {
+        entry.sending = false;
+        entry.in_flight--;
+        {
+            std::lock_guard<std::mutex> lock(conn->outbound_mutex);
+            conn->send_in_flight = false;
+            if (completion.res >= 0) {
+                consume_outbound(*conn, static_cast<size_t>(completion.res));
+            }
+        }
+        if (completion.res == -EAGAIN) {
+            entry.blocked = true;
+        } else if (completion.res < 0 && completion.res != -EINTR) {
+            close_connection(conn);
+        }
+        // Anything queued meanwhile, or the unsent rest, goes out next
+        if (!conn->closed.load()) {
+            uring_flush(io, conn);
+        }
+    }
+
+    // Nothing refers to the connection any more; let it (and its fd) go
+    if (entry.in_flight == 0 && conn->closed.load()) {
+        if (entry.fixed) {
+            engine.ring.update_file(static_cast<unsigned>(conn->socket_fd), -1);
+        }
+        engine.watched.erase(raw);
+    }
+}
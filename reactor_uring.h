@@ -0,0 +1,42 @@
+#ifndef REACTOR_URING_H
+#define REACTOR_URING_H
+
+// Private to the reactor: per-thread io_uring state, only built with USE_IO_URING
+
+#include "reactor.h"
+#include "uring.h"
+#include <unordered_map>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+constexpr unsigned URING_QUEUE_DEPTH = 1024;
+constexpr unsigned URING_RECV_BUFFERS = 256;        // provided buffers per thread
+constexpr size_t URING_RECV_BUFFER_SIZE = 16384;
+constexpr int URING_SEND_MAX_IOV = 64;
+
+struct Reactor::UringEngine {
+    // Socket state while the ring knows about it; the entry keeps the
+    // connection, and with it the fd and the queued buffers, alive until the
+    // last request referring to it has completed
+    struct Watched {
+        ConnectionPtr conn;
+        int in_flight;       // requests that will still produce a final completion
+        bool fixed;          // socket_fd is also its index in the registered file table
+        bool sending;
+        bool blocked;        // last send hit EAGAIN (non-blocking socket); poll before retrying
+        struct msghdr msg;   // read by the kernel while the send is in flight
+        struct iovec iov[URING_SEND_MAX_IOV];
+
+        Watched() : in_flight(0), fixed(false), sending(false), blocked(false), msg(), iov() {}
+    };
+
+    std::unordered_map<Connection*, Watched> watched;
+    bool accept_armed;
+    IoUring ring;  // last, so it is torn down (cancelling requests) before the buffers it uses
+
+    UringEngine()
+        : accept_armed(false),
+          ring(URING_QUEUE_DEPTH, CLIENT_REGISTRY_MAX_FDS, URING_RECV_BUFFERS, URING_RECV_BUFFER_SIZE) {}
+};
+
+#endif
@@ -0,0 +1,187 @@
+#include "resource_sampler.h"
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#ifdef __linux__
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+namespace {
+#ifdef __linux__
+uint64_t timeval_us(const struct timeval& tv) {
+    return static_cast<uint64_t>(tv.tv_sec) * 1000000 + static_cast<uint64_t>(tv.tv_usec);
+}
+
+// Fields of /proc/<pid>/task/<tid>/stat after the parenthesised name
+bool read_thread_stat(const std::string& dir, ThreadUsage& usage) {
+    std::ifstream stat_file(dir + "/stat");
+    std::string line;
+    if (!std::getline(stat_file, line)) {
+        return false;
+    }
+
+    // The name may itself contain spaces or parentheses; it ends at the last ')'
+    size_t open = line.find('(');
+    size_t close = line.rfind(')');
+    if (open == std::string::npos || close == std::string::npos || close < open) {
+        return false;
+    }
+    usage.name = line.substr(open + 1, close - open - 1);
+
+    // state ppid pgrp session tty_nr tpgid flags minflt cminflt majflt cmajflt utime stime
+    std::istringstream fields(line.substr(close + 2));
+    std::string skip;
+    uint64_t minflt, cminflt, majflt, cmajflt, utime, stime;
+    for (int i = 0; i < 7; ++i) {
+        fields >> skip;
+    }
+    if (!(fields >> minflt >> cminflt >> majflt >> cmajflt >> utime >> stime)) {
+        return false;
+    }
+
+    static const uint64_t ticks_per_second = static_cast<uint64_t>(sysconf(_SC_CLK_TCK));
+    usage.minor_faults = minflt;
+    usage.major_faults = majflt;
+    usage.user_cpu_us = utime * 1000000 / ticks_per_second;
+    usage.system_cpu_us = stime * 1000000 / ticks_per_second;
+    return true;
+}
+
+// schedstat's first field is time on CPU in ns, far finer than stat's clock ticks
+void read_thread_cpu_time(const std::string& dir, ThreadUsage& usage) {
+    std::ifstream schedstat_file(dir + "/schedstat");
+    uint64_t runtime_ns = 0;
+    if (schedstat_file >> runtime_ns) {
+        usage.cpu_time_ns = runtime_ns;
+    } else {
+        usage.cpu_time_ns = (usage.user_cpu_us + usage.system_cpu_us) * 1000;
+    }
+}
+
+void read_thread_switches(const std::string& dir, ThreadUsage& usage) {
+    std::ifstream status_file(dir + "/status");
+    std::string line;
+    while (std::getline(status_file, line)) {
+        if (line.compare(0, 24, "voluntary_ctxt_switches:") == 0) {
+            usage.voluntary_switches = std::strtoull(line.c_str() + 24, nullptr, 10);
+        } else if (line.compare(0, 27, "nonvoluntary_ctxt_switches:") == 0) {
+            usage.involuntary_switches = std::strtoull(line.c_str() + 27, nullptr, 10);
+        }
+    }
+}
+#endif
+}
+
+ResourceSampler::ResourceSampler(int interval) : interval_ms(interval), running(false) {
+    if (interval <= 0) {
+        throw std::invalid_argument("Sample interval must be positive");
+    }
+}
+
+ResourceSampler::~ResourceSampler() {
+    stop();
+}
+
+void ResourceSampler::start() {
+    if (running.exchange(true)) {
+        return;
+    }
+    sample_now();
+    sampler = std::thread(&ResourceSampler::sampler_loop, this);
+#ifdef __linux__
+    pthread_setname_np(sampler.native_handle(), "sampler");
+#endif
+}
+
+void ResourceSampler::stop() {
+    if (running.exchange(false)) {
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex);
+        }
+        wake_cv.notify_one();
+    }
+    if (sampler.joinable()) {
+        sampler.join();
+    }
+}
+
+void ResourceSampler::sampler_loop() {
+    std::unique_lock<std::mutex> lock(wake_mutex);
+    while (running.load()) {
+        wake_cv.wait_for(lock, std::chrono::milliseconds(interval_ms), [this] {
+            return !running.load();
+        });
+        if (!running.load()) {
+            break;
+        }
+        lock.unlock();
+        sample_now();
+        lock.lock();
+    }
+}
+
+void ResourceSampler::sample_now() {
+    ResourceUsage usage = read_usage();
+    std::lock_guard<std::mutex> lock(sample_mutex);
+    latest = std::move(usage);
+}
+
+ResourceUsage ResourceSampler::get_latest() const {
+    std::lock_guard<std::mutex> lock(sample_mutex);
+    return latest;
+}
+
+ResourceUsage ResourceSampler::read_usage() {
+    ResourceUsage usage;
+#ifdef __linux__
+    struct rusage self;
+    if (getrusage(RUSAGE_SELF, &self) == 0) {
+        usage.minor_faults = static_cast<uint64_t>(self.ru_minflt);
+        usage.major_faults = static_cast<uint64_t>(self.ru_majflt);
+        usage.voluntary_switches = static_cast<uint64_t>(self.ru_nvcsw);
+        usage.involuntary_switches = static_cast<uint64_t>(self.ru_nivcsw);
+        usage.user_cpu_us = timeval_us(self.ru_utime);
+        usage.system_cpu_us = timeval_us(self.ru_stime);
+        usage.peak_rss_bytes = static_cast<uint64_t>(self.ru_maxrss) * 1024;  // reported in KB
+    }
+
+    // statm: size resident shared ... in pages
+    std::ifstream statm_file("/proc/self/statm");
+    uint64_t size_pages = 0, resident_pages = 0;
+    if (statm_file >> size_pages >> resident_pages) {
+        usage.rss_bytes = resident_pages * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    }
+    // ru_maxrss is only updated at certain points, so it can trail the current RSS
+    if (usage.rss_bytes > usage.peak_rss_bytes) {
+        usage.peak_rss_bytes = usage.rss_bytes;
+    }
+
+    // getrusage(RUSAGE_THREAD) only reports the calling thread, so the other
+    // threads' counters come from procfs, which exposes the same fields
+    DIR* tasks = opendir("/proc/self/task");
+    if (tasks) {
+        while (struct dirent* entry = readdir(tasks)) {
+            if (entry->d_name[0] < '0' || entry->d_name[0] > '9') {
+                continue;
+            }
+            std::string dir = std::string("/proc/self/task/") + entry->d_name;
+            ThreadUsage thread;
+            thread.tid = static_cast<pid_t>(std::atoi(entry->d_name));
+            if (!read_thread_stat(dir, thread)) {
+                continue;  // exited between readdir and open
+            }
+            read_thread_cpu_time(dir, thread);
+            read_thread_switches(dir, thread);
+            usage.threads.push_back(std::move(thread));
+        }
+        closedir(tasks);
+    }
+    usage.sampled_at = time(nullptr);
+#endif
+    return usage;
+}
@@ -0,0 +1,85 @@
+#ifndef RESOURCE_SAMPLER_H
+#define RESOURCE_SAMPLER_H
+
+#include "common.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+#include <thread>
+#include <vector>
+
+// Fault, context-switch and CPU counters for one thread of this process
+struct ThreadUsage {
+    pid_t tid;
+    std::string name;  // as set with pthread_setname_np
+    uint64_t minor_faults;
+    uint64_t major_faults;
+    uint64_t voluntary_switches;
+    uint64_t involuntary_switches;
+    uint64_t user_cpu_us;
+    uint64_t system_cpu_us;
+    uint64_t cpu_time_ns;  // from schedstat when available; tick-granular otherwise
+
+    ThreadUsage() : tid(0), minor_faults(0), major_faults(0), voluntary_switches(0),
+                    involuntary_switches(0), user_cpu_us(0), system_cpu_us(0), cpu_time_ns(0) {}
+};
+
+struct ResourceUsage {
+    uint64_t minor_faults;
+    uint64_t major_faults;
+    uint64_t voluntary_switches;
+    uint64_t involuntary_switches;
+    uint64_t user_cpu_us;
+    uint64_t system_cpu_us;
+    uint64_t rss_bytes;
+    uint64_t peak_rss_bytes;
+    time_t sampled_at;  // 0 until the first sample
+    std::vector<ThreadUsage> threads;
+
+    ResourceUsage() : minor_faults(0), major_faults(0), voluntary_switches(0),
+                      involuntary_switches(0), user_cpu_us(0), system_cpu_us(0),
+                      rss_bytes(0), peak_rss_bytes(0), sampled_at(0) {}
+};
+
+/**
+ * Background sampler for process and per-thread resource usage
+ * Every interval it reads getrusage(RUSAGE_SELF), the resident set from
+ * /proc/self/statm and each thread's counters from /proc/self/task/<tid>,
+ * so the hot path never pays for the syscalls. Readers get a copy of the
+ * latest sample.
+ */
+class ResourceSampler {
+private:
+    int interval_ms;
+    std::thread sampler;
+    std::atomic<bool> running;
+    std::mutex wake_mutex;
+    std::condition_variable wake_cv;
+
+    mutable std::mutex sample_mutex;  // guards latest; held only to copy
+    ResourceUsage latest;
+
+    void sampler_loop();
+
+public:
+    explicit ResourceSampler(int interval = RESOURCE_SAMPLE_INTERVAL_MS);
+    ~ResourceSampler();
+
+    // Delete copy constructor and assignment operator
+    ResourceSampler(const ResourceSampler&) = delete;
+    ResourceSampler& operator=(const ResourceSampler&) = delete;
+
+    void start();
+    void stop();
+
+    // Take a fresh sample now, independent of the background thread
+    void sample_now();
+    ResourceUsage get_latest() const;
+
+    // Read the current process and thread counters; empty on non-Linux systems
+    static ResourceUsage read_usage();
+};
+
+#endif
@@ -0,0 +1,166 @@
+#include "room.h"
+#include <algorithm>
+#include <stdexcept>
+
+Room::Room(std::string room_name, uint32_t room_id)
+    : name(std::move(room_name)), id(room_id),
+      cache(ROOM_CACHE_SIZE, ROOM_CACHE_SHARD_COUNT, ROOM_CACHE_ADMISSION, ROOM_CACHE_BYTE_BUDGET, ROOM_CACHE_TTL_S),
+      members(std::make_shared<const ClientRegistry::Snapshot>()) {}
+
+void Room::subscribe(const ClientRegistry::ConnectionPtr& conn) {
+    std::lock_guard<std::mutex> lock(members_mutex);
+
+    ClientRegistry::SnapshotPtr old = std::atomic_load(&members);
+    auto next = std::make_shared<ClientRegistry::Snapshot>();
+    next->members.reserve(old->members.size() + 1);
+    next->members = old->members;
+    next->members.push_back(conn);
+    next->version = old->version + 1;
+    std::atomic_store(&members, ClientRegistry::SnapshotPtr(std::move(next)));
+}
+
+void Room::unsubscribe(const ClientRegistry::ConnectionPtr& conn) {
+    std::lock_guard<std::mutex> lock(members_mutex);
+
+    ClientRegistry::SnapshotPtr old = std::atomic_load(&members);
+    auto it = std::find(old->members.begin(), old->members.end(), conn);
+    if (it == old->members.end()) {
+        return;
+    }
+
+    // Order does not matter for fan-out; fill the hole with the last member
+    auto next = std::make_shared<ClientRegistry::Snapshot>();
+    next->members = old->members;
+    next->version = old->version + 1;
+    size_t index = static_cast<size_t>(it - old->members.begin());
+    next->members[index] = std::move(next->members.back());
+    next->members.pop_back();
+    std::atomic_store(&members, ClientRegistry::SnapshotPtr(std::move(next)));
+}
+
+ClientRegistry::SnapshotPtr Room::subscribers() const {
+    return std::atomic_load(&members);
+}
+
+RoomTable::RoomTable(size_t max) : max_rooms(max) {
+    if (max_rooms == 0) {
+        throw std::invalid_argument("Room table needs room for the default room");
+    }
+    default_room = std::make_shared<Room>(DEFAULT_ROOM, 0);
+    rooms.emplace(default_room->name, default_room);
+}
+
+bool RoomTable::is_valid_name(std::string_view name) {
+    if (name.empty() || name.size() > ROOM_NAME_MAX_LEN) {
+        return false;
+    }
+    return std::all_of(name.begin(), name.end(), [](char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+               c == '_' || c == '-';
+    });
+}
+
+std::shared_ptr<Room> RoomTable::find_or_create(std::string_view name) {
+    if (!is_valid_name(name)) {
+        return nullptr;
+    }
+
+    {
+        std::shared_lock<std::shared_mutex> lock(table_mutex);
+        auto it = rooms.find(name);
+        if (it != rooms.end()) {
+            return it->second;
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lock(table_mutex);
+    // Another thread may have created it while the lock was released
+    auto it = rooms.find(name);
+    if (it != rooms.end()) {
+        return it->second;
+    }
+    if (rooms.size() >= max_rooms) {
+        return nullptr;
+    }
+    auto room = std::make_shared<Room>(std::string(name), static_cast<uint32_t>(rooms.size()));
+    rooms.emplace(room->name, room);
+    return room;
+}
+
+size_t RoomTable::size() const {
+    std::shared_lock<std::shared_mutex> lock(table_mutex);
+    return rooms.size();
+}
+
+uint64_t RoomTable::get_cache_hits() const {
+    std::shared_lock<std::shared_mutex> lock(table_mutex);
+    uint64_t total = 0;
+    for (const auto& [name, room] : rooms) {
+        total += room->cache.get_hits();
+    }
+    return total;
+}
+
+uint64_t RoomTable::get_cache_misses() const {
+    std::shared_lock<std::shared_mutex> lock(table_mutex);
+    uint64_t total = 0;
+    for (const auto& [name, room] : rooms) {
+        total += room->cache.get_misses();
+    }
+    return total;
+}
+
+int RoomTable::get_cache_size() const {
+    std::shared_lock<std::shared_mutex> lock(table_mutex);
+    int total = 0;
+    for (const auto& [name, room] : rooms) {
+        total += room->cache.get_size();
+    }
+    return total;
+}
+
+uint64_t RoomTable::get_cache_rejections() const {
+    std::shared_lock<std::shared_mutex> lock(table_mutex);
+    uint64_t total = 0;
+    for (const auto& [name, room] : rooms) {
+        total += room->cache.get_rejections();
+    }
+    return total;
+}
+
+uint64_t RoomTable::get_cache_expirations() const {
+    std::shared_lock<std::shared_mutex> lock(table_mutex);
+    uint64_t total = 0;
+    for (const auto& [name, room] : rooms) {
+        total += room->cache.get_expirations();
+    }
+    return total;
+}
+
+size_t RoomTable::get_cache_stored_bytes() const {
+    std::shared_lock<std::shared_mutex> lock(table_mutex);
+    size_t total = 0;
+    for (const auto& [name, room] : rooms) {
+        total += room->cache.get_stored_bytes();
+    }
+    return total;
+}
+
+size_t RoomTable::sweep_expired_caches(size_t max_slots_per_shard) {
+    // One shard lock at a time, each held only for its own bounded sweep
+    std::shared_lock<std::shared_mutex> lock(table_mutex);
+    size_t dropped = 0;
+    for (const auto& [name, room] : rooms) {
+        dropped += room->cache.sweep_expired(max_slots_per_shard);
+    }
+    return dropped;
+}
+
+int RoomTable::get_cache_capacity() const {
+    std::shared_lock<std::shared_mutex> lock(table_mutex);
+    int total = 0;
+    for (const auto& [name, room] : rooms) {
+        total += room->cache.get_capacity();
+    }
+    return total;
+}
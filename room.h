@@ -0,0 +1,88 @@
+#ifndef ROOM_H
+#define ROOM_H
+
+#include "common.h"
+#include "cache.h"
+#include "client_registry.h"
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/**
+ * A chat room: the clients subscribed to it and its own message cache
+ * Subscribers are kept as a copy-on-write vector, like the client registry
+ * snapshot, so a fan-out walks only this room's members without a lock.
+ * The cache is lock-striped, so a busy room (the lobby takes every client
+ * that never joins another) does not serialize on one cache lock.
+ */
+struct Room {
+    const std::string name;
+    const uint32_t id;  // 0 is the default room
+    ShardedMessageCache cache;
+
+private:
+    std::mutex members_mutex;
+    ClientRegistry::SnapshotPtr members;  // accessed with std::atomic_load/atomic_store
+
+public:
+    Room(std::string room_name, uint32_t room_id);
+
+    // Delete copy constructor and assignment operator
+    Room(const Room&) = delete;
+    Room& operator=(const Room&) = delete;
+
+    void subscribe(const ClientRegistry::ConnectionPtr& conn);
+    void unsubscribe(const ClientRegistry::ConnectionPtr& conn);
+
+    // Current subscribers; never blocks and stays valid while held
+    ClientRegistry::SnapshotPtr subscribers() const;
+
+    size_t subscriber_count() const { return subscribers()->members.size(); }
+};
+
+/**
+ * Process-wide set of rooms, created on first join and kept for the life of
+ * the server. Lookups of existing rooms take a shared lock.
+ */
+class RoomTable {
+private:
+    std::unordered_map<std::string_view, std::shared_ptr<Room>> rooms;  // keys view Room::name
+    std::shared_ptr<Room> default_room;
+    size_t max_rooms;
+    mutable std::shared_mutex table_mutex;
+
+public:
+    explicit RoomTable(size_t max_rooms = MAX_ROOMS);
+
+    // Delete copy constructor and assignment operator
+    RoomTable(const RoomTable&) = delete;
+    RoomTable& operator=(const RoomTable&) = delete;
+
+    // Names are 1..ROOM_NAME_MAX_LEN characters of [A-Za-z0-9_-]
+    static bool is_valid_name(std::string_view name);
+
+    // nullptr for an invalid name or when the table is full
+    std::shared_ptr<Room> find_or_create(std::string_view name);
+
+    Room& get_default() const { return *default_room; }
+    std::shared_ptr<Room> get_default_ptr() const { return default_room; }
+
+    size_t size() const;
+
+    // Cache statistics summed over every room's partition and its shards
+    uint64_t get_cache_hits() const;
+    uint64_t get_cache_misses() const;
+    int get_cache_size() const;
+    int get_cache_capacity() const;
+    uint64_t get_cache_rejections() const;  // TinyLFU admission or over the byte budget
+    uint64_t get_cache_expirations() const;
+    size_t get_cache_stored_bytes() const;
+
+    // One incremental expiry pass over every room's partition
+    size_t sweep_expired_caches(size_t max_slots_per_shard = CACHE_SWEEP_BATCH);
+};
+
+#endif
@@ -1,67 +1,126 @@
 #include "scheduler.h"
 #include <iostream>
 
-RoundRobinScheduler::RoundRobinScheduler(int quantum_ms) 
-    : head(nullptr), current(nullptr), client_count(0), time_quantum_ms(quantum_ms) {
+RoundRobinScheduler::RoundRobinScheduler(int quantum_ms, size_t quantum) 
+    : active_head(nullptr), active_tail(nullptr), queued_count(0), quantum_bytes(quantum),
+      head(nullptr), current(nullptr), client_count(0), time_quantum_ms(quantum_ms),
+      free_nodes(nullptr) {
     if (quantum_ms <= 0) {
         throw std::invalid_argument("Time quantum must be positive");
     }
-    std::cout << "[Scheduler] Initialized with " << time_quantum_ms << "ms time quantum" << std::endl;
+    if (quantum == 0) {
+        throw std::invalid_argument("Byte quantum must be positive");
+    }
+    index.reserve(MAX_CLIENTS);
+    std::cout << "[Scheduler] Initialized with " << time_quantum_ms << "ms time quantum, "
+              << quantum_bytes << "-byte DRR quantum" << std::endl;
 }
 
 RoundRobinScheduler::~RoundRobinScheduler() {
     std::lock_guard<std::mutex> lock(scheduler_mutex);
     
-    if (!head) return;
-    
-    ScheduledClient* temp = head;
-    ScheduledClient* next_client;
-    
-    do {
-        next_client = temp->next;
-        delete temp;
-        temp = next_client;
-    } while (temp != head);
-    
+    // Nodes live in node_blocks, which release them all at once
+    index.clear();
     head = nullptr;
     current = nullptr;
+    active_head = nullptr;
+    active_tail = nullptr;
+    free_nodes = nullptr;
     client_count = 0;
 }
 
-void RoundRobinScheduler::add_client(int socket_fd, const std::string& user_id) {
+ScheduledClient* RoundRobinScheduler::allocate_node() {
+    if (!free_nodes) {
+        node_blocks.emplace_back(new ScheduledClient[NODE_BLOCK_SIZE]);
+        ScheduledClient* block = node_blocks.back().get();
+        for (size_t i = 0; i < NODE_BLOCK_SIZE; ++i) {
+            block[i].next = free_nodes;
+            free_nodes = &block[i];
+        }
+    }
+    
+    ScheduledClient* node = free_nodes;
+    free_nodes = node->next;
+    return node;
+}
+
+void RoundRobinScheduler::release_node(ScheduledClient* node) {
+    // Keep the string's buffer for the next client that reuses this node
+    node->socket_fd = -1;
+    node->user_id.clear();
+    node->context.reset();
+    node->state = ScheduleState::IDLE;
+    node->rearm = false;
+    node->deficit = 0;
+    node->active_next = nullptr;
+    node->active_prev = nullptr;
+    node->prev = nullptr;
+    node->next = free_nodes;
+    free_nodes = node;
+}
+
+void RoundRobinScheduler::push_active(ScheduledClient* node) {
+    node->state = ScheduleState::QUEUED;
+    node->active_next = nullptr;
+    node->active_prev = active_tail;
+    if (active_tail) {
+        active_tail->active_next = node;
+    } else {
+        active_head = node;
+    }
+    active_tail = node;
+    queued_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+void RoundRobinScheduler::unlink_active(ScheduledClient* node) {
+    if (node->active_prev) {
+        node->active_prev->active_next = node->active_next;
+    } else {
+        active_head = node->active_next;
+    }
+    if (node->active_next) {
+        node->active_next->active_prev = node->active_prev;
+    } else {
+        active_tail = node->active_prev;
+    }
+    node->active_next = nullptr;
+    node->active_prev = nullptr;
+    queued_count.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void RoundRobinScheduler::add_client(int socket_fd, const std::string& user_id, int weight,
+                                     std::shared_ptr<void> context) {
     std::lock_guard<std::mutex> lock(scheduler_mutex);
     
     // Check if client already exists
-    if (head) {
-        ScheduledClient* temp = head;
-        do {
-            if (temp->socket_fd == socket_fd) {
-                std::cerr << "[Scheduler] Client " << socket_fd << " already exists" << std::endl;
-                return;
-            }
-            temp = temp->next;
-        } while (temp != head);
+    if (index.find(socket_fd) != index.end()) {
+        std::cerr << "[Scheduler] Client " << socket_fd << " already exists" << std::endl;
+        return;
     }
     
-    ScheduledClient* new_client = new ScheduledClient(socket_fd, user_id);
+    ScheduledClient* new_client = allocate_node();
+    new_client->socket_fd = socket_fd;
+    new_client->user_id = user_id;
+    new_client->last_scheduled = 0;
+    new_client->weight = weight > 0 ? weight : 1;
+    new_client->context = std::move(context);
     
     if (!head) {
         // First client
         head = new_client;
         head->next = head;  // Point to itself
+        head->prev = head;
         current = head;
     } else {
-        // Find the last client
-        ScheduledClient* last = head;
-        while (last->next != head) {
-            last = last->next;
-        }
-        
-        // Insert new client at the end
+        // Insert new client at the end, just before head
+        ScheduledClient* last = head->prev;
         last->next = new_client;
+        new_client->prev = last;
         new_client->next = head;
+        head->prev = new_client;
     }
     
+    index.emplace(socket_fd, new_client);
     client_count++;
     std::cout << "[Scheduler] Added client " << user_id << " (fd: " << socket_fd 
               << "), total clients: " << client_count << std::endl;
@@ -70,64 +129,113 @@ void RoundRobinScheduler::add_client(int socket_fd, const std::string& user_id)
 void RoundRobinScheduler::remove_client(int socket_fd) {
     std::lock_guard<std::mutex> lock(scheduler_mutex);
     
-    if (!head) return;
+    auto it = index.find(socket_fd);
+    if (it == index.end()) {
+        std::cerr << "[Scheduler] Client with fd " << socket_fd << " not found" << std::endl;
+        return;
+    }
+    
+    ScheduledClient* node = it->second;
+    index.erase(it);
     
-    ScheduledClient* temp = head;
-    ScheduledClient* prev = nullptr;
+    // An outstanding turn for a queued client finds the list without it
+    if (node->state == ScheduleState::QUEUED) {
+        unlink_active(node);
+    }
     
-    // Special case: only one client
-    if (head->next == head && head->socket_fd == socket_fd) {
-        std::cout << "[Scheduler] Removing last client " << head->user_id 
+    if (node->next == node) {
+        // Special case: only one client
+        std::cout << "[Scheduler] Removing last client " << node->user_id 
                   << " (fd: " << socket_fd << ")" << std::endl;
-        delete head;
         head = nullptr;
         current = nullptr;
-        client_count = 0;
-        return;
+    } else {
+        node->prev->next = node->next;
+        node->next->prev = node->prev;
+        if (head == node) {
+            head = node->next;
+        }
+        if (current == node) {
+            current = node->next;
+        }
+        std::cout << "[Scheduler] Removed client " << node->user_id 
+                  << " (fd: " << socket_fd << ")" << std::endl;
     }
     
-    // Find the last node (to get prev for head)
-    ScheduledClient* last = head;
-    while (last->next != head) {
-        last = last->next;
+    release_node(node);
+    client_count--;
+}
+
+void RoundRobinScheduler::set_weight(int socket_fd, int weight) {
+    std::lock_guard<std::mutex> lock(scheduler_mutex);
+    
+    ScheduledClient* node = find_client(socket_fd);
+    if (node) {
+        node->weight = weight > 0 ? weight : 1;
     }
+}
+
+bool RoundRobinScheduler::activate(int socket_fd) {
+    std::lock_guard<std::mutex> lock(scheduler_mutex);
     
-    // Case 1: Removing head
-    if (head->socket_fd == socket_fd) {
-        last->next = head->next;
-        ScheduledClient* old_head = head;
-        head = head->next;
-        if (current == old_head) {
-            current = head;
-        }
-        std::cout << "[Scheduler] Removed client " << old_head->user_id 
-                  << " (fd: " << socket_fd << ")" << std::endl;
-        delete old_head;
-        client_count--;
-        return;
+    ScheduledClient* node = find_client(socket_fd);
+    if (!node) {
+        return false;
     }
     
-    // Case 2: Removing non-head client
-    prev = head;
-    temp = head->next;
-    
-    while (temp != head) {
-        if (temp->socket_fd == socket_fd) {
-            prev->next = temp->next;
-            if (current == temp) {
-                current = temp->next;
-            }
-            std::cout << "[Scheduler] Removed client " << temp->user_id 
-                      << " (fd: " << socket_fd << ")" << std::endl;
-            delete temp;
-            client_count--;
-            return;
-        }
-        prev = temp;
-        temp = temp->next;
+    switch (node->state) {
+        case ScheduleState::IDLE:
+            push_active(node);
+            return true;
+        case ScheduleState::RUNNING:
+            // end_turn() will requeue it
+            node->rearm = true;
+            return false;
+        case ScheduleState::QUEUED:
+            break;
     }
+    return false;
+}
+
+bool RoundRobinScheduler::begin_turn(SchedulerTurn& turn) {
+    std::lock_guard<std::mutex> lock(scheduler_mutex);
+    
+    ScheduledClient* node = active_head;
+    if (!node) {
+        return false;
+    }
+    unlink_active(node);
+    
+    node->state = ScheduleState::RUNNING;
+    node->rearm = false;
+    node->last_scheduled = time(nullptr);
     
-    std::cerr << "[Scheduler] Client with fd " << socket_fd << " not found" << std::endl;
+    turn.socket_fd = node->socket_fd;
+    turn.context = node->context;
+    turn.budget = node->deficit + quantum_bytes * static_cast<size_t>(node->weight);
+    return true;
+}
+
+bool RoundRobinScheduler::end_turn(const SchedulerTurn& turn, size_t unused_budget, bool has_more) {
+    std::lock_guard<std::mutex> lock(scheduler_mutex);
+    
+    // Removed during its turn (the client disconnected)
+    ScheduledClient* node = find_client(turn.socket_fd);
+    if (!node || node->state != ScheduleState::RUNNING) {
+        return false;
+    }
+    
+    // The deficit only carries over while the client stays backlogged
+    node->deficit = has_more ? unused_budget : 0;
+    
+    if (has_more || node->rearm) {
+        node->rearm = false;
+        push_active(node);
+        return true;
+    }
+    
+    node->state = ScheduleState::IDLE;
+    return false;
 }
 
 ScheduledClient* RoundRobinScheduler::get_next_client() {
@@ -145,22 +253,12 @@ ScheduledClient* RoundRobinScheduler::get_next_client() {
 }
 
 int RoundRobinScheduler::get_client_count() const {
-    std::lock_guard<std::mutex> lock(scheduler_mutex);
-    return client_count;
+    return client_count.load(std::memory_order_relaxed);
 }
 
 ScheduledClient* RoundRobinScheduler::find_client(int socket_fd) {
-    if (!head) return nullptr;
-    
-    ScheduledClient* temp = head;
-    do {
-        if (temp->socket_fd == socket_fd) {
-            return temp;
-        }
-        temp = temp->next;
-    } while (temp != head);
-    
-    return nullptr;
+    auto it = index.find(socket_fd);
+    return it != index.end() ? it->second : nullptr;
 }
 
 void RoundRobinScheduler::print_schedule() const {
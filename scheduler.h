@@ -5,48 +5,125 @@
 #include <string>
 #include <mutex>
 #include <memory>
+#include <atomic>
+#include <vector>
+#include <unordered_map>
+
+enum class ScheduleState : uint8_t {
+    IDLE,     // no pending work
+    QUEUED,   // waiting in the active list for a turn
+    RUNNING   // a worker is processing its queue
+};
 
 struct ScheduledClient {
     int socket_fd;
     std::string user_id;
     time_t last_scheduled;
     ScheduledClient* next;
+    ScheduledClient* prev;
     
+    // Deficit round robin
+    int weight;                     // quantum multiplier
+    size_t deficit;                 // unspent bytes carried to the next turn
+    ScheduleState state;
+    bool rearm;                     // new work arrived while RUNNING
+    ScheduledClient* active_next;
+    ScheduledClient* active_prev;
+    std::shared_ptr<void> context;  // caller's per-client state, handed back with each turn
+    
+    ScheduledClient()
+        : socket_fd(-1), last_scheduled(0), next(nullptr), prev(nullptr), weight(1), deficit(0),
+          state(ScheduleState::IDLE), rearm(false), active_next(nullptr), active_prev(nullptr) {}
     ScheduledClient(int fd, const std::string& id) 
-        : socket_fd(fd), user_id(id), last_scheduled(0), next(nullptr) {}
+        : socket_fd(fd), user_id(id), last_scheduled(0), next(nullptr), prev(nullptr), weight(1),
+          deficit(0), state(ScheduleState::IDLE), rearm(false), active_next(nullptr),
+          active_prev(nullptr) {}
+};
+
+// One client's turn, returned by begin_turn()
+struct SchedulerTurn {
+    int socket_fd;
+    std::shared_ptr<void> context;
+    size_t budget;  // bytes the client may consume this turn
+    
+    SchedulerTurn() : socket_fd(-1), budget(0) {}
 };
 
 /**
  * Round-robin scheduler for fair client message processing
- * Maintains a circular linked list of clients and schedules them in order
+ * Maintains a circular doubly linked list of clients and schedules them in
+ * order. An fd index makes add and remove O(1); nodes come from a pool that
+ * grows in blocks and recycles freed nodes.
+ *
+ * Clients with pending work are also kept on an active list served by
+ * deficit round robin: each turn grants weight * quantum_bytes of budget,
+ * and a client that still has work afterwards goes to the back of the list,
+ * so a flooding client delays others by at most one quantum.
  */
 class RoundRobinScheduler {
 private:
+    static constexpr size_t NODE_BLOCK_SIZE = 64;
+    
+    ScheduledClient* active_head;
+    ScheduledClient* active_tail;
+    std::atomic<int> queued_count;
+    size_t quantum_bytes;
+    
     ScheduledClient* head;
     ScheduledClient* current;
-    int client_count;
+    std::atomic<int> client_count;  // read without scheduler_mutex by get_client_count()
     mutable std::mutex scheduler_mutex;
     int time_quantum_ms;
     
+    std::unordered_map<int, ScheduledClient*> index;
+    
+    // Node pool: blocks are never freed before the scheduler; free nodes are
+    // chained through next
+    std::vector<std::unique_ptr<ScheduledClient[]>> node_blocks;
+    ScheduledClient* free_nodes;
+    
     // Helper method to find client node
     ScheduledClient* find_client(int socket_fd);
+    ScheduledClient* allocate_node();
+    void release_node(ScheduledClient* node);
+    void push_active(ScheduledClient* node);
+    void unlink_active(ScheduledClient* node);
 
 public:
-    explicit RoundRobinScheduler(int quantum_ms = TIME_QUANTUM_MS);
+    explicit RoundRobinScheduler(int quantum_ms = TIME_QUANTUM_MS,
+                                 size_t quantum_bytes = SCHEDULER_QUANTUM_BYTES);
     ~RoundRobinScheduler();
     
     // Delete copy constructor and assignment operator
     RoundRobinScheduler(const RoundRobinScheduler&) = delete;
     RoundRobinScheduler& operator=(const RoundRobinScheduler&) = delete;
     
-    void add_client(int socket_fd, const std::string& user_id);
+    void add_client(int socket_fd, const std::string& user_id, int weight = 1,
+                    std::shared_ptr<void> context = nullptr);
     void remove_client(int socket_fd);
+    void set_weight(int socket_fd, int weight);
+    
+    // The client has new pending work. Returns true if it was idle and is now
+    // queued; the caller must then arrange for one begin_turn() call.
+    bool activate(int socket_fd);
+    
+    // Take the client at the front of the active list; false if none
+    bool begin_turn(SchedulerTurn& turn);
+    
+    // Finish a turn with unused budget. Returns true if the client was
+    // requeued (has_more, or work arrived meanwhile) and needs another turn.
+    bool end_turn(const SchedulerTurn& turn, size_t unused_budget, bool has_more);
+    
+    // True when some client is waiting for a turn; lock-free
+    bool has_waiting() const { return queued_count.load(std::memory_order_relaxed) > 0; }
+    
     ScheduledClient* get_next_client();
     int get_client_count() const;
     void print_schedule() const;
     
     // Get time quantum
     int get_time_quantum() const { return time_quantum_ms; }
+    size_t get_quantum_bytes() const { return quantum_bytes; }
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,58 @@
+#include "sender_table.h"
+#include <mutex>
+#include <stdexcept>
+
+uint32_t SenderTable::intern(std::string_view name) {
+    {
+        std::shared_lock<std::shared_mutex> lock(table_mutex);
+        auto it = ids.find(name);
+        if (it != ids.end()) {
+            return it->second;
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lock(table_mutex);
+
+    // Another thread may have added it between the two locks
+    auto it = ids.find(name);
+    if (it != ids.end()) {
+        return it->second;
+    }
+
+    if (names.size() >= UINT32_MAX - 1) {
+        throw std::runtime_error("Sender table is full");
+    }
+
+    names.emplace_back(name);
+    uint32_t id = static_cast<uint32_t>(names.size());
+    ids.emplace(std::string_view(names.back()), id);
+    return id;
+}
+
+bool SenderTable::find(std::string_view name, uint32_t& id) const {
+    std::shared_lock<std::shared_mutex> lock(table_mutex);
+    auto it = ids.find(name);
+    if (it == ids.end()) {
+        return false;
+    }
+    id = it->second;
+    return true;
+}
+
+std::string_view SenderTable::name(uint32_t id) const {
+    std::shared_lock<std::shared_mutex> lock(table_mutex);
+    if (id == 0 || id > names.size()) {
+        return std::string_view();
+    }
+    return names[id - 1];
+}
+
+size_t SenderTable::size() const {
+    std::shared_lock<std::shared_mutex> lock(table_mutex);
+    return names.size();
+}
+
+SenderTable& SenderTable::instance() {
+    static SenderTable table;
+    return table;
+}
@@ -0,0 +1,45 @@
+#ifndef SENDER_TABLE_H
+#define SENDER_TABLE_H
+
+#include <string>
+#include <string_view>
+#include <deque>
+#include <unordered_map>
+#include <shared_mutex>
+#include <cstdint>
+
+/**
+ * Process-wide table of interned sender names
+ * Each distinct username is stored once and mapped to a small dense ID
+ * (starting at 1; 0 means "unknown"). Lookups of known names take a shared
+ * lock and never allocate.
+ */
+class SenderTable {
+private:
+    std::deque<std::string> names;  // deque keeps element addresses stable
+    std::unordered_map<std::string_view, uint32_t> ids;
+    mutable std::shared_mutex table_mutex;
+
+public:
+    SenderTable() = default;
+
+    // Delete copy constructor and assignment operator
+    SenderTable(const SenderTable&) = delete;
+    SenderTable& operator=(const SenderTable&) = delete;
+
+    // Return the ID for name, adding it on first use
+    uint32_t intern(std::string_view name);
+
+    // Look up an existing name without adding it
+    bool find(std::string_view name, uint32_t& id) const;
+
+    // Name for an ID; empty view for unknown IDs. The view stays valid for
+    // the lifetime of the table.
+    std::string_view name(uint32_t id) const;
+
+    size_t size() const;
+
+    static SenderTable& instance();
+};
+
+#endif
@@ -1,7 +1,17 @@
 #include "common.h"
 #include "thread_pool.h"
 #include "cache.h"
+#include "client_registry.h"
+#include "room.h"
+#include "history_store.h"
+#include "message_log.h"
 #include "scheduler.h"
+#include "reactor.h"
+#include "sender_table.h"
+#include "logger.h"
+#include "metrics.h"
+#include "resource_sampler.h"
+#include "stats_server.h"
 #include <iostream>
 #include <iomanip>
 #include <cstring>
@@ -10,7 +20,6 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <vector>
-#include <map>
 #include <mutex>
 #include <fstream>
 #include <sstream>
@@ -21,283 +30,651 @@
 #include <atomic>
 
 // Global variables
-std::map<int, ClientInfo> clients;
-std::mutex clients_mutex;
-MessageCache message_cache(CACHE_SIZE);
+ClientRegistry clients;
+RoomTable rooms;  // each room carries its own message cache partition
+HistoryStore history;
+MessageLog message_log(MESSAGE_LOG_DIR);
 RoundRobinScheduler scheduler;
-PerformanceMetrics metrics;
-std::mutex metrics_mutex;
 std::atomic<bool> server_running(true);
-std::ofstream log_file;
+AsyncLogger logger;
+ResourceSampler resource_sampler;
+Reactor* reactor = nullptr;
+ThreadPool* worker_pool = nullptr;
 
 // Function prototypes
-void handle_client(int client_socket);
-void broadcast_message(const Message& msg, int sender_socket);
+void on_client_data(const std::shared_ptr<Connection>& conn);
+void on_client_close(const std::shared_ptr<Connection>& conn);
+void push_inbound(const std::shared_ptr<Connection>& conn, InboundEvent&& event);
+void schedule_turn(bool fair);
+void run_scheduler_turn();
+void register_client(const std::shared_ptr<Connection>& conn, const std::string& user_id);
+void unregister_client(const std::shared_ptr<Connection>& conn);
+void replay_history(const std::shared_ptr<Connection>& conn, const Room& room);
+void warm_from_log();
+void handle_message(const std::shared_ptr<Connection>& conn, Frame& frame, uint64_t received_ns);
+void broadcast_message(Room& room, const Frame& frame, uint32_t sender_id, int sender_socket);
+void join_room(const std::shared_ptr<Connection>& conn, const std::string& name);
 void log_message(const std::string& message);
-void update_metrics();
-void read_page_faults();
+void log_message(LogLevel level, const std::string& message);
+PerformanceMetrics collect_metrics();
+std::string render_prometheus();
+
 void signal_handler(int signum);
 void print_statistics();
-bool setup_server_socket(int& server_socket);
-void cleanup_server(int server_socket);
+bool on_client_accept(int client_socket, const struct sockaddr_in& addr);
+void cleanup_server();
 
 void log_message(const std::string& message) {
-    time_t now = time(nullptr);
-    char timestamp[64];
-    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", localtime(&now));
+    logger.log(LogLevel::LOG_INFO, message);
+}
+
+void log_message(LogLevel level, const std::string& message) {
+    logger.log(level, message);
+}
+
+PerformanceMetrics collect_metrics() {
+    // Every source is an atomic or per-thread counter; nothing here blocks the hot path
+    MetricsRegistry& registry = MetricsRegistry::instance();
+    PerformanceMetrics snapshot;
     
-    std::string log_entry = std::string(timestamp) + " - " + message;
-    std::cout << log_entry << std::endl;
+    snapshot.messages_sent = registry.get(Counter::MESSAGES_SENT);
+    snapshot.messages_received = registry.get(Counter::MESSAGES_RECEIVED);
+    snapshot.send_calls = registry.get(Counter::SEND_CALLS);
+    snapshot.active_clients = static_cast<int>(registry.get(Gauge::ACTIVE_CLIENTS));
+    snapshot.active_threads = worker_pool ? worker_pool->get_active_count() : 0;
+    snapshot.cache_hits = rooms.get_cache_hits();
+    snapshot.cache_misses = rooms.get_cache_misses();
     
-    if (log_file.is_open()) {
-        log_file << log_entry << std::endl;
-        log_file.flush();
+    // Sampled in the background; this is just a copy of the last sample
+    ResourceUsage usage = resource_sampler.get_latest();
+    snapshot.page_faults_minor = usage.minor_faults;
+    snapshot.page_faults_major = usage.major_faults;
+    snapshot.rss_bytes = usage.rss_bytes;
+    snapshot.peak_rss_bytes = usage.peak_rss_bytes;
+    snapshot.voluntary_switches = usage.voluntary_switches;
+    snapshot.involuntary_switches = usage.involuntary_switches;
+    return snapshot;
+}
+
+std::string render_prometheus() {
+    // The room getters hold RoomTable::table_mutex shared, which only room
+    // creation takes exclusively, and sum per-shard atomic counters without
+    // taking a cache shard lock, so a scrape cannot stall chat traffic
+    PerformanceMetrics metrics = collect_metrics();
+    std::ostringstream out;
+    
+    auto metric = [&out](const char* name, const char* type, const char* help, auto value) {
+        out << "# HELP " << name << " " << help << "\n"
+            << "# TYPE " << name << " " << type << "\n"
+            << name << " " << value << "\n";
+    };
+    
+    metric("chat_messages_sent_total", "counter", "Messages queued to recipients", metrics.messages_sent);
+    metric("chat_messages_received_total", "counter", "Messages received from clients", metrics.messages_received);
+    metric("chat_send_calls_total", "counter", "sendmsg() calls on client sockets", metrics.send_calls);
+    metric("chat_active_clients", "gauge", "Registered clients", metrics.active_clients);
+    metric("chat_cache_hits_total", "counter", "Message cache hits", metrics.cache_hits);
+    metric("chat_cache_misses_total", "counter", "Message cache misses", metrics.cache_misses);
+    metric("chat_cache_entries", "gauge", "Entries in the message cache", rooms.get_cache_size());
+    metric("chat_cache_capacity", "gauge", "Message cache capacity", rooms.get_cache_capacity());
+    metric("chat_cache_admission_rejections_total", "counter", "Inserts turned away by admission or the byte budget",
+           rooms.get_cache_rejections());
+    metric("chat_cache_expired_total", "counter", "Cache entries dropped for outliving the TTL",
+           rooms.get_cache_expirations());
+    metric("chat_cache_stored_bytes", "gauge", "Message bytes held by the caches", rooms.get_cache_stored_bytes());
+    metric("chat_rooms", "gauge", "Rooms created so far", rooms.size());
+    metric("chat_threadpool_active_threads", "gauge", "Workers running a task", metrics.active_threads);
+    metric("chat_threadpool_queued_tasks", "gauge", "Tasks waiting for a worker",
+           worker_pool ? worker_pool->get_queue_size() : 0);
+    metric("chat_scheduler_clients", "gauge", "Clients known to the scheduler", scheduler.get_client_count());
+    metric("chat_outbound_dropped_total", "counter", "Clients disconnected by backpressure",
+           reactor ? reactor->get_dropped_count() : 0);
+    metric("chat_resident_memory_bytes", "gauge", "Resident set size", metrics.rss_bytes);
+    metric("chat_resident_memory_peak_bytes", "gauge", "Peak resident set size", metrics.peak_rss_bytes);
+    metric("chat_page_faults_minor_total", "counter", "Minor page faults", metrics.page_faults_minor);
+    metric("chat_page_faults_major_total", "counter", "Major page faults", metrics.page_faults_major);
+    metric("chat_context_switches_voluntary_total", "counter", "Voluntary context switches",
+           metrics.voluntary_switches);
+    metric("chat_context_switches_involuntary_total", "counter", "Involuntary context switches",
+           metrics.involuntary_switches);
+    
+    out << "# HELP chat_latency_seconds Stage latencies from the per-thread histograms\n"
+        << "# TYPE chat_latency_seconds summary\n";
+    for (size_t i = 0; i < static_cast<size_t>(Latency::COUNT); ++i) {
+        Latency latency = static_cast<Latency>(i);
+        LatencyHistogram::Snapshot snap = MetricsRegistry::instance().snapshot(latency);
+        const char* stage = MetricsRegistry::name(latency);
+        for (double quantile : {0.5, 0.99, 0.999}) {
+            out << "chat_latency_seconds{stage=\"" << stage << "\",quantile=\"" << quantile << "\"} "
+                << snap.percentile(quantile * 100.0) / 1e9 << "\n";
+        }
+        out << "chat_latency_seconds_sum{stage=\"" << stage << "\"} " << snap.sum / 1e9 << "\n"
+            << "chat_latency_seconds_count{stage=\"" << stage << "\"} " << snap.total << "\n";
     }
+    return out.str();
 }
 
-void read_page_faults() {
-#ifdef __linux__
-    try {
-        std::ifstream status_file("/proc/self/status");
-        if (!status_file.is_open()) return;
+void broadcast_message(Room& room, const Frame& frame, uint32_t sender_id, int sender_socket) {
+    // Walk the room's current subscriber snapshot; joins and leaves publish a new one
+    ClientRegistry::SnapshotPtr recipients = room.subscribers();
+    
+    // Encoded at most once per protocol; all recipients share the buffer
+    SharedBuffer framed_wire;
+    SharedBuffer legacy_wire;
+    uint64_t sent_count = 0;
+    std::vector<std::string> lost_clients;
+    
+    for (const auto& conn : recipients->members) {
+        if (conn->socket_fd == sender_socket) {
+            continue;
+        }
+        SharedBuffer& wire = conn->framed ? framed_wire : legacy_wire;
+        if (!wire) {
+            wire = std::make_shared<const std::string>(
+                conn->framed ? encode_frame(frame) : encode_legacy_message(frame));
+        }
         
-        std::string line;
-        while (std::getline(status_file, line)) {
-            if (line.find("VmHWM:") == 0 || line.find("VmRSS:") == 0) {
-                std::lock_guard<std::mutex> lock(metrics_mutex);
-                metrics.page_faults_minor++;
-            }
+        switch (reactor->send(conn, wire)) {
+            case SendResult::QUEUED:
+                sent_count++;
+                break;
+            case SendResult::DROPPED:
+                break;
+            case SendResult::CLOSED:
+                // Unregistering happens when the CLOSE event is processed
+                lost_clients.push_back(conn->info.user_id);
+                break;
         }
-    } catch (const std::exception& e) {
-        // Silently ignore errors reading page faults
     }
-#endif
+    
+    if (sent_count > 0) {
+        MetricsRegistry::instance().add(Counter::MESSAGES_SENT, sent_count);
+    }
+    
+    for (const auto& user_id : lost_clients) {
+        log_message("Client connection lost: " + user_id);
+    }
+    
+    // Add message to the room's cache, history and the log; the log names
+    // rooms, since ids are handed out afresh on every start
+    room.cache.insert(sender_id, frame.payload, frame.timestamp);
+    history.append(frame.type, sender_id, frame.timestamp, frame.payload.data(), frame.payload.size(), room.id);
+    message_log.append(frame.type, SenderTable::instance().name(sender_id), frame.timestamp, frame.payload,
+                       room.id == 0 ? std::string_view() : std::string_view(room.name));
 }
 
-void update_metrics() {
-    std::lock_guard<std::mutex> lock(metrics_mutex);
+void push_inbound(const std::shared_ptr<Connection>& conn, InboundEvent&& event) {
+    bool was_empty;
     
     {
-        std::lock_guard<std::mutex> clients_lock(clients_mutex);
-        metrics.active_clients = static_cast<int>(clients.size());
+        std::lock_guard<std::mutex> lock(conn->inbound_mutex);
+        was_empty = conn->inbound.empty();
+        conn->inbound.push_back(std::move(event));
     }
     
-    metrics.cache_hits = message_cache.get_hits();
-    metrics.cache_misses = message_cache.get_misses();
-    
-    read_page_faults();
+    // A non-empty queue already guarantees a turn that will reach this event
+    if (was_empty && scheduler.activate(conn->socket_fd)) {
+        schedule_turn(false);
+    }
 }
 
-void broadcast_message(const Message& msg, int sender_socket) {
-    std::vector<int> failed_sockets;
+void schedule_turn(bool fair) {
+    // Each queued client holds one turn task; the task serves whichever
+    // client is at the front of the scheduler's active list
+    try {
+        if (fair) {
+            worker_pool->enqueue_fair(run_scheduler_turn);
+        } else {
+            worker_pool->enqueue(run_scheduler_turn);
+        }
+    } catch (const std::exception& e) {
+        log_message(LogLevel::LOG_ERROR, "Failed to schedule client work: " + std::string(e.what()));
+    }
+}
+
+size_t inbound_cost(const InboundEvent& event) {
+    return FRAME_HEADER_SIZE + event.frame.sender.size() + event.frame.payload.size();
+}
+
+void run_scheduler_turn() {
+    SchedulerTurn turn;
+    if (!scheduler.begin_turn(turn)) {
+        return;
+    }
     
-    {
-        std::lock_guard<std::mutex> lock(clients_mutex);
+    auto conn = std::static_pointer_cast<Connection>(turn.context);
+    size_t budget = turn.budget;
+    bool has_more = true;
+    
+    while (true) {
+        InboundEvent event(InboundKind::MESSAGE);
         
-        for (auto& [socket_fd, client_info] : clients) {
-            if (socket_fd != sender_socket && client_info.active) {
-                ssize_t sent = send(socket_fd, &msg, sizeof(Message), MSG_NOSIGNAL);
-                if (sent > 0) {
-                    std::lock_guard<std::mutex> metrics_lock(metrics_mutex);
-                    metrics.messages_sent++;
-                } else {
-                    // Mark for cleanup
-                    failed_sockets.push_back(socket_fd);
+        {
+            std::lock_guard<std::mutex> lock(conn->inbound_mutex);
+            if (conn->inbound.empty()) {
+                has_more = false;
+                break;
+            }
+            
+            size_t cost = inbound_cost(conn->inbound.front());
+            if (cost > budget) {
+                // Fast path: with nobody else waiting, keep going instead of
+                // paying for a trip through the scheduler
+                if (scheduler.has_waiting()) {
+                    break;
                 }
+                budget = cost;
             }
+            budget -= cost;
+            
+            event = std::move(conn->inbound.front());
+            conn->inbound.pop_front();
         }
-    }
-    
-    // Clean up failed connections (do this outside the clients lock)
-    for (int fd : failed_sockets) {
-        std::lock_guard<std::mutex> lock(clients_mutex);
-        auto it = clients.find(fd);
-        if (it != clients.end()) {
-            log_message("Client connection lost: " + it->second.user_id);
-            it->second.active = false;
+        
+        try {
+            switch (event.kind) {
+                case InboundKind::HANDSHAKE:
+                    register_client(conn, event.frame.sender);
+                    break;
+                case InboundKind::MESSAGE:
+                    handle_message(conn, event.frame, event.received_ns);
+                    break;
+                case InboundKind::CLOSE:
+                    unregister_client(conn);
+                    scheduler.remove_client(conn->socket_fd);
+                    break;
+            }
+        } catch (const std::exception& e) {
+            log_message(LogLevel::LOG_ERROR, "Exception while processing client event: " + std::string(e.what()));
         }
     }
     
-    // Add message to cache
-    message_cache.insert(msg.sender, msg.payload, msg.timestamp);
+    // Back of the line if there is more; a requeued client needs a new turn
+    if (scheduler.end_turn(turn, budget, has_more)) {
+        schedule_turn(true);
+    }
 }
 
-void handle_client(int client_socket) {
-    char buffer[BUFFER_SIZE];
-    Message msg;
-    std::string user_id;
+void on_client_data(const std::shared_ptr<Connection>& conn) {
+    std::string& buffer = conn->read_buffer;
+    uint64_t received_ns = monotonic_ns();
     
-    try {
-        // Set socket timeout to allow checking server_running
-        struct timeval tv;
-        tv.tv_sec = 1;  // 1 second timeout for faster shutdown
-        tv.tv_usec = 0;
-        if (setsockopt(client_socket, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) < 0) {
-            log_message("Warning: Failed to set socket timeout");
-        }
-        
-        // Receive initial user ID
-        memset(buffer, 0, sizeof(buffer));
-        ssize_t bytes = recv(client_socket, buffer, BUFFER_SIZE - 1, 0);
-        if (bytes <= 0) {
-            close(client_socket);
+    if (!conn->handshake_done) {
+        // The hello may span reads; wait until it is complete
+        std::string user_id;
+        size_t consumed = 0;
+        HelloStatus hello = parse_hello(buffer, user_id, consumed);
+        if (hello == HelloStatus::INCOMPLETE) {
             return;
         }
-        
-        buffer[std::min(bytes, (ssize_t)(BUFFER_SIZE - 1))] = '\0';
-        user_id = std::string(buffer);
+        conn->framed = hello == HelloStatus::FRAMED;
+        buffer.erase(0, consumed);
         
         // Validate user ID
         if (user_id.empty() || user_id.length() > USERNAME_MAX_LEN) {
-            log_message("Invalid user ID received, disconnecting");
-            close(client_socket);
+            log_message(LogLevel::LOG_WARNING, "Invalid user ID received, disconnecting");
+            reactor->close_connection(conn);
             return;
         }
         
-        // Register client
-        {
-            std::lock_guard<std::mutex> lock(clients_mutex);
-            ClientInfo info;
-            info.socket_fd = client_socket;
-            info.user_id = user_id;
-            info.connect_time = time(nullptr);
-            info.last_active = time(nullptr);
-            info.active = true;
-            clients[client_socket] = info;
-            
-            std::lock_guard<std::mutex> metrics_lock(metrics_mutex);
-            metrics.active_clients++;
+        // Acknowledge framing before anything else is sent to the client
+        if (conn->framed &&
+            reactor->send(conn, FRAMING_TAG, FRAMING_TAG_LEN) != SendResult::QUEUED) {
+            return;
         }
         
-        // Add to scheduler
-        scheduler.add_client(client_socket, user_id);
+        conn->handshake_done = true;
         
-        // Send join notification
-        Message join_msg;
-        memset(&join_msg, 0, sizeof(join_msg));
-        join_msg.type = MSG_JOIN;
-        join_msg.timestamp = time(nullptr);
-        join_msg.set_sender(user_id);
-        snprintf(join_msg.payload, sizeof(join_msg.payload), "%s has joined the chat", user_id.c_str());
-        join_msg.payload_size = strlen(join_msg.payload);
-        broadcast_message(join_msg, client_socket);
+        // From here on the client's events are served by the scheduler
+        scheduler.add_client(conn->socket_fd, user_id, 1, conn);
+        InboundEvent event(InboundKind::HANDSHAKE);
+        event.frame.sender = user_id;
+        push_inbound(conn, std::move(event));
         
-        log_message("Client connected: " + user_id + " (fd: " + std::to_string(client_socket) + ")");
+        if (buffer.empty()) {
+            return;
+        }
+    }
+    
+    if (conn->framed) {
+        conn->decoder.feed(buffer.data(), buffer.size());
+        buffer.clear();
         
-        // Main message loop
-        while (server_running.load()) {
-            memset(&msg, 0, sizeof(msg));
-            bytes = recv(client_socket, &msg, sizeof(Message), 0);
-            
-            if (bytes < 0) {
-                // Check if it was a timeout
-                if (errno == EWOULDBLOCK || errno == EAGAIN) {
-                    // Timeout - continue loop to check server_running
-                    continue;
-                }
-                // Real error - client disconnected
-                break;
-            }
-            
-            if (bytes == 0 || bytes != sizeof(Message)) {
-                // Client disconnected or invalid message
-                break;
-            }
-            
-            {
-                std::lock_guard<std::mutex> metrics_lock(metrics_mutex);
-                metrics.messages_received++;
-            }
-            
-            // Update last active time
-            {
-                std::lock_guard<std::mutex> lock(clients_mutex);
-                auto it = clients.find(client_socket);
-                if (it != clients.end()) {
-                    it->second.last_active = time(nullptr);
-                }
-            }
-            
-            // Process message based on type
-            switch (msg.type) {
-                case MSG_TEXT: {
-                    // Ensure null-terminated strings
-                    msg.sender[sizeof(msg.sender) - 1] = '\0';
-                    msg.payload[sizeof(msg.payload) - 1] = '\0';
-                    
-                    // Check cache for recent messages from same user (simulates deduplication)
-                    std::string recent_msg_id = std::string(msg.sender) + "_" + 
-                                                std::to_string(msg.timestamp - 5);
-                    std::string cached;
-                    message_cache.lookup(recent_msg_id, cached);
-                    
-                    msg.timestamp = time(nullptr);
-                    broadcast_message(msg, client_socket);
-                    log_message("Message from " + user_id + ": " + std::string(msg.payload));
-                    
-                    // Simulate cache hits by looking up recently sent messages
-                    for (int i = 1; i <= 3; i++) {
-                        std::string prev_msg_id = user_id + "_" + std::to_string(msg.timestamp - i);
-                        std::string cached_msg;
-                        if (message_cache.lookup(prev_msg_id, cached_msg)) {
-                            message_cache.update_access(prev_msg_id);
-                        }
-                    }
-                    break;
-                }
-                    
-                default:
-                    log_message("Unknown message type " + std::to_string(msg.type) + 
-                                " from " + user_id);
-                    break;
-            }
+        InboundEvent event(InboundKind::MESSAGE);
+        while (conn->decoder.next(event.frame)) {
+            event.received_ns = received_ns;
+            push_inbound(conn, std::move(event));
+            event = InboundEvent(InboundKind::MESSAGE);
         }
-    } catch (const std::exception& e) {
-        log_message("Exception in handle_client: " + std::string(e.what()));
+        
+        if (conn->decoder.has_error()) {
+            log_message(LogLevel::LOG_WARNING, "Malformed frame from fd " + std::to_string(conn->socket_fd) + ", disconnecting");
+            reactor->close_connection(conn);
+        }
+        return;
     }
     
-    // Client cleanup
-    scheduler.remove_client(client_socket);
+    // Legacy clients send fixed-size Message structs; a partial one stays buffered
+    size_t offset = 0;
+    while (buffer.size() - offset >= sizeof(Message)) {
+        Message msg;
+        memcpy(&msg, buffer.data() + offset, sizeof(Message));
+        offset += sizeof(Message);
+        
+        InboundEvent event(InboundKind::MESSAGE);
+        event.frame = frame_from_message(msg);
+        event.received_ns = received_ns;
+        push_inbound(conn, std::move(event));
+    }
+    buffer.erase(0, offset);
+}
+
+void on_client_close(const std::shared_ptr<Connection>& conn) {
+    push_inbound(conn, InboundEvent(InboundKind::CLOSE));
+}
+
+void on_client_heartbeat(const std::shared_ptr<Connection>& conn) {
+    // A legacy STATUS would cost a whole Message struct; idle legacy clients only get reaped
+    if (!conn->handshake_done || !conn->framed) {
+        return;
+    }
     
-    {
-        std::lock_guard<std::mutex> lock(clients_mutex);
-        clients.erase(client_socket);
-        std::lock_guard<std::mutex> metrics_lock(metrics_mutex);
-        if (metrics.active_clients > 0) {
-            metrics.active_clients--;
+    char header[FRAME_HEADER_SIZE];
+    encode_frame_header(header, MSG_STATUS, 0, 0, 0, time(nullptr));
+    reactor->send(conn, header, sizeof(header));
+}
+
+void register_client(const std::shared_ptr<Connection>& conn, const std::string& user_id) {
+    int client_socket = conn->socket_fd;
+    
+    conn->info.socket_fd = client_socket;
+    conn->info.user_id = user_id;
+    conn->sender_id = SenderTable::instance().intern(user_id);
+    conn->info.connect_time = time(nullptr);
+    conn->info.active = true;
+    conn->registered = true;
+    
+    // Before joining the broadcast set, so replayed messages precede live ones
+    replay_history(conn, rooms.get_default());
+    
+    // Register client
+    if (!clients.add(client_socket, conn)) {
+        log_message(LogLevel::LOG_ERROR, "No registry slot for fd " + std::to_string(client_socket) + ", disconnecting");
+        conn->registered = false;
+        reactor->close_connection(conn);
+        return;
+    }
+    MetricsRegistry::instance().adjust(Gauge::ACTIVE_CLIENTS, 1);
+    
+    // Everyone starts in the default room
+    conn->room = rooms.get_default_ptr();
+    conn->room->subscribe(conn);
+    
+    // Send join notification
+    Frame join_msg;
+    join_msg.type = MSG_JOIN;
+    join_msg.timestamp = time(nullptr);
+    join_msg.sender = user_id;
+    join_msg.payload = user_id + " has joined the chat";
+    broadcast_message(*conn->room, join_msg, conn->sender_id, client_socket);
+    
+    log_message("Client connected: " + user_id + " (fd: " + std::to_string(client_socket) + ")");
+}
+
+void warm_from_log() {
+    if (!message_log.open()) {
+        log_message(LogLevel::LOG_WARNING, "Message log unavailable; history will not survive a restart");
+        return;
+    }
+    
+    // Only the tail that fits in the history ring is read; earlier records
+    // are skipped header by header without touching their text
+    uint64_t started = monotonic_ns();
+    size_t warmed = message_log.for_each_recent(HISTORY_MAX_RECORDS, [](const LoggedMessage& record) {
+        // Rooms that had traffic are recreated, in the order they reappear
+        std::shared_ptr<Room> room = record.room.empty() ? rooms.get_default_ptr() : rooms.find_or_create(record.room);
+        if (!room) {
+            return;
         }
+        uint32_t sender_id = SenderTable::instance().intern(record.sender);
+        history.append(record.type, sender_id, record.timestamp, record.payload.data(), record.payload.size(),
+                       room->id);
+        room->cache.insert(sender_id, record.payload, record.timestamp);
+    });
+    
+    if (warmed > 0) {
+        log_message("Warmed cache and history with " + std::to_string(warmed) + " messages in " +
+                    std::to_string((monotonic_ns() - started) / 1000) + " us");
     }
+}
+
+void replay_history(const std::shared_ptr<Connection>& conn, const Room& room) {
+    if (!conn->framed) {
+        // Legacy Message structs are fixed-size copies; encode and queue them
+        std::string wire;
+        history.for_each_recent_in_room(room.id, HISTORY_REPLAY_COUNT, [&](const HistoryRecord& record) {
+            Frame frame;
+            frame.type = record.type;
+            frame.timestamp = record.timestamp;
+            frame.sender = std::string(SenderTable::instance().name(record.sender_id));
+            frame.payload = std::string(record.payload);
+            if (history.is_intact(record.sequence)) {
+                wire += encode_legacy_message(frame);
+            }
+            return true;
+        });
+        if (!wire.empty()) {
+            reactor->send(conn, wire.data(), wire.size());
+        }
+        return;
+    }
+    
+    // Framed: one gathered write of header, sender and payload per record,
+    // the latter two pointing straight into the sender table and history ring
+    char headers[HISTORY_REPLAY_COUNT][FRAME_HEADER_SIZE];
+    struct iovec iov[HISTORY_REPLAY_COUNT * 3];
+    int iov_count = 0;
+    size_t records = 0;
+    uint64_t first_sequence = 0;
     
-    // Send leave notification if we have a user_id
-    if (!user_id.empty()) {
-        Message leave_msg;
-        memset(&leave_msg, 0, sizeof(leave_msg));
-        leave_msg.type = MSG_LEAVE;
-        leave_msg.timestamp = time(nullptr);
-        leave_msg.set_sender(user_id);
-        snprintf(leave_msg.payload, sizeof(leave_msg.payload), "%s has left the chat", user_id.c_str());
-        leave_msg.payload_size = strlen(leave_msg.payload);
-        broadcast_message(leave_msg, -1);
+    history.for_each_recent_in_room(room.id, HISTORY_REPLAY_COUNT, [&](const HistoryRecord& record) {
+        std::string_view sender = SenderTable::instance().name(record.sender_id);
+        size_t sender_len = std::min(sender.size(), static_cast<size_t>(USERNAME_MAX_LEN));
+        size_t payload_len = std::min(record.payload.size(), static_cast<size_t>(MAX_FRAME_PAYLOAD));
+        if (records == 0) {
+            first_sequence = record.sequence;
+        }
         
-        log_message("Client disconnected: " + user_id + " (fd: " + std::to_string(client_socket) + ")");
+        encode_frame_header(headers[records], record.type, static_cast<uint8_t>(sender_len), 0,
+                            static_cast<uint32_t>(payload_len), record.timestamp);
+        iov[iov_count++] = {headers[records], FRAME_HEADER_SIZE};
+        iov[iov_count++] = {const_cast<char*>(sender.data()), sender_len};
+        iov[iov_count++] = {const_cast<char*>(record.payload.data()), payload_len};
+        return ++records < HISTORY_REPLAY_COUNT;
+    });
+    
+    if (records == 0 || reactor->send_gather(conn, iov, iov_count) != SendResult::QUEUED) {
+        return;
+    }
+    
+    // Records retire oldest first, so the first one being intact covers them all.
+    // If the writer lapped the ring during the send the client may have seen
+    // mixed bytes; make it reconnect rather than show them.
+    if (!history.is_intact(first_sequence)) {
+        log_message(LogLevel::LOG_WARNING, "History overwritten during replay to " + conn->info.user_id +
+                    ", disconnecting");
+        reactor->close_connection(conn);
+        return;
+    }
+    log_message(LogLevel::LOG_DEBUG, "Replayed " + std::to_string(records) + " messages to " + conn->info.user_id);
+}
+
+void unregister_client(const std::shared_ptr<Connection>& conn) {
+    if (!conn->registered) {
+        return;
+    }
+    conn->registered = false;
+    
+    int client_socket = conn->socket_fd;
+    const std::string& user_id = conn->info.user_id;
+    
+    // Client cleanup
+    clients.remove(client_socket);
+    std::shared_ptr<Room> room = std::move(conn->room);
+    room->unsubscribe(conn);
+    MetricsRegistry::instance().adjust(Gauge::ACTIVE_CLIENTS, -1);
+    
+    // Send leave notification
+    Frame leave_msg;
+    leave_msg.type = MSG_LEAVE;
+    leave_msg.timestamp = time(nullptr);
+    leave_msg.sender = user_id;
+    leave_msg.payload = user_id + " has left the chat";
+    broadcast_message(*room, leave_msg, conn->sender_id, -1);
+    
+    log_message("Client disconnected: " + user_id + " (fd: " + std::to_string(client_socket) + ")");
+}
+
+void join_room(const std::shared_ptr<Connection>& conn, const std::string& name) {
+    const std::string& user_id = conn->info.user_id;
+    
+    std::shared_ptr<Room> target = rooms.find_or_create(name);
+    if (!target) {
+        log_message(LogLevel::LOG_WARNING, "Rejected room name from " + user_id);
+        return;
     }
+    if (target == conn->room) {
+        return;
+    }
+    
+    std::shared_ptr<Room> previous = std::move(conn->room);
+    previous->unsubscribe(conn);
+    
+    Frame leave_msg;
+    leave_msg.type = MSG_LEAVE;
+    leave_msg.timestamp = time(nullptr);
+    leave_msg.sender = user_id;
+    leave_msg.payload = user_id + " has left #" + previous->name;
+    broadcast_message(*previous, leave_msg, conn->sender_id, -1);
     
-    close(client_socket);
+    // The room's recent messages first, as on connect, then the live ones
+    replay_history(conn, *target);
+    conn->room = target;
+    target->subscribe(conn);
+    
+    // The joiner gets the notice too, as confirmation of the move
+    Frame join_msg;
+    join_msg.type = MSG_JOIN;
+    join_msg.timestamp = time(nullptr);
+    join_msg.sender = user_id;
+    join_msg.payload = user_id + " has joined #" + target->name;
+    broadcast_message(*target, join_msg, conn->sender_id, -1);
+    
+    log_message(LogLevel::LOG_DEBUG, user_id + " moved from #" + previous->name + " to #" + target->name);
+}
+
+void handle_message(const std::shared_ptr<Connection>& conn, Frame& frame, uint64_t received_ns) {
+    const std::string& user_id = conn->info.user_id;
+    
+    MetricsRegistry::instance().add(Counter::MESSAGES_RECEIVED);
+    
+    // Update last active time
+    clients.touch(conn->socket_fd, time(nullptr));
+    
+    // Process message based on type
+    switch (frame.type) {
+        case MSG_TEXT: {
+            // Framed clients leave the sender out; it is implied by the connection
+            uint32_t sender_id = conn->sender_id;
+            if (frame.sender.empty()) {
+                frame.sender = user_id;
+            } else if (frame.sender != user_id) {
+                sender_id = SenderTable::instance().intern(frame.sender);
+            }
+            
+            // Check cache for recent messages from same user (simulates
+            // deduplication) and for the sender's last few seconds (simulates
+            // cache hits); each shard's lock is taken once for its probes
+            time_t now = time(nullptr);
+            MessageKey probes[] = {make_message_key(sender_id, frame.timestamp - 5),
+                                   make_message_key(conn->sender_id, now - 1),
+                                   make_message_key(conn->sender_id, now - 2),
+                                   make_message_key(conn->sender_id, now - 3)};
+            conn->room->cache.lookup_many(probes, sizeof(probes) / sizeof(probes[0]), nullptr, nullptr);
+            
+            frame.timestamp = now;
+            broadcast_message(*conn->room, frame, sender_id, conn->socket_fd);
+            MetricsRegistry::instance().record(Latency::RECV_TO_BROADCAST, monotonic_ns() - received_ns);
+            // Payloads are only logged at DEBUG; skip building the string otherwise
+            if (logger.enabled(LogLevel::LOG_DEBUG)) {
+                log_message(LogLevel::LOG_DEBUG, "Message from " + user_id + ": " + frame.payload);
+            }
+            
+            break;
+        }
+            
+        case MSG_ROOM_JOIN:
+            join_room(conn, frame.payload);
+            break;
+            
+        default:
+            log_message(LogLevel::LOG_WARNING, "Unknown message type " + std::to_string(frame.type) + 
+                        " from " + user_id);
+            break;
+    }
 }
 
 void print_statistics() {
-    std::lock_guard<std::mutex> lock(metrics_mutex);
+    // Refresh so the report is not up to one sample interval stale
+    resource_sampler.sample_now();
+    PerformanceMetrics metrics = collect_metrics();
     
     std::cout << "    SERVER STATISTICS" << std::endl;
     std::cout << "Messages Sent:     " << metrics.messages_sent << std::endl;
     std::cout << "Messages Received: " << metrics.messages_received << std::endl;
+    std::cout << "Send Calls:        " << metrics.send_calls;
+    if (metrics.messages_sent > 0) {
+        std::cout << " (" << std::fixed << std::setprecision(3)
+                  << static_cast<double>(metrics.send_calls) / metrics.messages_sent << " per message)";
+    }
+    std::cout << std::endl;
     std::cout << "Active Clients:    " << metrics.active_clients << std::endl;
     std::cout << "Cache Hits:        " << metrics.cache_hits << std::endl;
     std::cout << "Cache Misses:      " << metrics.cache_misses << std::endl;
+    uint64_t lookups = metrics.cache_hits + metrics.cache_misses;
     std::cout << "Cache Hit Rate:    " << std::fixed << std::setprecision(2) 
-              << message_cache.get_hit_rate() << "%" << std::endl;
-    std::cout << "Cache Size:        " << message_cache.get_size() << "/" 
-              << message_cache.get_capacity() << std::endl;
+              << (lookups > 0 ? 100.0 * metrics.cache_hits / lookups : 0.0) << "%" << std::endl;
+    std::cout << "Cache Size:        " << rooms.get_cache_size() << "/" 
+              << rooms.get_cache_capacity() << " across " << rooms.size() << " rooms" << std::endl;
+    if (reactor) {
+        std::cout << "Dropped (backpressure): " << reactor->get_dropped_count() << std::endl;
+    }
+    
+    // Latency percentiles in microseconds
+    for (size_t i = 0; i < static_cast<size_t>(Latency::COUNT); ++i) {
+        Latency latency = static_cast<Latency>(i);
+        LatencyHistogram::Snapshot snap = MetricsRegistry::instance().snapshot(latency);
+        std::cout << MetricsRegistry::name(latency) << " (n=" << snap.total << "): p50="
+                  << snap.percentile(50.0) / 1000.0 << "us p99="
+                  << snap.percentile(99.0) / 1000.0 << "us p999="
+                  << snap.percentile(99.9) / 1000.0 << "us" << std::endl;
+    }
+    
+    std::cout << "RSS:               " << metrics.rss_bytes / 1024 << " KB (peak "
+              << metrics.peak_rss_bytes / 1024 << " KB)" << std::endl;
+    std::cout << "Page Faults:       " << metrics.page_faults_minor << " minor, "
+              << metrics.page_faults_major << " major" << std::endl;
+    std::cout << "Context Switches:  " << metrics.voluntary_switches << " voluntary, "
+              << metrics.involuntary_switches << " involuntary" << std::endl;
+    
+    // Per-thread CPU shows which workers and reactor threads carry the load
+    for (const ThreadUsage& thread : resource_sampler.get_latest().threads) {
+        std::cout << "  " << std::left << std::setw(12) << thread.name << std::right
+                  << " cpu " << thread.cpu_time_ns / 1000000.0 << "ms"
+                  << " faults " << thread.minor_faults << "/" << thread.major_faults
+                  << " switches " << thread.voluntary_switches << "/" << thread.involuntary_switches
+                  << std::endl;
+    }
 }
 
 void signal_handler(int signum) {
@@ -313,83 +690,42 @@ void signal_handler(int signum) {
     }
 }
 
-bool setup_server_socket(int& server_socket) {
-    // Create server socket
-    server_socket = socket(AF_INET, SOCK_STREAM, 0);
-    if (server_socket < 0) {
-        log_message("ERROR: Failed to create socket");
-        return false;
-    }
+bool on_client_accept(int client_socket, const struct sockaddr_in& addr) {
+    (void)client_socket;
+    char client_ip[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &addr.sin_addr, client_ip, INET_ADDRSTRLEN);
+    log_message("New connection from " + std::string(client_ip));
     
-    // Set socket options
-    int opt = 1;
-    if (setsockopt(server_socket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
-        log_message("WARNING: setsockopt SO_REUSEADDR failed");
-    }
-    
-    // Allow port reuse
-    if (setsockopt(server_socket, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
-        log_message("WARNING: setsockopt SO_REUSEPORT failed");
-    }
-    
-    // Bind socket
-    struct sockaddr_in server_addr;
-    memset(&server_addr, 0, sizeof(server_addr));
-    server_addr.sin_family = AF_INET;
-    server_addr.sin_addr.s_addr = INADDR_ANY;
-    server_addr.sin_port = htons(SERVER_PORT);
-    
-    if (bind(server_socket, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
-        log_message("ERROR: Bind failed - port may be in use");
-        close(server_socket);
-        return false;
-    }
-    
-    // Listen for connections
-    if (listen(server_socket, MAX_CLIENTS) < 0) {
-        log_message("ERROR: Listen failed");
-        close(server_socket);
+    if (reactor->get_connection_count() >= MAX_CLIENTS) {
+        log_message("Connection limit reached, rejecting " + std::string(client_ip));
         return false;
     }
-    
     return true;
 }
 
-void cleanup_server(int server_socket) {
+void cleanup_server() {
     log_message("Shutting down server...");
     
-    // First, close the server socket to stop accepting new connections
-    close(server_socket);
-    
-    // Force close all client connections to unblock threads
-    {
-        std::lock_guard<std::mutex> lock(clients_mutex);
-        for (auto& [socket_fd, client_info] : clients) {
-            if (client_info.active) {
-                // Force immediate close without graceful shutdown
-                struct linger sl;
-                sl.l_onoff = 1;
-                sl.l_linger = 0;
-                setsockopt(socket_fd, SOL_SOCKET, SO_LINGER, &sl, sizeof(sl));
-                close(socket_fd);
-                client_info.active = false;
-            }
-        }
-        clients.clear();
+    // Stop the I/O threads, and with them the listeners, so no new client
+    // work is produced
+    if (reactor) {
+        reactor->shutdown();
     }
     
-    // Give threads a brief moment to detect closed sockets and exit
-    std::cout << "Waiting for threads to finish..." << std::endl;
-    std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+    // Force close all client connections; sockets are released once the
+    // workers drop their last reference
+    for (const auto& conn : clients.clear()->members) {
+        // Force immediate close without graceful shutdown
+        struct linger sl;
+        sl.l_onoff = 1;
+        sl.l_linger = 0;
+        setsockopt(conn->socket_fd, SOL_SOCKET, SO_LINGER, &sl, sizeof(sl));
+    }
     
     // Final statistics
     print_statistics();
     
     log_message("Server shutdown complete");
-    
-    if (log_file.is_open()) {
-        log_file.close();
-    }
 }
 
 int main() {
@@ -398,78 +734,86 @@ int main() {
     signal(SIGTERM, signal_handler);
     
     // Open log file
-    log_file.open("server.log", std::ios::app);
-    if (!log_file.is_open()) {
+    if (!logger.open("server.log")) {
         std::cerr << "Warning: Could not open log file" << std::endl;
     }
     
+    // LOG_LEVEL=debug turns on per-message payload logging
+    const char* level_name = getenv("LOG_LEVEL");
+    LogLevel level;
+    if (level_name && AsyncLogger::parse_level(level_name, level)) {
+        logger.set_level(level);
+    }
+    logger.start();
+    resource_sampler.start();
+    warm_from_log();
+    
     log_message("Server starting...");
     
     try {
+        // Create the reactor before the pool so queued work can still reach
+        // it while the pool drains on shutdown
+        Reactor io_reactor(IO_THREAD_COUNT, on_client_data, on_client_close);
+        reactor = &io_reactor;
+        io_reactor.set_heartbeat_handler(on_client_heartbeat);
+        
+        // OUTBOUND_FLUSH_DELAY_US=0 turns coalescing off for latency tests
+        if (const char* delay = getenv("OUTBOUND_FLUSH_DELAY_US")) {
+            io_reactor.set_flush_delay(strtoull(delay, nullptr, 10));
+        }
+        
+        // Shorter CLIENT_IDLE_TIMEOUT_S / HEARTBEAT_INTERVAL_S for liveness tests
+        if (const char* idle = getenv("CLIENT_IDLE_TIMEOUT_S")) {
+            io_reactor.set_idle_timeout(strtoull(idle, nullptr, 10));
+        }
+        if (const char* heartbeat = getenv("HEARTBEAT_INTERVAL_S")) {
+            io_reactor.set_heartbeat_interval(strtoull(heartbeat, nullptr, 10));
+        }
+        
         // Create thread pool
-        ThreadPool thread_pool(THREAD_POOL_SIZE);
+        ThreadPool thread_pool(THREAD_POOL_SIZE, PoolMode::WORK_STEALING);
+        worker_pool = &thread_pool;
         
-        int server_socket;
-        if (!setup_server_socket(server_socket)) {
+        // One SO_REUSEPORT listener per I/O thread; the kernel balances accepts
+        if (!io_reactor.listen(SERVER_PORT, on_client_accept)) {
+            log_message(LogLevel::LOG_ERROR, "Bind failed - port may be in use");
             return 1;
         }
         
+        // REACTOR_PIN_CPUS=1 keeps each I/O thread on one core
+        const char* pin = getenv("REACTOR_PIN_CPUS");
+        if (pin && strcmp(pin, "1") == 0 && !io_reactor.pin_threads()) {
+            log_message(LogLevel::LOG_WARNING, "Could not pin I/O threads to CPUs");
+        }
+        
         log_message("Server listening on port " + std::to_string(SERVER_PORT));
+        
+        // Declared after the pool so it stops before anything it reads is torn down
+        StatsServer stats_server(STATS_PORT, render_prometheus);
+        if (!stats_server.start()) {
+            log_message(LogLevel::LOG_WARNING, "Stats endpoint disabled");
+        }
         std::cout << "\nServer is running. Press Ctrl+C to stop.\n" << std::endl;
         
-        // Main accept loop
+        // The reactor threads accept; the main thread waits for a signal and
+        // meanwhile sweeps expired cache entries, a bounded batch per tick
         while (server_running.load()) {
-            struct sockaddr_in client_addr;
-            socklen_t client_len = sizeof(client_addr);
-            
-            // Set socket to non-blocking for clean shutdown
-            struct timeval tv;
-            tv.tv_sec = 1;  // 1 second timeout
-            tv.tv_usec = 0;
-            setsockopt(server_socket, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
-            
-            int client_socket = accept(server_socket, (struct sockaddr*)&client_addr, &client_len);
-            
-            if (client_socket < 0) {
-                if (!server_running.load()) {
-                    // Shutting down
-                    break;
-                }
-                if (errno == EWOULDBLOCK || errno == EAGAIN) {
-                    // Timeout, check if we should continue
-                    continue;
-                }
-                log_message("ERROR: Accept failed: " + std::string(strerror(errno)));
-                continue;
-            }
-            
-            // Get client IP
-            char client_ip[INET_ADDRSTRLEN];
-            inet_ntop(AF_INET, &client_addr.sin_addr, client_ip, INET_ADDRSTRLEN);
-            log_message("New connection from " + std::string(client_ip));
-            
-            // Assign to thread pool
-            try {
-                thread_pool.enqueue([client_socket]() {
-                    handle_client(client_socket);
-                });
-                
-                {
-                    std::lock_guard<std::mutex> lock(metrics_mutex);
-                    metrics.active_threads = thread_pool.get_active_count();
-                }
-            } catch (const std::exception& e) {
-                log_message("ERROR: Failed to enqueue client: " + std::string(e.what()));
-                close(client_socket);
-            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            rooms.sweep_expired_caches();
         }
         
-        cleanup_server(server_socket);
+        cleanup_server();
         
     } catch (const std::exception& e) {
-        log_message("FATAL ERROR: " + std::string(e.what()));
+        log_message(LogLevel::LOG_ERROR, "Fatal: " + std::string(e.what()));
+        resource_sampler.stop();
+        logger.stop();
         return 1;
     }
     
+    // After the pool has drained, so its last messages are written too
+    message_log.close();
+    resource_sampler.stop();
+    logger.stop();
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,136 @@
+#include "stats_server.h"
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+// How often the listener re-checks running while no scrape arrives
+constexpr int STATS_POLL_INTERVAL_MS = 200;
+// Per-socket read/write timeout for a scrape
+constexpr int STATS_IO_TIMEOUT_MS = 1000;
+
+bool send_all(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+}
+
+StatsServer::StatsServer(int listen_port, Renderer renderer)
+    : port(listen_port), listen_fd(-1), render(std::move(renderer)), running(false) {
+    if (!render) {
+        throw std::invalid_argument("StatsServer needs a renderer");
+    }
+}
+
+StatsServer::~StatsServer() {
+    stop();
+}
+
+bool StatsServer::start() {
+    if (running.load()) {
+        return true;
+    }
+
+    listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0) {
+        std::cerr << "[Stats] Failed to create socket: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    int opt = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = htons(port);
+
+    if (bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(listen_fd, 16) < 0) {
+        std::cerr << "[Stats] Cannot listen on port " << port << ": " << strerror(errno) << std::endl;
+        close(listen_fd);
+        listen_fd = -1;
+        return false;
+    }
+
+    running = true;
+    listener = std::thread(&StatsServer::listener_loop, this);
+    pthread_setname_np(listener.native_handle(), "stats");
+    std::cout << "[Stats] Serving metrics on port " << port << std::endl;
+    return true;
+}
+
+void StatsServer::stop() {
+    running = false;
+    if (listener.joinable()) {
+        listener.join();
+    }
+    if (listen_fd >= 0) {
+        close(listen_fd);
+        listen_fd = -1;
+    }
+}
+
+void StatsServer::listener_loop() {
+    struct pollfd pfd;
+    pfd.fd = listen_fd;
+    pfd.events = POLLIN;
+
+    while (running.load()) {
+        pfd.revents = 0;
+        int ready = poll(&pfd, 1, STATS_POLL_INTERVAL_MS);
+        if (ready <= 0) {
+            continue;  // timeout or EINTR
+        }
+
+        int client_fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client_fd < 0) {
+            continue;
+        }
+        serve(client_fd);
+        close(client_fd);
+    }
+}
+
+void StatsServer::serve(int client_fd) {
+    struct timeval tv;
+    tv.tv_sec = STATS_IO_TIMEOUT_MS / 1000;
+    tv.tv_usec = (STATS_IO_TIMEOUT_MS % 1000) * 1000;
+    setsockopt(client_fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(client_fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    // Every path gets the metrics; read until the end of the request headers
+    std::string request;
+    char buffer[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192) {
+        ssize_t n = recv(client_fd, buffer, sizeof(buffer), 0);
+        if (n <= 0) {
+            return;
+        }
+        request.append(buffer, static_cast<size_t>(n));
+    }
+
+    std::string body = render();
+    std::string response = "HTTP/1.0 200 OK\r\n"
+                           "Content-Type: text/plain; version=0.0.4\r\n"
+                           "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                           "Connection: close\r\n\r\n";
+    response += body;
+    send_all(client_fd, response.data(), response.size());
+}
@@ -0,0 +1,46 @@
+#ifndef STATS_SERVER_H
+#define STATS_SERVER_H
+
+#include "common.h"
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+
+/**
+ * Minimal HTTP listener for metrics scrapes
+ * Runs on its own thread and port, answers every request with the text the
+ * render callback produces (Prometheus exposition format) and closes the
+ * connection. One scrape is served at a time with short socket timeouts, so
+ * a slow scraper can only stall itself, never the chat reactor or pool.
+ */
+class StatsServer {
+public:
+    using Renderer = std::function<std::string()>;
+
+private:
+    int port;
+    int listen_fd;
+    Renderer render;
+    std::thread listener;
+    std::atomic<bool> running;
+
+    void listener_loop();
+    void serve(int client_fd);
+
+public:
+    StatsServer(int port, Renderer renderer);
+    ~StatsServer();
+
+    // Delete copy constructor and assignment operator
+    StatsServer(const StatsServer&) = delete;
+    StatsServer& operator=(const StatsServer&) = delete;
+
+    // Bind and start the listener thread; false if the port is unavailable
+    bool start();
+    void stop();
+
+    int get_port() const { return port; }
+};
+
+#endif
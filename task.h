@@ -0,0 +1,321 @@
+#ifndef TASK_H
+#define TASK_H
+
+#include "common.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * Move-only type-erased void() callable with an inline buffer
+ * Callables up to InlineSize bytes (and nothrow-movable) are stored in place,
+ * so dispatching a typical closure never touches the heap. Larger callables
+ * fall back to a single heap allocation.
+ */
+template <size_t InlineSize>
+class InlineTask {
+private:
+    struct Ops {
+        void (*invoke)(void* storage);
+        void (*move)(void* dst, void* src);  // move-construct into dst, destroy src
+        void (*destroy)(void* storage);
+    };
+
+    template <typename D>
+    static constexpr bool stored_inline =
+        sizeof(D) <= InlineSize && alignof(D) <= alignof(std::max_align_t) &&
+        std::is_nothrow_move_constructible<D>::value;
+
+    template <typename D>
+    static const Ops* inline_ops() {
+        static const Ops ops = {
+            [](void* s) { (*static_cast<D*>(s))(); },
+            [](void* dst, void* src) {
+                new (dst) D(std::move(*static_cast<D*>(src)));
+                static_cast<D*>(src)->~D();
+            },
+            [](void* s) { static_cast<D*>(s)->~D(); }
+        };
+        return &ops;
+    }
+
+    template <typename D>
+    static const Ops* heap_ops() {
+        static const Ops ops = {
+            [](void* s) { (**static_cast<D**>(s))(); },
+            [](void* dst, void* src) { *static_cast<D**>(dst) = *static_cast<D**>(src); },
+            [](void* s) { delete *static_cast<D**>(s); }
+        };
+        return &ops;
+    }
+
+    alignas(std::max_align_t) unsigned char storage[InlineSize];
+    const Ops* ops;
+
+    template <typename F>
+    void construct(F&& f) {
+        using D = typename std::decay<F>::type;
+        if constexpr (stored_inline<D>) {
+            new (storage) D(std::forward<F>(f));
+            ops = inline_ops<D>();
+        } else {
+            *reinterpret_cast<D**>(storage) = new D(std::forward<F>(f));
+            ops = heap_ops<D>();
+        }
+    }
+
+public:
+    static_assert(InlineSize >= sizeof(void*), "Inline buffer must hold a pointer");
+
+    InlineTask() noexcept : ops(nullptr) {}
+
+    template <typename F,
+              typename = typename std::enable_if<
+                  !std::is_same<typename std::decay<F>::type, InlineTask>::value>::type>
+    InlineTask(F&& f) : ops(nullptr) {
+        construct(std::forward<F>(f));
+    }
+
+    InlineTask(InlineTask&& other) noexcept : ops(other.ops) {
+        if (ops) {
+            ops->move(storage, other.storage);
+            other.ops = nullptr;
+        }
+    }
+
+    InlineTask& operator=(InlineTask&& other) noexcept {
+        if (this != &other) {
+            reset();
+            if (other.ops) {
+                other.ops->move(storage, other.storage);
+                ops = other.ops;
+                other.ops = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    // Move-only
+    InlineTask(const InlineTask&) = delete;
+    InlineTask& operator=(const InlineTask&) = delete;
+
+    ~InlineTask() { reset(); }
+
+    // Replace the stored callable, constructing the new one in place
+    template <typename F>
+    void emplace(F&& f) {
+        if constexpr (std::is_same<typename std::decay<F>::type, InlineTask>::value) {
+            *this = std::move(f);
+        } else {
+            reset();
+            construct(std::forward<F>(f));
+        }
+    }
+
+    void reset() noexcept {
+        if (ops) {
+            ops->destroy(storage);
+            ops = nullptr;
+        }
+    }
+
+    explicit operator bool() const noexcept { return ops != nullptr; }
+
+    void operator()() { ops->invoke(storage); }
+
+    // True if a callable of type F is stored without a heap allocation
+    template <typename F>
+    static constexpr bool fits_inline() {
+        return stored_inline<typename std::decay<F>::type>;
+    }
+};
+
+using Task = InlineTask<TASK_INLINE_SIZE>;
+
+// Null checks for callables that can be empty; everything else is non-null
+template <typename F>
+inline bool task_is_empty(const F&) { return false; }
+inline bool task_is_empty(const std::function<void()>& f) { return !f; }
+inline bool task_is_empty(const Task& f) { return !f; }
+inline bool task_is_empty(void (*f)()) { return f == nullptr; }
+
+/**
+ * Growable FIFO ring of tasks, each stamped with its enqueue time
+ * Slots are reused once the ring has grown to the working-set size, so
+ * steady-state push/pop does not allocate (unlike std::deque, which frees
+ * and reallocates its blocks as the queue moves along).
+ */
+class TaskQueue {
+private:
+    struct Entry {
+        Task task;
+        uint64_t enqueued_ns;
+        Entry() : enqueued_ns(0) {}
+    };
+    
+    std::vector<Entry> slots;
+    size_t head;
+    size_t count;
+
+    void grow() {
+        std::vector<Entry> bigger(slots.empty() ? 64 : slots.size() * 2);
+        for (size_t i = 0; i < count; ++i) {
+            Entry& entry = slots[(head + i) & (slots.size() - 1)];
+            bigger[i].task = std::move(entry.task);
+            bigger[i].enqueued_ns = entry.enqueued_ns;
+        }
+        slots.swap(bigger);
+        head = 0;
+    }
+
+public:
+    TaskQueue() : head(0), count(0) {}
+
+    template <typename F>
+    void emplace_back(F&& f, uint64_t enqueued_ns = 0) {
+        if (count == slots.size()) {
+            grow();
+        }
+        Entry& entry = slots[(head + count) & (slots.size() - 1)];
+        entry.task.emplace(std::forward<F>(f));
+        entry.enqueued_ns = enqueued_ns;
+        count++;
+    }
+
+    // Move the oldest task out; the queue must not be empty
+    void pop_front(Task& out, uint64_t& enqueued_ns) {
+        out = std::move(slots[head].task);
+        enqueued_ns = slots[head].enqueued_ns;
+        head = (head + 1) & (slots.size() - 1);
+        count--;
+    }
+
+    bool empty() const { return count == 0; }
+    size_t size() const { return count; }
+};
+
+/**
+ * Result slot shared between a submitted task and its TaskFuture
+ * The completion flag is atomic so polling ready() never takes the lock;
+ * the mutex and condition variable are only used by waiters.
+ */
+template <typename T>
+class FutureState {
+private:
+    std::mutex state_mutex;
+    std::condition_variable ready_cv;
+    std::atomic<bool> done;
+    std::optional<T> value;
+    std::exception_ptr error;
+
+    void finish() {
+        {
+            std::lock_guard<std::mutex> lock(state_mutex);
+            done.store(true, std::memory_order_release);
+        }
+        ready_cv.notify_all();
+    }
+
+public:
+    FutureState() : done(false) {}
+
+    template <typename... Args>
+    void set_value(Args&&... args) {
+        value.emplace(std::forward<Args>(args)...);
+        finish();
+    }
+
+    void set_exception(std::exception_ptr e) {
+        error = e;
+        finish();
+    }
+
+    bool ready() const { return done.load(std::memory_order_acquire); }
+
+    void wait() {
+        if (ready()) {
+            return;
+        }
+        std::unique_lock<std::mutex> lock(state_mutex);
+        ready_cv.wait(lock, [this] { return ready(); });
+    }
+
+    template <typename Rep, typename Period>
+    bool wait_for(const std::chrono::duration<Rep, Period>& timeout) {
+        if (ready()) {
+            return true;
+        }
+        std::unique_lock<std::mutex> lock(state_mutex);
+        return ready_cv.wait_for(lock, timeout, [this] { return ready(); });
+    }
+
+    T take() {
+        wait();
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        return std::move(*value);
+    }
+};
+
+// void results only carry completion and errors
+struct FutureVoid {};
+
+/**
+ * Handle to the result of ThreadPool::submit()
+ * get() blocks until the task has run, then returns its result or rethrows
+ * the exception it threw. Like std::future, get() may be called once.
+ */
+template <typename T>
+class TaskFuture {
+private:
+    using Stored = typename std::conditional<std::is_void<T>::value, FutureVoid, T>::type;
+    std::shared_ptr<FutureState<Stored>> state;
+
+public:
+    TaskFuture() = default;
+    explicit TaskFuture(std::shared_ptr<FutureState<Stored>> s) : state(std::move(s)) {}
+
+    bool valid() const { return state != nullptr; }
+    bool ready() const { return state && state->ready(); }
+
+    void wait() const {
+        if (!state) {
+            throw std::logic_error("Waiting on an empty TaskFuture");
+        }
+        state->wait();
+    }
+
+    template <typename Rep, typename Period>
+    bool wait_for(const std::chrono::duration<Rep, Period>& timeout) const {
+        if (!state) {
+            throw std::logic_error("Waiting on an empty TaskFuture");
+        }
+        return state->wait_for(timeout);
+    }
+
+    T get() {
+        if (!state) {
+            throw std::logic_error("TaskFuture has no result");
+        }
+        std::shared_ptr<FutureState<Stored>> s = std::move(state);
+        if constexpr (std::is_void<T>::value) {
+            s->take();
+        } else {
+            return s->take();
+        }
+    }
+};
+
+#endif
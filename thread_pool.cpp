@@ -1,20 +1,68 @@
 #include "thread_pool.h"
 #include <iostream>
+#include <string>
+#ifdef __linux__
+#include <pthread.h>
+#endif
 
-ThreadPool::ThreadPool(int size) : pool_size(size), stop(false), active_count(0) {
+thread_local const void* ThreadPoolCurrent::pool = nullptr;
+thread_local int ThreadPoolCurrent::index = -1;
+
+namespace {
+// How often a worker checks the shared queue before its own deque
+constexpr unsigned SHARED_QUEUE_INTERVAL = 61;
+
+uint64_t next_random(uint64_t& state) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+}
+
+template <typename QueuePolicy>
+BasicThreadPool<QueuePolicy>::BasicThreadPool(int size, PoolMode pool_mode)
+    : overflow(0), stop(false), active_count(0), pool_size(size), mode(pool_mode),
+      pending(0), sleeping(0), searching(0) {
     if (size <= 0) {
         throw std::invalid_argument("Thread pool size must be positive");
     }
+    if constexpr (QueuePolicy::lock_free) {
+        ring = std::make_unique<MpmcQueue<QueuedTask>>(THREAD_POOL_QUEUE_CAPACITY);
+    }
     
     try {
+        if (mode == PoolMode::WORK_STEALING) {
+            local_queues.reserve(pool_size);
+            for (int i = 0; i < pool_size; ++i) {
+                local_queues.push_back(std::make_unique<Worker>(0x9e3779b97f4a7c15ULL * (i + 1)));
+            }
+        }
+        
         workers.reserve(pool_size);
         for (int i = 0; i < pool_size; ++i) {
-            workers.emplace_back(&ThreadPool::worker_thread, this);
+            if (mode == PoolMode::WORK_STEALING) {
+                workers.emplace_back(&BasicThreadPool::stealing_worker_thread, this, i);
+            } else if (QueuePolicy::lock_free) {
+                workers.emplace_back(&BasicThreadPool::lock_free_worker_thread, this);
+            } else {
+                workers.emplace_back(&BasicThreadPool::worker_thread, this);
+            }
+#ifdef __linux__
+            // Names show up in the resource sampler's per-thread CPU report
+            std::string name = "pool-" + std::to_string(i);
+            pthread_setname_np(workers.back().native_handle(), name.c_str());
+#endif
         }
-        std::cout << "[ThreadPool] Created with " << pool_size << " worker threads" << std::endl;
+        std::cout << "[ThreadPool] Created with " << pool_size << " worker threads ("
+                  << (mode == PoolMode::WORK_STEALING ? "work-stealing, " : "")
+                  << (QueuePolicy::lock_free ? "lock-free" : "locked") << " shared queue)" << std::endl;
     } catch (const std::exception& e) {
         // If thread creation fails, clean up and rethrow
-        stop = true;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            stop = true;
+        }
         condition.notify_all();
         for (auto& worker : workers) {
             if (worker.joinable()) {
@@ -25,7 +73,8 @@ ThreadPool::ThreadPool(int size) : pool_size(size), stop(false), active_count(0)
     }
 }
 
-ThreadPool::~ThreadPool() {
+template <typename QueuePolicy>
+BasicThreadPool<QueuePolicy>::~BasicThreadPool() {
     {
         std::unique_lock<std::mutex> lock(queue_mutex);
         stop = true;
@@ -40,62 +89,260 @@ ThreadPool::~ThreadPool() {
     std::cout << "[ThreadPool] All workers terminated" << std::endl;
 }
 
-void ThreadPool::enqueue(std::function<void()> task) {
-    if (!task) {
-        throw std::invalid_argument("Cannot enqueue null task");
+template <typename QueuePolicy>
+BasicThreadPool<QueuePolicy>::Worker::~Worker() {
+    TaskNode* lists[] = { free_nodes, returned_nodes.exchange(nullptr) };
+    for (TaskNode* node : lists) {
+        while (node) {
+            TaskNode* next = node->next;
+            delete node;
+            node = next;
+        }
     }
-    
-    {
-        std::unique_lock<std::mutex> lock(queue_mutex);
-        if (stop) {
-            throw std::runtime_error("Cannot enqueue task on stopped thread pool");
+}
+
+template <typename QueuePolicy>
+typename BasicThreadPool<QueuePolicy>::TaskNode* BasicThreadPool<QueuePolicy>::acquire_node(Worker& worker) {
+    if (!worker.free_nodes) {
+        // Take back everything thieves have returned in one exchange
+        worker.free_nodes = worker.returned_nodes.exchange(nullptr, std::memory_order_acquire);
+        if (!worker.free_nodes) {
+            return new TaskNode(Current::index);
         }
-        tasks.push(std::move(task));
     }
-    condition.notify_one();
+    TaskNode* node = worker.free_nodes;
+    worker.free_nodes = node->next;
+    return node;
 }
 
-int ThreadPool::get_active_count() const {
+template <typename QueuePolicy>
+void BasicThreadPool<QueuePolicy>::release_node(Worker& worker, TaskNode* node) {
+    if (&worker == local_queues[node->owner].get()) {
+        node->next = worker.free_nodes;
+        worker.free_nodes = node;
+        return;
+    }
+    
+    // Stolen node: hand it back so the owner's pool stays at its working size.
+    // Push-only on this side and take-all on the owner's side, so no ABA.
+    std::atomic<TaskNode*>& head = local_queues[node->owner]->returned_nodes;
+    node->next = head.load(std::memory_order_relaxed);
+    while (!head.compare_exchange_weak(node->next, node, std::memory_order_release,
+                                       std::memory_order_relaxed)) {
+    }
+}
+
+template <typename QueuePolicy>
+int BasicThreadPool<QueuePolicy>::get_active_count() const {
     return active_count.load();
 }
 
-int ThreadPool::get_pool_size() const {
+template <typename QueuePolicy>
+int BasicThreadPool<QueuePolicy>::get_pool_size() const {
     return pool_size;
 }
 
-size_t ThreadPool::get_queue_size() const {
+template <typename QueuePolicy>
+size_t BasicThreadPool<QueuePolicy>::get_queue_size() const {
+    if (mode == PoolMode::WORK_STEALING || QueuePolicy::lock_free) {
+        int64_t count = pending.load();
+        return count > 0 ? static_cast<size_t>(count) : 0;
+    }
     std::lock_guard<std::mutex> lock(const_cast<std::mutex&>(queue_mutex));
     return tasks.size();
 }
 
-void ThreadPool::worker_thread() {
+template <typename QueuePolicy>
+void BasicThreadPool<QueuePolicy>::run_task(Task& task, uint64_t enqueued_ns) {
+    MetricsRegistry::instance().record(Latency::QUEUE_WAIT, monotonic_ns() - enqueued_ns);
+    active_count++;
+    try {
+        task();
+    } catch (const std::exception& e) {
+        std::cerr << "[ThreadPool] Exception in worker thread: " << e.what() << std::endl;
+    } catch (...) {
+        std::cerr << "[ThreadPool] Unknown exception in worker thread" << std::endl;
+    }
+    active_count--;
+}
+
+template <typename QueuePolicy>
+void BasicThreadPool<QueuePolicy>::worker_thread() {
     while (true) {
-        std::function<void()> task;
+        Task task;
+        uint64_t enqueued_ns = 0;
         
         {
             std::unique_lock<std::mutex> lock(queue_mutex);
+            sleeping.fetch_add(1);
             condition.wait(lock, [this] { return stop || !tasks.empty(); });
+            sleeping.fetch_sub(1);
             
             if (stop && tasks.empty()) {
                 return;
             }
             
             if (!tasks.empty()) {
-                task = std::move(tasks.front());
-                tasks.pop();
+                tasks.pop_front(task, enqueued_ns);
             }
         }
         
         if (task) {
-            active_count++;
-            try {
-                task();
-            } catch (const std::exception& e) {
-                std::cerr << "[ThreadPool] Exception in worker thread: " << e.what() << std::endl;
-            } catch (...) {
-                std::cerr << "[ThreadPool] Unknown exception in worker thread" << std::endl;
+            run_task(task, enqueued_ns);
+        }
+    }
+}
+
+template <typename QueuePolicy>
+void BasicThreadPool<QueuePolicy>::wake_one() {
+    // A searching worker will pick the task up (or wake someone) on its own
+    if (sleeping.load() == 0 || searching.load() > 0) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+    }
+    condition.notify_one();
+}
+
+template <typename QueuePolicy>
+void BasicThreadPool<QueuePolicy>::lock_free_worker_thread() {
+    // Same parking protocol as the work-stealing workers, on pending
+    while (true) {
+        Task task;
+        uint64_t enqueued_ns = 0;
+        if (take_shared(task, enqueued_ns)) {
+            if (pending.load() > 0) {
+                wake_one();
             }
-            active_count--;
+            run_task(task, enqueued_ns);
+            continue;
+        }
+        
+        std::unique_lock<std::mutex> lock(queue_mutex);
+        if (stop && pending.load() == 0) {
+            return;
+        }
+        sleeping.fetch_add(1);
+        condition.wait(lock, [this] { return stop || pending.load() > 0; });
+        sleeping.fetch_sub(1);
+    }
+}
+
+template <typename QueuePolicy>
+void BasicThreadPool<QueuePolicy>::spill(QueuedTask* entries, size_t count) {
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    for (size_t i = 0; i < count; ++i) {
+        tasks.emplace_back(std::move(entries[i].task), entries[i].enqueued_ns);
+    }
+    overflow.fetch_add(count);
+}
+
+template <typename QueuePolicy>
+bool BasicThreadPool<QueuePolicy>::take_shared(Task& task, uint64_t& enqueued_ns) {
+    if constexpr (QueuePolicy::lock_free) {
+        QueuedTask entry;
+        if (ring->try_pop(entry)) {
+            task = std::move(entry.task);
+            enqueued_ns = entry.enqueued_ns;
+            pending.fetch_sub(1);
+            return true;
+        }
+        // The ring ran full at some point; drain what spilled over
+        if (overflow.load() == 0) {
+            return false;
+        }
+    }
+    
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    if (tasks.empty()) {
+        return false;
+    }
+    tasks.pop_front(task, enqueued_ns);
+    if constexpr (QueuePolicy::lock_free) {
+        overflow.fetch_sub(1);
+    }
+    pending.fetch_sub(1);
+    return true;
+}
+
+template <typename QueuePolicy>
+bool BasicThreadPool<QueuePolicy>::steal_task(int index, Task& task, uint64_t& enqueued_ns) {
+    if (pool_size < 2) {
+        return false;
+    }
+    
+    // Start at a random victim and try every other worker once
+    Worker& self = *local_queues[index];
+    int start = static_cast<int>(next_random(self.rng_state) % (pool_size - 1));
+    for (int i = 0; i < pool_size - 1; ++i) {
+        int victim = (index + 1 + (start + i) % (pool_size - 1)) % pool_size;
+        TaskNode* stolen = local_queues[victim]->deque.steal();
+        if (stolen) {
+            task = std::move(stolen->task);
+            enqueued_ns = stolen->enqueued_ns;
+            release_node(self, stolen);
+            pending.fetch_sub(1);
+            return true;
         }
     }
-}
\ No newline at end of file
+    return false;
+}
+
+template <typename QueuePolicy>
+bool BasicThreadPool<QueuePolicy>::find_task(int index, Task& task, uint64_t& enqueued_ns) {
+    Worker& self = *local_queues[index];
+    
+    // Local work is LIFO; check the shared queue now and then so work
+    // injected from other threads is not starved by a busy deque
+    if (++self.tick % SHARED_QUEUE_INTERVAL == 0 && take_shared(task, enqueued_ns)) {
+        return true;
+    }
+    
+    TaskNode* local = self.deque.pop();
+    if (local) {
+        task = std::move(local->task);
+        enqueued_ns = local->enqueued_ns;
+        release_node(self, local);
+        pending.fetch_sub(1);
+        return true;
+    }
+    
+    searching.fetch_add(1);
+    bool found = take_shared(task, enqueued_ns) || steal_task(index, task, enqueued_ns);
+    searching.fetch_sub(1);
+    return found;
+}
+
+template <typename QueuePolicy>
+void BasicThreadPool<QueuePolicy>::stealing_worker_thread(int index) {
+    Current::pool = this;
+    Current::index = index;
+    
+    while (true) {
+        Task task;
+        uint64_t enqueued_ns = 0;
+        if (find_task(index, task, enqueued_ns)) {
+            // More work is queued than we just took: let a parked worker help
+            if (pending.load() > 0) {
+                wake_one();
+            }
+            run_task(task, enqueued_ns);
+            continue;
+        }
+        
+        std::unique_lock<std::mutex> lock(queue_mutex);
+        if (stop && pending.load() == 0) {
+            return;
+        }
+        
+        // pending is re-checked under the lock after announcing ourselves,
+        // so an enqueue either sees sleeping > 0 or we see its task
+        sleeping.fetch_add(1);
+        condition.wait(lock, [this] { return stop || pending.load() > 0; });
+        sleeping.fetch_sub(1);
+    }
+}
+
+template class BasicThreadPool<LockFreeTaskQueue>;
+template class BasicThreadPool<LockedTaskQueue>;
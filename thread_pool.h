@@ -1,23 +1,98 @@
 #ifndef THREAD_POOL_H
 #define THREAD_POOL_H
 
+#include "common.h"
+#include "work_stealing_deque.h"
+#include "mpmc_queue.h"
+#include "task.h"
+#include "metrics.h"
 #include <vector>
-#include <queue>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
 #include <functional>
 #include <atomic>
+#include <algorithm>
+#include <memory>
 #include <stdexcept>
+#include <type_traits>
+
+enum class PoolMode : uint8_t {
+    SHARED_QUEUE,   // one queue and lock shared by all workers
+    WORK_STEALING   // per-worker deques, idle workers steal from random victims
+};
+
+// Shared queue policies for BasicThreadPool
+struct LockedTaskQueue {
+    // Growable TaskQueue behind queue_mutex; workers wait on the queue itself
+    static constexpr bool lock_free = false;
+};
+
+struct LockFreeTaskQueue {
+    // Bounded MpmcQueue; producers and consumers never take queue_mutex
+    // unless the ring is full (overflow spills to the locked TaskQueue, so
+    // order is only FIFO until then) or a worker is parking
+    static constexpr bool lock_free = true;
+};
+
+// The pool and worker index of a worker thread. Outside the template: a
+// static thread_local member of a class template has no reliable TLS init
+// wrapper in the translation units that only see the extern template.
+struct ThreadPoolCurrent {
+    static thread_local const void* pool;
+    static thread_local int index;
+};
 
 /**
  * Thread pool implementation for handling concurrent client connections
- * Uses a fixed number of worker threads to process tasks from a queue
+ * Uses a fixed number of worker threads to process tasks from a queue.
+ * In work-stealing mode, tasks enqueued from a worker go to that worker's
+ * own deque; tasks from other threads (and local overflow) go to the shared
+ * injection queue. Idle workers park, and enqueue wakes at most one of them.
+ * QueuePolicy picks how the shared queue is built; see ThreadPool and
+ * LockedThreadPool below.
  */
-class ThreadPool {
+template <typename QueuePolicy>
+class BasicThreadPool {
 private:
+    // Deque entries are pooled so local pushes do not allocate
+    struct TaskNode {
+        Task task;
+        TaskNode* next;
+        int owner;  // worker whose pool the node belongs to
+        uint64_t enqueued_ns;
+        explicit TaskNode(int owner_index) : next(nullptr), owner(owner_index), enqueued_ns(0) {}
+    };
+    
+    struct alignas(64) Worker {
+        WorkStealingDeque<TaskNode> deque;
+        uint64_t rng_state;  // xorshift state for victim selection
+        unsigned tick;       // local tasks run since the shared queue was checked
+        
+        // Recycled nodes, touched only by this worker's thread
+        TaskNode* free_nodes;
+        // Nodes that were stolen and run elsewhere, pushed back by the thief
+        std::atomic<TaskNode*> returned_nodes;
+        
+        explicit Worker(uint64_t seed)
+            : deque(WORKER_DEQUE_CAPACITY), rng_state(seed), tick(0),
+              free_nodes(nullptr), returned_nodes(nullptr) {}
+        ~Worker();
+    };
+    
+    struct QueuedTask {
+        Task task;
+        uint64_t enqueued_ns;
+        QueuedTask() : enqueued_ns(0) {}
+    };
+    
+    // Identifies the pool and deque of the calling worker thread, if any
+    using Current = ThreadPoolCurrent;
+    
     std::vector<std::thread> workers;
-    std::queue<std::function<void()>> tasks;
+    TaskQueue tasks;  // the shared queue, or the lock-free ring's overflow
+    std::unique_ptr<MpmcQueue<QueuedTask>> ring;  // lock-free policy only
+    std::atomic<size_t> overflow;                  // tasks spilled into tasks while the ring was full
     
     std::mutex queue_mutex;
     std::condition_variable condition;
@@ -25,19 +100,241 @@ private:
     std::atomic<int> active_count;
     
     int pool_size;
+    PoolMode mode;
+    
+    // Work-stealing state
+    std::vector<std::unique_ptr<Worker>> local_queues;
+    std::atomic<int64_t> pending;    // tasks queued anywhere, not yet taken (work-stealing or lock-free)
+    std::atomic<int> sleeping;       // workers parked on condition
+    std::atomic<int> searching;      // workers looking for work outside their deque
     
     void worker_thread();
+    void lock_free_worker_thread();
+    void stealing_worker_thread(int index);
+    void run_task(Task& task, uint64_t enqueued_ns);
+    
+    TaskNode* acquire_node(Worker& worker);
+    void release_node(Worker& worker, TaskNode* node);
+    
+    // Lock-free policy: count tasks as pending before checking stop, with no
+    // lock held. A worker only exits once it sees stop and then pending == 0,
+    // so either it sees these tasks or we see stop and back out and throw.
+    void reserve_pending(size_t count) {
+        pending.fetch_add(static_cast<int64_t>(count));
+        if (stop) {
+            pending.fetch_sub(static_cast<int64_t>(count));
+            throw std::runtime_error("Cannot enqueue task on stopped thread pool");
+        }
+    }
+    
+    // Construct the task directly in the shared queue
+    template <typename F>
+    void emplace_shared(F&& task) {
+        if constexpr (QueuePolicy::lock_free) {
+            reserve_pending(1);
+            QueuedTask entry;
+            entry.task.emplace(std::forward<F>(task));
+            entry.enqueued_ns = monotonic_ns();
+            if (!ring->try_push(std::move(entry))) {
+                spill(&entry, 1);
+            }
+        } else {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            if (stop) {
+                throw std::runtime_error("Cannot enqueue task on stopped thread pool");
+            }
+            // Counted before it becomes visible so takers never drive pending negative
+            pending.fetch_add(1);
+            tasks.emplace_back(std::forward<F>(task), monotonic_ns());
+        }
+        wake_one();
+    }
+    
+    // Lock-free policy: queue what did not fit in the ring behind the lock
+    void spill(QueuedTask* entries, size_t count);
+    
+    // Lock-free policy half of enqueue_bulk(): claim ring cells a chunk at a time
+    template <typename Iterator>
+    size_t enqueue_bulk_lock_free(Iterator begin, Iterator end, size_t count) {
+        reserve_pending(count);
+        uint64_t now = monotonic_ns();
+        
+        QueuedTask chunk[THREAD_POOL_BULK_CHUNK];
+        Iterator it = begin;
+        while (it != end) {
+            size_t filled = 0;
+            for (; it != end && filled < THREAD_POOL_BULK_CHUNK; ++it, ++filled) {
+                chunk[filled].task.emplace(std::move(*it));
+                chunk[filled].enqueued_ns = now;
+            }
+            size_t pushed = 0;
+            while (pushed < filled) {
+                size_t n = ring->try_push_bulk(chunk + pushed, filled - pushed);
+                if (n == 0) {
+                    break;
+                }
+                pushed += n;
+            }
+            if (pushed < filled) {
+                spill(chunk + pushed, filled - pushed);
+            }
+        }
+        
+        int wake = static_cast<int>(std::min<size_t>(count, sleeping.load()));
+        if (wake > 0) {
+            // Parking re-checks pending under the lock; passing through it
+            // means no worker is between that check and its wait
+            std::lock_guard<std::mutex> lock(queue_mutex);
+        }
+        for (int i = 0; i < wake; ++i) {
+            condition.notify_one();
+        }
+        return count;
+    }
+    
+    bool take_shared(Task& task, uint64_t& enqueued_ns);
+    bool find_task(int index, Task& task, uint64_t& enqueued_ns);
+    bool steal_task(int index, Task& task, uint64_t& enqueued_ns);
+    void wake_one();
 
 public:
-    explicit ThreadPool(int size);
-    ~ThreadPool();
+    explicit BasicThreadPool(int size, PoolMode mode = PoolMode::SHARED_QUEUE);
+    ~BasicThreadPool();
     
     // Delete copy constructor and assignment operator
-    ThreadPool(const ThreadPool&) = delete;
-    ThreadPool& operator=(const ThreadPool&) = delete;
+    BasicThreadPool(const BasicThreadPool&) = delete;
+    BasicThreadPool& operator=(const BasicThreadPool&) = delete;
     
-    // Enqueue a task to be executed by the thread pool
-    void enqueue(std::function<void()> task);
+    // Enqueue a task to be executed by the thread pool. The callable is
+    // built in place; closures up to TASK_INLINE_SIZE bytes never allocate.
+    template <typename F>
+    void enqueue(F&& task) {
+        if (task_is_empty(task)) {
+            throw std::invalid_argument("Cannot enqueue null task");
+        }
+        
+        if (mode == PoolMode::SHARED_QUEUE) {
+            if constexpr (QueuePolicy::lock_free) {
+                emplace_shared(std::forward<F>(task));
+                return;
+            }
+            {
+                std::unique_lock<std::mutex> lock(queue_mutex);
+                if (stop) {
+                    throw std::runtime_error("Cannot enqueue task on stopped thread pool");
+                }
+                tasks.emplace_back(std::forward<F>(task), monotonic_ns());
+            }
+            condition.notify_one();
+            return;
+        }
+        
+        // Called from one of our workers: keep the task local
+        if (Current::pool == this) {
+            if (stop) {
+                throw std::runtime_error("Cannot enqueue task on stopped thread pool");
+            }
+            
+            Worker& self = *local_queues[Current::index];
+            TaskNode* node = acquire_node(self);
+            node->task.emplace(std::forward<F>(task));
+            node->enqueued_ns = monotonic_ns();
+            pending.fetch_add(1);
+            if (self.deque.push(node)) {
+                wake_one();
+                return;
+            }
+            
+            // Deque full: overflow to the shared queue
+            pending.fetch_sub(1);
+            Task overflow(std::move(node->task));
+            release_node(self, node);
+            emplace_shared(std::move(overflow));
+            return;
+        }
+        
+        emplace_shared(std::forward<F>(task));
+    }
+    
+    // Enqueue behind work from other threads, even when called from a worker;
+    // for tasks that are deliberately giving up their turn
+    template <typename F>
+    void enqueue_fair(F&& task) {
+        if (mode == PoolMode::SHARED_QUEUE) {
+            enqueue(std::forward<F>(task));
+            return;
+        }
+        
+        if (task_is_empty(task)) {
+            throw std::invalid_argument("Cannot enqueue null task");
+        }
+        emplace_shared(std::forward<F>(task));
+    }
+    
+    // Run the callable on the pool and return a handle to its result
+    template <typename F>
+    auto submit(F&& fn) -> TaskFuture<typename std::invoke_result<typename std::decay<F>::type&>::type> {
+        using Result = typename std::invoke_result<typename std::decay<F>::type&>::type;
+        using Future = TaskFuture<Result>;
+        using Stored = typename std::conditional<std::is_void<Result>::value, FutureVoid, Result>::type;
+        
+        auto state = std::make_shared<FutureState<Stored>>();
+        enqueue([state, fn = typename std::decay<F>::type(std::forward<F>(fn))]() mutable {
+            try {
+                if constexpr (std::is_void<Result>::value) {
+                    fn();
+                    state->set_value();
+                } else {
+                    state->set_value(fn());
+                }
+            } catch (...) {
+                state->set_exception(std::current_exception());
+            }
+        });
+        return Future(std::move(state));
+    }
+    
+    // Move every callable in [begin, end) into the shared queue under one
+    // lock, then wake at most min(N, idle) workers. Returns N.
+    template <typename Iterator>
+    size_t enqueue_bulk(Iterator begin, Iterator end) {
+        size_t count = 0;
+        for (Iterator it = begin; it != end; ++it) {
+            if (task_is_empty(*it)) {
+                throw std::invalid_argument("Cannot enqueue null task");
+            }
+            count++;
+        }
+        if (count == 0) {
+            return 0;
+        }
+        
+        if constexpr (QueuePolicy::lock_free) {
+            return enqueue_bulk_lock_free(begin, end, count);
+        }
+        
+        int wake = 0;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            if (stop) {
+                throw std::runtime_error("Cannot enqueue task on stopped thread pool");
+            }
+            // Shared-queue workers never count pending down, as in enqueue()
+            if (mode == PoolMode::WORK_STEALING) {
+                pending.fetch_add(static_cast<int64_t>(count));
+            }
+            uint64_t now = monotonic_ns();
+            for (Iterator it = begin; it != end; ++it) {
+                tasks.emplace_back(std::move(*it), now);
+            }
+            wake = static_cast<int>(std::min<size_t>(count, sleeping.load()));
+        }
+        
+        for (int i = 0; i < wake; ++i) {
+            condition.notify_one();
+        }
+        return count;
+    }
     
     // Get the number of currently active worker threads
     int get_active_count() const;
@@ -47,6 +344,16 @@ public:
     
     // Get the number of pending tasks in the queue
     size_t get_queue_size() const;
+    
+    PoolMode get_mode() const { return mode; }
+    bool is_lock_free() const { return QueuePolicy::lock_free; }
 };
 
-#endif
\ No newline at end of file
+// Definitions live in thread_pool.cpp for these two
+extern template class BasicThreadPool<LockFreeTaskQueue>;
+extern template class BasicThreadPool<LockedTaskQueue>;
+
+using ThreadPool = BasicThreadPool<LockFreeTaskQueue>;
+using LockedThreadPool = BasicThreadPool<LockedTaskQueue>;  // the mutex + condition variable queue
+
+#endif
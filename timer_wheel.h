@@ -0,0 +1,193 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+/**
+ * Hierarchical timing wheel
+ * LEVELS wheels of SLOTS buckets each; level L buckets span SLOTS^L ticks.
+ * A timer goes into the coarsest level that still distinguishes its expiry,
+ * and is cascaded one level down whenever the wheel below wraps. Scheduling
+ * and cancelling are O(1) list operations; advancing costs O(1) per tick plus
+ * the work done on expired timers. Nodes come from an internal pool.
+ *
+ * Not thread-safe: meant to be owned and driven by one thread.
+ */
+template <typename T>
+class TimerWheel {
+public:
+    static constexpr int LEVEL_BITS = 6;
+    static constexpr uint64_t SLOTS = 1ULL << LEVEL_BITS;
+    static constexpr int LEVELS = 4;  // 2^24 ticks before the top level wraps
+
+    struct Node {
+        Node* prev;
+        Node* next;
+        uint64_t expires;  // absolute tick
+        T value;
+
+        Node() : prev(this), next(this), expires(0), value() {}
+        bool linked() const { return next != this; }
+    };
+
+private:
+    static constexpr size_t NODE_BLOCK_SIZE = 64;
+
+    Node slots[LEVELS][SLOTS];  // sentinels of circular lists
+    uint64_t current;
+    size_t count;
+    Node* free_nodes;
+    std::vector<std::unique_ptr<Node[]>> blocks;
+
+    static void unlink(Node* node) {
+        node->prev->next = node->next;
+        node->next->prev = node->prev;
+        node->prev = node;
+        node->next = node;
+    }
+
+    static void link_before(Node* head, Node* node) {
+        node->prev = head->prev;
+        node->next = head;
+        head->prev->next = node;
+        head->prev = node;
+    }
+
+    static void splice(Node* from, Node* to) {
+        if (!from->linked()) {
+            return;
+        }
+        to->next = from->next;
+        to->prev = from->prev;
+        to->next->prev = to;
+        to->prev->next = to;
+        from->next = from;
+        from->prev = from;
+    }
+
+    void place(Node* node) {
+        uint64_t delta = node->expires > current ? node->expires - current : 0;
+        int level = 0;
+        while (level < LEVELS - 1 && delta >= (SLOTS << (LEVEL_BITS * level))) {
+            level++;
+        }
+        uint64_t when = node->expires > current ? node->expires : current;
+        // Clamp what would lap the top level; it gets re-placed on cascade
+        if (level == LEVELS - 1 && delta >= (SLOTS << (LEVEL_BITS * level))) {
+            when = current + (SLOTS << (LEVEL_BITS * level)) - 1;
+        }
+        size_t index = static_cast<size_t>((when >> (LEVEL_BITS * level)) & (SLOTS - 1));
+        link_before(&slots[level][index], node);
+    }
+
+    Node* acquire() {
+        if (!free_nodes) {
+            blocks.push_back(std::make_unique<Node[]>(NODE_BLOCK_SIZE));
+            Node* block = blocks.back().get();
+            for (size_t i = 0; i < NODE_BLOCK_SIZE; ++i) {
+                block[i].next = free_nodes;
+                free_nodes = &block[i];
+            }
+        }
+        Node* node = free_nodes;
+        free_nodes = node->next;
+        node->prev = node;
+        node->next = node;
+        return node;
+    }
+
+    void release(Node* node) {
+        node->value = T();
+        node->next = free_nodes;
+        node->prev = nullptr;
+        free_nodes = node;
+    }
+
+    // Move a coarser bucket's timers down now that its span has been reached
+    void cascade(int level) {
+        size_t index = static_cast<size_t>((current >> (LEVEL_BITS * level)) & (SLOTS - 1));
+        Node pending;
+        splice(&slots[level][index], &pending);
+        while (pending.linked()) {
+            Node* node = pending.next;
+            unlink(node);
+            place(node);
+        }
+    }
+
+public:
+    explicit TimerWheel(uint64_t start_tick = 0) : current(start_tick), count(0), free_nodes(nullptr) {}
+
+    // Delete copy constructor and assignment operator
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    // Fire after delay ticks (a delay of 0 fires on the next tick)
+    Node* schedule(uint64_t delay, T value) {
+        Node* node = acquire();
+        node->expires = current + (delay == 0 ? 1 : delay);
+        node->value = std::move(value);
+        place(node);
+        count++;
+        return node;
+    }
+
+    void cancel(Node* node) {
+        unlink(node);
+        release(node);
+        count--;
+    }
+
+    /**
+     * Advance to now_tick, calling fn(T&) for every timer that expires.
+     * fn returns 0 to retire the timer or a delay in ticks to re-arm it.
+     * Returns the number of timers that fired.
+     */
+    template <typename F>
+    size_t advance(uint64_t now_tick, F&& fn) {
+        size_t fired = 0;
+        if (count == 0 && current < now_tick) {
+            current = now_tick;  // nothing to cascade or fire on the way
+        }
+        while (current < now_tick) {
+            current++;
+            for (int level = 1; level < LEVELS; ++level) {
+                if ((current & ((1ULL << (LEVEL_BITS * level)) - 1)) != 0) {
+                    break;
+                }
+                cascade(level);
+            }
+
+            Node expired;
+            splice(&slots[0][current & (SLOTS - 1)], &expired);
+            while (expired.linked()) {
+                Node* node = expired.next;
+                unlink(node);
+                if (node->expires > current) {
+                    place(node);  // clamped long timer, not due yet
+                    continue;
+                }
+                fired++;
+                uint64_t again = fn(node->value);
+                if (again > 0) {
+                    node->expires = current + again;
+                    place(node);
+                } else {
+                    release(node);
+                    count--;
+                }
+            }
+        }
+        return fired;
+    }
+
+    bool empty() const { return count == 0; }
+    size_t size() const { return count; }
+    uint64_t now() const { return current; }
+};
+
+#endif
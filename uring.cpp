@@ -0,0 +1,298 @@
+#include "uring.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// The uapi header uses anonymous structs and flexible arrays
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#include <linux/io_uring.h>
+#pragma GCC diagnostic pop
+
+namespace {
+int sys_io_uring_setup(unsigned entries, struct io_uring_params* params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+int sys_io_uring_register(int fd, unsigned opcode, const void* arg, unsigned nr_args) {
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+
+template <typename T>
+T* at(void* base, uint32_t offset) {
+    return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+}
+}
+
+bool UringCompletion::more() const { return (flags & IORING_CQE_F_MORE) != 0; }
+bool UringCompletion::has_buffer() const { return (flags & IORING_CQE_F_BUFFER) != 0; }
+uint16_t UringCompletion::buffer_id() const { return static_cast<uint16_t>(flags >> IORING_CQE_BUFFER_SHIFT); }
+
+IoUring::IoUring(unsigned entries, unsigned files, unsigned recv_buffers, size_t recv_buffer_size)
+    : ring_fd(-1), sq_entries(0), sqe_tail(0), sq_ring(MAP_FAILED), sq_ring_bytes(0),
+      cq_ring(MAP_FAILED), cq_ring_bytes(0), sqes(MAP_FAILED), sqes_bytes(0), sq_head(nullptr),
+      sq_tail(nullptr), sq_mask(0), sq_array(nullptr), cq_head(nullptr), cq_tail(nullptr),
+      cq_mask(0), cqes(nullptr), file_slots(0), buf_count(recv_buffers),
+      buf_size(recv_buffer_size), buf_memory(nullptr), buf_group(0) {
+    // Buffer ids are 16 bits
+    if (buf_count == 0 || buf_count > 65535 || buf_size == 0) {
+        throw std::invalid_argument("Receive buffer count must be between 1 and 65535");
+    }
+
+    // Cooperative task running avoids an IPI per completion; older kernels lack it
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CLAMP | IORING_SETUP_COOP_TASKRUN;
+    ring_fd = sys_io_uring_setup(entries, &params);
+    if (ring_fd < 0 && errno == EINVAL) {
+        memset(&params, 0, sizeof(params));
+        params.flags = IORING_SETUP_CLAMP;
+        ring_fd = sys_io_uring_setup(entries, &params);
+    }
+    if (ring_fd < 0) {
+        throw std::runtime_error("io_uring_setup failed: " + std::string(strerror(errno)));
+    }
+
+    sq_entries = params.sq_entries;
+    sq_ring_bytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_bytes = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap) {
+        sq_ring_bytes = cq_ring_bytes = std::max(sq_ring_bytes, cq_ring_bytes);
+    }
+
+    sq_ring = mmap(nullptr, sq_ring_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   ring_fd, IORING_OFF_SQ_RING);
+    if (sq_ring != MAP_FAILED && !single_mmap) {
+        cq_ring = mmap(nullptr, cq_ring_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                       ring_fd, IORING_OFF_CQ_RING);
+    }
+    sqes_bytes = params.sq_entries * sizeof(struct io_uring_sqe);
+    sqes = mmap(nullptr, sqes_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                ring_fd, IORING_OFF_SQES);
+    void* cq_base = single_mmap ? sq_ring : cq_ring;
+    if (sq_ring == MAP_FAILED || cq_base == MAP_FAILED || sqes == MAP_FAILED) {
+        int saved = errno;
+        release();
+        throw std::runtime_error("io_uring mmap failed: " + std::string(strerror(saved)));
+    }
+
+    sq_head = at<unsigned>(sq_ring, params.sq_off.head);
+    sq_tail = at<unsigned>(sq_ring, params.sq_off.tail);
+    sq_mask = *at<unsigned>(sq_ring, params.sq_off.ring_mask);
+    sq_array = at<unsigned>(sq_ring, params.sq_off.array);
+    cq_head = at<unsigned>(cq_base, params.cq_off.head);
+    cq_tail = at<unsigned>(cq_base, params.cq_off.tail);
+    cq_mask = *at<unsigned>(cq_base, params.cq_off.ring_mask);
+    cqes = at<void>(cq_base, params.cq_off.cqes);
+    sqe_tail = *sq_tail;
+
+    // Registered files are an optimization; carry on with plain fds without them
+    if (files > 0) {
+        struct io_uring_rsrc_register reg;
+        memset(&reg, 0, sizeof(reg));
+        reg.nr = files;
+        reg.flags = IORING_RSRC_REGISTER_SPARSE;
+        if (sys_io_uring_register(ring_fd, IORING_REGISTER_FILES2, &reg, sizeof(reg)) == 0) {
+            file_slots = files;
+        }
+    }
+
+    // Multishot receive needs provided buffers. These go in with
+    // PROVIDE_BUFFERS rather than a registered buffer ring: some kernels
+    // accept the ring registration and then never select from it.
+    buf_memory = new char[buf_count * buf_size];
+    returned_buffers.reserve(buf_count);
+    int result = -EAGAIN;
+    if (provide_buffers(0, buf_count, false) && enter(1) >= 0) {
+        const auto* cqe = static_cast<const struct io_uring_cqe*>(cqes) + (*cq_head & cq_mask);
+        result = cqe->res;
+        __atomic_store_n(cq_head, *cq_head + 1, __ATOMIC_RELEASE);
+    }
+    if (result < 0) {
+        int saved = -result;
+        release();
+        throw std::runtime_error("io_uring provided buffers unavailable: " + std::string(strerror(saved)));
+    }
+}
+
+IoUring::~IoUring() {
+    release();
+}
+
+void IoUring::release() {
+    if (sqes != MAP_FAILED) {
+        munmap(sqes, sqes_bytes);
+        sqes = MAP_FAILED;
+    }
+    if (cq_ring != MAP_FAILED) {
+        munmap(cq_ring, cq_ring_bytes);
+        cq_ring = MAP_FAILED;
+    }
+    if (sq_ring != MAP_FAILED) {
+        munmap(sq_ring, sq_ring_bytes);
+        sq_ring = MAP_FAILED;
+    }
+    // Closing the ring cancels whatever is still in flight
+    if (ring_fd >= 0) {
+        close(ring_fd);
+        ring_fd = -1;
+    }
+    delete[] buf_memory;
+    buf_memory = nullptr;
+}
+
+bool IoUring::update_file(unsigned index, int fd) {
+    if (index >= file_slots) {
+        return false;
+    }
+    struct io_uring_files_update update;
+    memset(&update, 0, sizeof(update));
+    update.offset = index;
+    update.fds = reinterpret_cast<uint64_t>(&fd);
+    return sys_io_uring_register(ring_fd, IORING_REGISTER_FILES_UPDATE, &update, 1) == 1;
+}
+
+void* IoUring::get_sqe() {
+    // Only this thread writes the tail; the kernel advances the head
+    if (sqe_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) >= sq_entries) {
+        enter(0);
+        if (sqe_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) >= sq_entries) {
+            return nullptr;
+        }
+    }
+    unsigned index = sqe_tail & sq_mask;
+    sq_array[index] = index;
+    sqe_tail++;
+    auto* sqe = static_cast<struct io_uring_sqe*>(sqes) + index;
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+bool IoUring::poll_multishot(int fd, uint64_t user_data) {
+    auto* sqe = static_cast<struct io_uring_sqe*>(get_sqe());
+    if (!sqe) return false;
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = POLLIN;
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->user_data = user_data;
+    return true;
+}
+
+bool IoUring::accept_multishot(int listen_fd, uint64_t user_data) {
+    auto* sqe = static_cast<struct io_uring_sqe*>(get_sqe());
+    if (!sqe) return false;
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = listen_fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    sqe->user_data = user_data;
+    return true;
+}
+
+bool IoUring::recv_multishot(int fd, bool fixed, uint64_t user_data) {
+    auto* sqe = static_cast<struct io_uring_sqe*>(get_sqe());
+    if (!sqe) return false;
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->flags = IOSQE_BUFFER_SELECT | (fixed ? IOSQE_FIXED_FILE : 0);
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->buf_group = buf_group;
+    sqe->user_data = user_data;
+    return true;
+}
+
+bool IoUring::sendmsg(int fd, bool fixed, const struct msghdr* msg, int flags, bool poll_first, uint64_t user_data) {
+    auto* sqe = static_cast<struct io_uring_sqe*>(get_sqe());
+    if (!sqe) return false;
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = fd;
+    sqe->flags = fixed ? IOSQE_FIXED_FILE : 0;
+    sqe->ioprio = poll_first ? IORING_RECVSEND_POLL_FIRST : 0;
+    sqe->addr = reinterpret_cast<uint64_t>(msg);
+    sqe->len = 1;
+    sqe->msg_flags = static_cast<uint32_t>(flags);
+    sqe->user_data = user_data;
+    return true;
+}
+
+bool IoUring::provide_buffers(uint16_t first, unsigned count, bool quiet) {
+    auto* sqe = static_cast<struct io_uring_sqe*>(get_sqe());
+    if (!sqe) return false;
+    sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+    sqe->fd = static_cast<int>(count);
+    sqe->addr = reinterpret_cast<uint64_t>(buf_memory + static_cast<size_t>(first) * buf_size);
+    sqe->len = static_cast<uint32_t>(buf_size);
+    sqe->off = first;
+    sqe->buf_group = buf_group;
+    // Only a failure is worth a completion
+    sqe->flags = quiet ? IOSQE_CQE_SKIP_SUCCESS : 0;
+    sqe->user_data = 0;
+    return true;
+}
+
+void IoUring::provide_returned() {
+    // The buffers sit back to back, so a run of consecutive ids is one request
+    std::sort(returned_buffers.begin(), returned_buffers.end());
+    size_t done = 0;
+    while (done < returned_buffers.size()) {
+        size_t run = 1;
+        while (done + run < returned_buffers.size() &&
+               returned_buffers[done + run] == returned_buffers[done] + run) {
+            ++run;
+        }
+        if (!provide_buffers(returned_buffers[done], static_cast<unsigned>(run), true)) {
+            break;  // SQ full; the rest go with the next submit
+        }
+        done += run;
+    }
+    returned_buffers.erase(returned_buffers.begin(), returned_buffers.begin() + static_cast<long>(done));
+}
+
+int IoUring::submit_and_wait(unsigned wait_for) {
+    if (!returned_buffers.empty()) {
+        provide_returned();
+    }
+    return enter(wait_for);
+}
+
+int IoUring::enter(unsigned wait_for) {
+    // Everything the kernel has not consumed yet, including leftovers from an
+    // interrupted enter
+    __atomic_store_n(sq_tail, sqe_tail, __ATOMIC_RELEASE);
+    unsigned to_submit = sqe_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+    if (to_submit == 0 && wait_for == 0) {
+        return 0;
+    }
+    return sys_io_uring_enter(ring_fd, to_submit, wait_for, wait_for > 0 ? IORING_ENTER_GETEVENTS : 0);
+}
+
+unsigned IoUring::reap(UringCompletion* out, unsigned max) {
+    unsigned head = *cq_head;
+    unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+    unsigned count = 0;
+    while (head != tail && count < max) {
+        const auto* cqe = static_cast<const struct io_uring_cqe*>(cqes) + (head & cq_mask);
+        ++head;
+        if (cqe->user_data == 0) {
+            continue;  // a buffer hand-back that failed; nothing to do but carry on
+        }
+        out[count].user_data = cqe->user_data;
+        out[count].res = cqe->res;
+        out[count].flags = cqe->flags;
+        ++count;
+    }
+    __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+    return count;
+}
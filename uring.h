@@ -0,0 +1,102 @@
+#ifndef URING_H
+#define URING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <sys/socket.h>
+#include <vector>
+
+// One completion, copied out of the CQ ring
+struct UringCompletion {
+    uint64_t user_data;
+    int32_t res;
+    uint32_t flags;
+
+    bool more() const;        // a multishot request stays armed
+    bool has_buffer() const;  // res bytes landed in a provided buffer
+    uint16_t buffer_id() const;
+};
+
+/**
+ * Minimal io_uring wrapper on the raw system calls (no liburing)
+ * Owns the submission and completion rings, a sparse table of registered
+ * files and one group of provided receive buffers. Requests are only
+ * prepared into the SQ; nothing reaches the kernel until submit_and_wait(),
+ * so everything prepared while handling one batch of completions goes in
+ * with a single io_uring_enter().
+ *
+ * Not thread-safe: all calls except the constructor and destructor must
+ * come from one thread.
+ */
+class IoUring {
+private:
+    int ring_fd;
+    unsigned sq_entries;
+    unsigned sqe_tail;  // next SQE to prepare; published to the kernel on submit
+
+    void* sq_ring;
+    size_t sq_ring_bytes;
+    void* cq_ring;
+    size_t cq_ring_bytes;
+    void* sqes;
+    size_t sqes_bytes;
+
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned sq_mask;
+    unsigned* sq_array;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned cq_mask;
+    void* cqes;
+
+    unsigned file_slots;  // 0 when files could not be registered
+
+    unsigned buf_count;
+    size_t buf_size;
+    char* buf_memory;
+    uint16_t buf_group;
+    std::vector<uint16_t> returned_buffers;  // handed back to the kernel on the next submit
+
+    void* get_sqe();
+    int enter(unsigned wait_for);
+    bool provide_buffers(uint16_t first, unsigned count, bool quiet);
+    void provide_returned();
+    void release();
+
+public:
+    // Throws std::runtime_error when io_uring is unavailable
+    IoUring(unsigned entries, unsigned files, unsigned recv_buffers, size_t recv_buffer_size);
+    ~IoUring();
+
+    // Delete copy constructor and assignment operator
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    // Install fd at index in the registered file table (-1 clears it)
+    bool update_file(unsigned index, int fd);
+    bool has_file_table() const { return file_slots > 0; }
+    unsigned get_file_slots() const { return file_slots; }
+
+    // Request preparation; false when the SQ is full even after a submit.
+    // A fixed fd is an index into the registered file table.
+    bool poll_multishot(int fd, uint64_t user_data);
+    bool accept_multishot(int listen_fd, uint64_t user_data);
+    bool recv_multishot(int fd, bool fixed, uint64_t user_data);
+    // msg and everything it points to must stay valid until completion
+    bool sendmsg(int fd, bool fixed, const struct msghdr* msg, int flags, bool poll_first, uint64_t user_data);
+
+    // Hand a provided buffer back to the kernel once its bytes are consumed;
+    // queued, and batched into the next submit
+    void recycle_buffer(uint16_t id) { returned_buffers.push_back(id); }
+    const char* buffer_data(uint16_t id) const { return buf_memory + static_cast<size_t>(id) * buf_size; }
+
+    // Submit everything prepared and wait for at least wait_for completions
+    int submit_and_wait(unsigned wait_for);
+
+    // Copy out up to max completions and release their slots; the wrapper's
+    // own requests (user_data 0) are dropped
+    unsigned reap(UringCompletion* out, unsigned max);
+};
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef WORK_STEALING_DEQUE_H
+#define WORK_STEALING_DEQUE_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+
+/**
+ * Fixed-capacity Chase-Lev work-stealing deque of pointers
+ * The owning thread pushes and pops at the bottom (LIFO); any other thread
+ * may steal from the top (FIFO). push() fails when the ring is full instead
+ * of growing, so the caller decides where overflow goes.
+ * Memory orderings follow Le et al., "Correct and Efficient Work-Stealing
+ * for Weak Memory Models" (PPoPP 2013).
+ */
+template <typename T>
+class WorkStealingDeque {
+private:
+    alignas(64) std::atomic<int64_t> top;
+    alignas(64) std::atomic<int64_t> bottom;
+    std::unique_ptr<std::atomic<T*>[]> buffer;
+    int64_t mask;
+
+public:
+    explicit WorkStealingDeque(size_t capacity) : top(0), bottom(0), mask(0) {
+        if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
+            throw std::invalid_argument("Deque capacity must be a power of two");
+        }
+        buffer.reset(new std::atomic<T*>[capacity]);
+        mask = static_cast<int64_t>(capacity) - 1;
+    }
+    
+    // Delete copy constructor and assignment operator
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+    
+    // Owner only; false when full
+    bool push(T* item) {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        if (b - t > mask) {
+            return false;
+        }
+        buffer[b & mask].store(item, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return true;
+    }
+    
+    // Owner only; nullptr when empty or the last item was stolen
+    T* pop() {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+        
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        
+        T* item = buffer[b & mask].load(std::memory_order_relaxed);
+        if (t == b) {
+            // Last item: race thieves for it
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                             std::memory_order_relaxed)) {
+                item = nullptr;
+            }
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+    
+    // Any thread; nullptr when empty or another thread won the race
+    T* steal() {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+        
+        if (t >= b) {
+            return nullptr;
+        }
+        
+        T* item = buffer[t & mask].load(std::memory_order_relaxed);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                         std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return item;
+    }
+    
+    // Approximate when read by a thread other than the owner
+    size_t size() const {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_relaxed);
+        return b > t ? static_cast<size_t>(b - t) : 0;
+    }
+};
+
+#endif